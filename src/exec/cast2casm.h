@@ -21,12 +21,15 @@
 #include <algorithm>
 #include <cctype>
 #include <cstdio>
+#include <limits>
+#include <map>
 
 #if WASM_CAST_BOOT > 1
 #include "algorithms/casm0x0.h"
 #include "casm/CasmReader.h"
 #include "casm/CasmWriter.h"
 #endif
+#include "interp/IntFormats.h"
 #include "sexp/Ast.h"
 #include "sexp/TextWriter.h"
 #include "sexp-parser/Driver.h"
@@ -66,10 +69,15 @@ class CodeGenerator {
         Namespaces(Namespaces),
         FunctionName(FunctionName),
         ErrorsFound(false),
-        NextIndex(1) {}
+        NextIndex(1),
+        DecoderDefine(nullptr),
+        DecoderIndent(0),
+        DecoderReturned(false) {}
   ~CodeGenerator() {}
   void generateDeclFile();
   void generateImplFile(bool UseArrayImpl);
+  void generateDecoderDeclFile();
+  void generateDecoderImplFile();
   bool foundErrors() const { return ErrorsFound; }
   void setStartPos(std::shared_ptr<ReadCursor> StartPos) { ReadPos = StartPos; }
 
@@ -83,15 +91,27 @@ class CodeGenerator {
   charstring FunctionName;
   bool ErrorsFound;
   size_t NextIndex;
+  // Decoder functions are generated for each (define, read-only) pair
+  // reachable from the file define.
+  typedef std::pair<const DefineNode*, bool> DecoderFcnKey;
+  std::map<DecoderFcnKey, std::string> DecoderFcns;
+  std::vector<DecoderFcnKey> DecoderWorklist;
+  const DefineNode* DecoderDefine;
+  size_t DecoderIndent;
+  // True if the last generated statement returns, so that code generated
+  // after it would be unreachable.
+  bool DecoderReturned;
 
   void puts(charstring Str) { Output->puts(Str); }
   void putc(char Ch) { Output->putc(Ch); }
   void putSymbol(charstring Name, bool Capitalize = true);
+  std::string getSymbol(charstring Name);
   char symbolize(char Ch, bool Capitalize);
 #if WASM_CAST_BOOT > 1
   void generateArrayImplFile();
 #endif
   void generateFunctionImplFile();
+  void generatePreamble();
   void generateHeader();
   void generateEnterNamespaces();
   void generateExitNamespaces();
@@ -120,6 +140,36 @@ class CodeGenerator {
   void generateCreate(charstring NodeType);
   void generateReturnCreate(charstring NodeType);
   size_t generateBadLocal(const Node* Nd);
+  void putLine(const std::string& Line);
+  void putOpenLine(const std::string& Line);
+  void putCloseLine();
+  void generateDecoderName();
+  void generateDecoderSignature();
+  void generateDecoderFcn(DecoderFcnKey Key);
+  void generateDecoderAction(IntType Action);
+  void generateDecoderStmt(const Node* Nd, bool ReadOnly);
+  void generateDecoderReturn(const std::string& Line);
+  void generateDecoderBranch(const Node* Nd, bool ReadOnly, bool& AllReturn);
+  void generateDecoderBinaryRead(const Node* Encoding);
+  void collectDecoderBinaryAccepts(
+      const Node* Encoding,
+      std::vector<const BinaryAcceptNode*>& Accepts);
+  std::string generateDecoderExpr(const Node* Nd, bool ReadOnly);
+  std::string generateDecoderValue(const Node* Nd, bool ReadOnly);
+  std::string generateBadDecoderNode(const Node* Nd);
+  std::string getDecoderFcn(const DefineNode* Defn, bool ReadOnly);
+  std::string getDecoderInt(IntType Value);
+  charstring getDecoderFormat(const Node* Nd);
+  void generateDecoderLEB128Read(charstring Format,
+                                 charstring Type,
+                                 charstring UnsignedType,
+                                 unsigned NumBits,
+                                 bool IsSigned);
+  void generateDecoderLEB128Write(charstring Format,
+                                  charstring Type,
+                                  unsigned NumBits,
+                                  bool IsSigned);
+  std::string getDecoderTemp();
   void generateArrayName() {
     puts(FunctionName);
     puts("Array");
@@ -146,7 +196,7 @@ void CodeGenerator::generateFormat(ValueFormat Format) {
   }
 }
 
-void CodeGenerator::generateHeader() {
+void CodeGenerator::generatePreamble() {
   puts(
       "// -*- C++ -*- \n"
       "\n"
@@ -171,7 +221,12 @@ void CodeGenerator::generateHeader() {
   puts(Filename);
   puts(
       "\"\n"
-      "\n"
+      "\n");
+}
+
+void CodeGenerator::generateHeader() {
+  generatePreamble();
+  puts(
       "#include \"sexp/Ast.h\"\n"
       "\n"
       "#include <memory>\n"
@@ -201,6 +256,11 @@ void CodeGenerator::generateExitNamespaces() {
 }
 
 void CodeGenerator::putSymbol(charstring Name, bool Capitalize) {
+  puts(getSymbol(Name).c_str());
+}
+
+std::string CodeGenerator::getSymbol(charstring Name) {
+  std::string Symbol;
   size_t Len = strlen(Name);
   for (size_t i = 0; i < Len; ++i) {
     char Ch = Name[i];
@@ -231,7 +291,7 @@ void CodeGenerator::putSymbol(charstring Name, bool Capitalize) {
       case 'x':
       case 'y':
       case 'z':
-        putc(i > 0 ? Ch : ((Ch - 'a') + 'A'));
+        Symbol.push_back(i > 0 ? Ch : ((Ch - 'a') + 'A'));
         break;
       case 'A':
       case 'B':
@@ -259,22 +319,23 @@ void CodeGenerator::putSymbol(charstring Name, bool Capitalize) {
       case 'X':
       case 'Y':
       case 'Z':
-        putc(Ch);
+        Symbol.push_back(Ch);
         break;
       case '_':
-        puts("__");
+        Symbol.append("__");
         break;
       case '.':
-        putc('_');
+        Symbol.push_back('_');
         break;
       default: {
         BufferType Buffer;
         sprintf(Buffer, "_x%X_", Ch);
-        puts(Buffer);
+        Symbol.append(Buffer);
         break;
       }
     }
   }
+  return Symbol;
 }
 
 namespace {
@@ -680,6 +741,9 @@ void CodeGenerator::generateDeclFile() {
   generateHeader();
   generateEnterNamespaces();
   generatePredefinedEnum();
+  puts(
+      "// Returns the installed algorithm. It is shared by all callers, and\n"
+      "// must not be modified.\n");
   generateAlgorithmHeader();
   puts(";\n\n");
   generateExitNamespaces();
@@ -747,21 +811,21 @@ void CodeGenerator::generateArrayImplFile() {
   generateAlgorithmHeader();
   puts(
       " {\n"
-      "  static std::shared_ptr<SymbolTable> Symtable;\n"
-      "  if (Symtable)\n"
-      "    return Symtable;\n"
-      "  auto ArrayInput = std::make_shared<ArrayReader>(\n"
-      "    ");
+      "  // Note: Built (thread-safe) on first use, then shared read-only.\n"
+      "  static std::shared_ptr<SymbolTable> Symtable = []() {\n"
+      "    auto ArrayInput = std::make_shared<ArrayReader>(\n"
+      "      ");
   generateArrayName();
   puts(", size(");
   generateArrayName();
   puts(
       "));\n"
-      "  auto Input = std::make_shared<ReadBackedQueue>(ArrayInput);\n"
-      "  CasmReader Reader;\n"
-      "  Reader.readBinary(Input);\n"
-      "  assert(!Reader.hasErrors());\n"
-      "  Symtable = Reader.getReadSymtab();\n"
+      "    auto Input = std::make_shared<ReadBackedQueue>(ArrayInput);\n"
+      "    CasmReader Reader;\n"
+      "    Reader.readBinary(Input);\n"
+      "    assert(!Reader.hasErrors());\n"
+      "    return Reader.getReadSymtab();\n"
+      "  }();\n"
       "  return Symtable;\n");
   generateFunctionFooter();
 }
@@ -775,15 +839,16 @@ void CodeGenerator::generateFunctionImplFile() {
   generateAlgorithmHeader();
   puts(
       " {\n"
-      "  static std::shared_ptr<SymbolTable> Symtable;\n"
-      "  if (Symtable)\n"
-      "    return Symtable;\n"
-      "  Symtable = std::make_shared<SymbolTable>();\n"
-      "  SymbolTable* Symtab = Symtable.get();\n"
-      "  Symtab->install(");
+      "  // Note: Built (thread-safe) on first use, then shared read-only.\n"
+      "  static std::shared_ptr<SymbolTable> Symtable = []() {\n"
+      "    auto Algorithm = std::make_shared<SymbolTable>();\n"
+      "    SymbolTable* Symtab = Algorithm.get();\n"
+      "    Symtab->install(");
   generateFunctionCall(Index);
   puts(
       ");\n"
+      "    return Algorithm;\n"
+      "  }();\n"
       "  return Symtable;\n");
   generateFunctionFooter();
 }
@@ -818,6 +883,877 @@ void CodeGenerator::generateImplFile(bool UseArrayImpl) {
   generateExitNamespaces();
 }
 
+void CodeGenerator::putLine(const std::string& Line) {
+  if (!Line.empty())
+    for (size_t i = 0; i < DecoderIndent; ++i)
+      puts("  ");
+  puts(Line.c_str());
+  putc('\n');
+}
+
+void CodeGenerator::putOpenLine(const std::string& Line) {
+  putLine(Line + " {");
+  ++DecoderIndent;
+}
+
+void CodeGenerator::putCloseLine() {
+  --DecoderIndent;
+  putLine("}");
+}
+
+void CodeGenerator::generateDecoderName() {
+  puts("decode");
+  puts(FunctionName);
+}
+
+void CodeGenerator::generateDecoderSignature() {
+  puts("bool ");
+  generateDecoderName();
+  puts(
+      "(BitReadCursor& ReadPos,\n"
+      "    BitWriteCursor& WritePos,\n"
+      "    bool MinimizeBlockSize)");
+}
+
+std::string CodeGenerator::getDecoderInt(IntType Value) {
+  BufferType Buffer;
+  if (Value <= std::numeric_limits<uint32_t>::max())
+    sprintf(Buffer, "%" PRIuMAX "", uintmax_t(Value));
+  else
+    sprintf(Buffer, "IntType(%" PRIuMAX "ull)", uintmax_t(Value));
+  return Buffer;
+}
+
+charstring CodeGenerator::getDecoderFormat(const Node* Nd) {
+  switch (Nd->getType()) {
+    case OpUint8:
+      return "Uint8";
+    case OpUint32:
+      return "Uint32";
+    case OpUint64:
+      return "Uint64";
+    case OpVarint32:
+      return "Varint32";
+    case OpVarint64:
+      return "Varint64";
+    case OpVaruint32:
+      return "Varuint32";
+    case OpVaruint64:
+      return "Varuint64";
+    default:
+      return nullptr;
+  }
+}
+
+std::string CodeGenerator::getDecoderTemp() {
+  BufferType Buffer;
+  sprintf(Buffer, "V%" PRIuMAX "", uintmax_t(NextIndex++));
+  return Buffer;
+}
+
+std::string CodeGenerator::getDecoderFcn(const DefineNode* Defn,
+                                         bool ReadOnly) {
+  DecoderFcnKey Key(Defn, ReadOnly);
+  auto Iter = DecoderFcns.find(Key);
+  if (Iter != DecoderFcns.end())
+    return Iter->second;
+  std::string Name(ReadOnly ? "read" : "eval");
+  Name.append(getSymbol(Defn->getName().c_str()));
+  DecoderFcns[Key] = Name;
+  DecoderWorklist.push_back(Key);
+  return Name;
+}
+
+std::string CodeGenerator::generateBadDecoderNode(const Node* Nd) {
+  TextWriter Writer;
+  fprintf(stderr, "Can't generate decoder for: ");
+  if (Nd == nullptr)
+    fprintf(stderr, "nullptr\n");
+  else
+    Writer.writeAbbrev(stderr, Nd);
+  ErrorsFound = true;
+  return "0";
+}
+
+void CodeGenerator::generateDecoderAction(IntType Action) {
+  switch (Action) {
+    case IntType(PredefinedSymbol::Block_enter):
+      putLine("readBlockEnter();");
+      putLine("writeBlockEnter();");
+      break;
+    case IntType(PredefinedSymbol::Block_enter_readonly):
+      putLine("readBlockEnter();");
+      break;
+    case IntType(PredefinedSymbol::Block_enter_writeonly):
+      putLine("writeBlockEnter();");
+      break;
+    case IntType(PredefinedSymbol::Block_exit):
+      putLine("readBlockExit();");
+      putLine("writeBlockExit();");
+      break;
+    case IntType(PredefinedSymbol::Block_exit_readonly):
+      putLine("readBlockExit();");
+      break;
+    case IntType(PredefinedSymbol::Block_exit_writeonly):
+      putLine("writeBlockExit();");
+      break;
+    case IntType(PredefinedSymbol::Align):
+      putLine("ReadPos.alignToByte();");
+      putLine("WritePos.alignToByte();");
+      break;
+    default:
+      // All other actions are no-ops for byte streams.
+      break;
+  }
+}
+
+void CodeGenerator::generateDecoderStmt(const Node* Nd, bool ReadOnly) {
+  if (DecoderReturned)
+    return;
+  generateDecoderExpr(Nd, ReadOnly);
+}
+
+void CodeGenerator::generateDecoderReturn(const std::string& Line) {
+  putLine(Line);
+  DecoderReturned = true;
+}
+
+void CodeGenerator::generateDecoderBranch(const Node* Nd,
+                                          bool ReadOnly,
+                                          bool& AllReturn) {
+  generateDecoderStmt(Nd, ReadOnly);
+  AllReturn &= DecoderReturned;
+  DecoderReturned = false;
+}
+
+void CodeGenerator::generateDecoderBinaryRead(const Node* Encoding) {
+  switch (Encoding->getType()) {
+    case OpBinaryAccept:
+      putLine("LastReadValue = " +
+              getDecoderInt(cast<BinaryAcceptNode>(Encoding)->getValue()) +
+              ";");
+      return;
+    case OpBinarySelect:
+      putOpenLine("if (readBit() == 0)");
+      generateDecoderBinaryRead(Encoding->getKid(0));
+      --DecoderIndent;
+      putLine("} else {");
+      ++DecoderIndent;
+      generateDecoderBinaryRead(Encoding->getKid(1));
+      putCloseLine();
+      return;
+    default:
+      generateBadDecoderNode(Encoding);
+      return;
+  }
+}
+
+void CodeGenerator::collectDecoderBinaryAccepts(
+    const Node* Encoding,
+    std::vector<const BinaryAcceptNode*>& Accepts) {
+  if (const auto* Accept = dyn_cast<BinaryAcceptNode>(Encoding)) {
+    Accepts.push_back(Accept);
+    return;
+  }
+  if (isa<BinarySelectNode>(Encoding)) {
+    collectDecoderBinaryAccepts(Encoding->getKid(0), Accepts);
+    collectDecoderBinaryAccepts(Encoding->getKid(1), Accepts);
+  }
+}
+
+std::string CodeGenerator::generateDecoderValue(const Node* Nd,
+                                                bool ReadOnly) {
+  std::string Value = generateDecoderExpr(Nd, ReadOnly);
+  if (DecoderReturned)
+    return Value;
+  // Copy values that may be overwritten by the code generated for
+  // following nodes.
+  if (Value.find("LastReadValue") == std::string::npos &&
+      Value.find("Locals[") == std::string::npos)
+    return Value;
+  std::string Temp = getDecoderTemp();
+  putLine("IntType " + Temp + " = " + Value + ";");
+  return Temp;
+}
+
+std::string CodeGenerator::generateDecoderExpr(const Node* Nd,
+                                               bool ReadOnly) {
+  if (DecoderReturned)
+    return "0";
+  if (Nd == nullptr)
+    return generateBadDecoderNode(Nd);
+  charstring Format = nullptr;
+  switch (Nd->getType()) {
+    default:
+      return generateBadDecoderNode(Nd);
+    case OpI32Const:
+    case OpI64Const:
+    case OpU8Const:
+    case OpU32Const:
+    case OpU64Const: {
+      std::string Value = getDecoderInt(cast<IntegerNode>(Nd)->getValue());
+      putLine("LastReadValue = " + Value + ";");
+      return Value;
+    }
+    case OpLastRead:
+    case OpVoid:
+      return "LastReadValue";
+    case OpLocal: {
+      IntType Index = cast<LocalNode>(Nd)->getValue();
+      if (DecoderDefine == nullptr || Index >= DecoderDefine->getNumLocals())
+        return generateBadDecoderNode(Nd);
+      return "Locals[" + getDecoderInt(Index) + "]";
+    }
+    case OpSet: {
+      const auto* Local = dyn_cast<LocalNode>(Nd->getKid(0));
+      if (Local == nullptr || DecoderDefine == nullptr ||
+          Local->getValue() >= DecoderDefine->getNumLocals())
+        return generateBadDecoderNode(Nd);
+      std::string Value = generateDecoderValue(Nd->getKid(1), ReadOnly);
+      if (DecoderReturned)
+        return "0";
+      putLine("Locals[" + getDecoderInt(Local->getValue()) + "] = " + Value +
+              ";");
+      return "LastReadValue";
+    }
+    case OpBit:
+      putLine("LastReadValue = readBit();");
+      if (!ReadOnly)
+        putLine("WritePos.writeBit(uint8_t(LastReadValue));");
+      return "LastReadValue";
+    case OpUint8:
+    case OpUint32:
+    case OpUint64:
+    case OpVarint32:
+    case OpVarint64:
+    case OpVaruint32:
+    case OpVaruint64:
+      Format = getDecoderFormat(Nd);
+      break;
+    case OpBitwiseAnd:
+    case OpBitwiseOr:
+    case OpBitwiseXor: {
+      std::string Arg1 = generateDecoderValue(Nd->getKid(0), ReadOnly);
+      std::string Arg2 = generateDecoderValue(Nd->getKid(1), ReadOnly);
+      charstring Op = isa<BitwiseAndNode>(Nd)
+                          ? " & "
+                          : (isa<BitwiseOrNode>(Nd) ? " | " : " ^ ");
+      return "(" + Arg1 + Op + Arg2 + ")";
+    }
+    case OpBitwiseNegate:
+      return "(~" + generateDecoderValue(Nd->getKid(0), ReadOnly) + ")";
+    case OpAnd:
+    case OpOr: {
+      std::string Result = getDecoderTemp();
+      std::string Value = generateDecoderExpr(Nd->getKid(0), ReadOnly);
+      if (DecoderReturned)
+        return "0";
+      putLine("IntType " + Result + " = " + Value + ";");
+      putOpenLine("if (" + Result + (isa<AndNode>(Nd) ? " != 0)" : " == 0)"));
+      Value = generateDecoderExpr(Nd->getKid(1), ReadOnly);
+      if (!DecoderReturned)
+        putLine(Result + " = " + Value + ";");
+      // Note: The second argument is conditional, so code after it is
+      // reachable.
+      DecoderReturned = false;
+      putCloseLine();
+      return Result;
+    }
+    case OpSequence:
+      for (const Node* Kid : *Nd)
+        generateDecoderStmt(Kid, ReadOnly);
+      return "LastReadValue";
+    case OpLoop: {
+      std::string Count = generateDecoderValue(Nd->getKid(0), ReadOnly);
+      if (DecoderReturned)
+        return "0";
+      std::string Counter = getDecoderTemp();
+      putOpenLine("for (IntType " + Counter + " = " + Count + "; " + Counter +
+                  " != 0; --" + Counter + ")");
+      generateDecoderStmt(Nd->getKid(1), ReadOnly);
+      // Note: The body may not be run, so code after the loop is reachable.
+      DecoderReturned = false;
+      putCloseLine();
+      return "0";
+    }
+    case OpLoopUnbounded:
+      // Note: Only asks the cursor (virtually) for eob once the bytes
+      // resident in the current page are used up.
+      putOpenLine(
+          "while (ReadPos.getNumPeekableBytes() != 0 || !ReadPos.atEob())");
+      generateDecoderStmt(Nd->getKid(0), ReadOnly);
+      DecoderReturned = false;
+      putCloseLine();
+      return "0";
+    case OpIfThen:
+    case OpIfThenElse: {
+      std::string Cond = generateDecoderValue(Nd->getKid(0), ReadOnly);
+      if (DecoderReturned)
+        return "0";
+      putOpenLine("if (" + Cond + " != 0)");
+      bool AllReturn = true;
+      generateDecoderBranch(Nd->getKid(1), ReadOnly, AllReturn);
+      if (isa<IfThenElseNode>(Nd)) {
+        --DecoderIndent;
+        putLine("} else {");
+        ++DecoderIndent;
+        generateDecoderBranch(Nd->getKid(2), ReadOnly, AllReturn);
+      } else {
+        AllReturn = false;
+      }
+      putCloseLine();
+      DecoderReturned = AllReturn;
+      return "0";
+    }
+    case OpSwitch: {
+      std::string Selector = generateDecoderValue(Nd->getKid(0), ReadOnly);
+      if (DecoderReturned)
+        return "0";
+      putOpenLine("switch (" + Selector + ")");
+      bool AllReturn = true;
+      for (int i = 2; i < Nd->getNumKids(); ++i) {
+        const auto* Case = dyn_cast<CaseNode>(Nd->getKid(i));
+        if (Case == nullptr)
+          return generateBadDecoderNode(Nd->getKid(i));
+        putOpenLine("case " + getDecoderInt(Case->getValue()) + ":");
+        generateDecoderStmt(Case->getKid(1), ReadOnly);
+        if (!DecoderReturned)
+          putLine("break;");
+        AllReturn &= DecoderReturned;
+        DecoderReturned = false;
+        putCloseLine();
+      }
+      putOpenLine("default:");
+      generateDecoderStmt(Nd->getKid(1), ReadOnly);
+      if (!DecoderReturned)
+        putLine("break;");
+      AllReturn &= DecoderReturned;
+      putCloseLine();
+      putCloseLine();
+      DecoderReturned = AllReturn;
+      return "0";
+    }
+    case OpWrite: {
+      Format = getDecoderFormat(Nd->getKid(0));
+      if (Format == nullptr)
+        return generateBadDecoderNode(Nd->getKid(0));
+      for (int i = 1; i < Nd->getNumKids(); ++i) {
+        generateDecoderStmt(Nd->getKid(i), true);
+        if (DecoderReturned)
+          return "0";
+        putLine(std::string("write") + Format + "(LastReadValue);");
+      }
+      return "LastReadValue";
+    }
+    case OpTable: {
+      std::string Key = generateDecoderValue(Nd->getKid(0), ReadOnly);
+      if (DecoderReturned)
+        return "0";
+      std::string Moved = getDecoderTemp();
+      putLine("bool " + Moved + ";");
+      putLine("if (!tablePush(" + Key + ", " + Moved + "))");
+      ++DecoderIndent;
+      putLine("return false;");
+      --DecoderIndent;
+      generateDecoderStmt(Nd->getKid(1), ReadOnly);
+      if (DecoderReturned)
+        return "0";
+      putLine("if (" + Moved + " && !tablePop())");
+      ++DecoderIndent;
+      putLine("return false;");
+      --DecoderIndent;
+      return "LastReadValue";
+    }
+    case OpBinaryEval: {
+      generateDecoderBinaryRead(Nd->getKid(0));
+      if (ReadOnly)
+        return "LastReadValue";
+      std::vector<const BinaryAcceptNode*> Accepts;
+      collectDecoderBinaryAccepts(Nd->getKid(0), Accepts);
+      std::string NumBits = getDecoderTemp();
+      putLine("unsigned " + NumBits + " = 0;");
+      putOpenLine("switch (LastReadValue)");
+      for (const BinaryAcceptNode* Accept : Accepts) {
+        putOpenLine("case " + getDecoderInt(Accept->getValue()) + ":");
+        putLine(NumBits + " = " + getDecoderInt(Accept->getNumBits()) + ";");
+        putLine("break;");
+        putCloseLine();
+      }
+      putOpenLine("default:");
+      putLine("return fail(\"Can't write binary value!\");");
+      putCloseLine();
+      putCloseLine();
+      putLine("writeBinary(LastReadValue, " + NumBits + ");");
+      return "LastReadValue";
+    }
+    case OpOpcode:
+      // Note: Not implemented by the interpreter either.
+      generateDecoderReturn("return fail(\"Multibyte opcodes broken!\");");
+      return "0";
+    case OpError:
+      generateDecoderReturn("return fail(\"Algorithm error!\");");
+      return "0";
+    case OpLastSymbolIs:
+      // Note: Not implemented by the interpreter either.
+      generateDecoderReturn(
+          "return fail(\"last.symbol.is not implemented!\");");
+      return "0";
+    case OpEval: {
+      const auto* Sym = dyn_cast<SymbolNode>(Nd->getKid(0));
+      if (Sym == nullptr || Nd->getNumKids() != 1)
+        return generateBadDecoderNode(Nd);
+      const DefineNode* Defn = Sym->getDefineDefinition();
+      if (Defn == nullptr)
+        return generateBadDecoderNode(Nd);
+      const auto* Params = dyn_cast<ParamsNode>(Defn->getKid(1));
+      if (Params == nullptr || Params->getValue() != 0)
+        return generateBadDecoderNode(Defn);
+      putLine("if (!" + getDecoderFcn(Defn, ReadOnly) + "())");
+      ++DecoderIndent;
+      putLine("return false;");
+      --DecoderIndent;
+      return "LastReadValue";
+    }
+    case OpBlock:
+      generateDecoderAction(IntType(PredefinedSymbol::Block_enter));
+      generateDecoderStmt(Nd->getKid(0), ReadOnly);
+      generateDecoderAction(IntType(PredefinedSymbol::Block_exit));
+      return "0";
+    case OpCallback: {
+      const IntegerNode* Action = cast<CallbackNode>(Nd)->getValue();
+      if (Action == nullptr)
+        return generateBadDecoderNode(Nd);
+      generateDecoderAction(Action->getValue());
+      return "LastReadValue";
+    }
+    case OpRead:
+      return generateDecoderValue(Nd->getKid(0), true);
+    case OpPeek: {
+      std::string Saved = getDecoderTemp();
+      putLine("SavedReadPos " + Saved + ";");
+      putLine("saveReadPos(" + Saved + ");");
+      std::string Value = generateDecoderValue(Nd->getKid(0), true);
+      if (DecoderReturned)
+        return "0";
+      putLine("if (!restoreReadPos(" + Saved + "))");
+      ++DecoderIndent;
+      putLine("return false;");
+      --DecoderIndent;
+      return Value;
+    }
+  }
+  std::string Read("LastReadValue = read");
+  putLine(Read + Format + "();");
+  if (!ReadOnly)
+    putLine(std::string("write") + Format + "(LastReadValue);");
+  return "LastReadValue";
+}
+
+void CodeGenerator::generateDecoderLEB128Read(charstring Format,
+                                              charstring Type,
+                                              charstring UnsignedType,
+                                              unsigned NumBits,
+                                              bool IsSigned) {
+  std::string Fmt(Format);
+  std::string Value(UnsignedType);
+  std::string Bits(getDecoderInt(NumBits));
+  putOpenLine(std::string(Type) + " read" + Fmt + "()");
+  putLine("if (const ByteType* Buffer =");
+  putOpenLine("        ReadPos.peekBytes(interp::fmt::MaxLEB128Bytes))");
+  putLine(Value + " Value = 0;");
+  putOpenLine("for (unsigned i = 0; i * 7 < " + Bits + "; ++i)");
+  putLine("ByteType Byte = Buffer[i];");
+  putLine("Value |= " + Value + "(Byte & 0x7f) << (i * 7);");
+  putOpenLine("if (Byte < 0x80)");
+  putLine("ReadPos.consumeBits((i + 1) * CHAR_BIT);");
+  if (IsSigned) {
+    putLine("if ((Byte & 0x40) && (i + 1) * 7 < " + Bits + ")");
+    putLine("  Value |= ~" + Value + "(0) << ((i + 1) * 7);");
+  }
+  putLine("return " + std::string(Type) + "(Value);");
+  putCloseLine();
+  putCloseLine();
+  putCloseLine();
+  putLine("return interp::fmt::read" + Fmt + "(ReadPos);");
+  putCloseLine();
+  putLine("");
+}
+
+void CodeGenerator::generateDecoderLEB128Write(charstring Format,
+                                               charstring Type,
+                                               unsigned NumBits,
+                                               bool IsSigned) {
+  std::string Fmt(Format);
+  std::string MaxSize(getDecoderInt((NumBits + 6) / 7));
+  putOpenLine("void write" + Fmt + "(" + Type + " Value)");
+  putOpenLine("if (ByteType* Buffer = WritePos.reserveBytes(" + MaxSize +
+              "))");
+  putLine("size_t Size = 0;");
+  if (IsSigned) {
+    putLine("ByteType Byte = ByteType(Value & 0x7f);");
+    putLine("Value >>= 7;");
+    putOpenLine("while (Value != ((Byte & 0x40) ? -1 : 0))");
+    putLine("Buffer[Size++] = ByteType(Byte | 0x80);");
+    putLine("Byte = ByteType(Value & 0x7f);");
+    putLine("Value >>= 7;");
+    putCloseLine();
+    putLine("Buffer[Size++] = Byte;");
+  } else {
+    putOpenLine("while (Value >= 0x80)");
+    putLine("Buffer[Size++] = ByteType(Value | 0x80);");
+    putLine("Value >>= 7;");
+    putCloseLine();
+    putLine("Buffer[Size++] = ByteType(Value);");
+  }
+  putLine("WritePos.commitBytes(Size);");
+  putLine("return;");
+  putCloseLine();
+  putLine("interp::fmt::write" + Fmt + "(Value, WritePos);");
+  putCloseLine();
+  putLine("");
+}
+
+void CodeGenerator::generateDecoderFcn(DecoderFcnKey Key) {
+  const DefineNode* Defn = Key.first;
+  DecoderDefine = Defn;
+  putLine("// (define '" + Defn->getName() + "')" +
+          (Key.second ? " in read-only mode." : ""));
+  putOpenLine("bool " + DecoderFcns[Key] + "()");
+  if (size_t NumLocals = Defn->getNumLocals())
+    putLine("IntType Locals[" + getDecoderInt(NumLocals) + "] = {0};");
+  generateDecoderStmt(Defn->getBody(), Key.second);
+  if (!DecoderReturned)
+    putLine("return true;");
+  DecoderReturned = false;
+  putCloseLine();
+  putLine("");
+  DecoderDefine = nullptr;
+}
+
+void CodeGenerator::generateDecoderDeclFile() {
+  generatePreamble();
+  puts(
+      "#include \"utils/Defs.h\"\n"
+      "\n");
+  generateEnterNamespaces();
+  puts(
+      "class BitReadCursor;\n"
+      "class BitWriteCursor;\n"
+      "\n"
+      "// Decodes the input at ReadPos, writing the result to WritePos.\n"
+      "// Returns false if unable to decode the input.\n");
+  generateDecoderSignature();
+  puts(";\n\n");
+  generateExitNamespaces();
+}
+
+void CodeGenerator::generateDecoderImplFile() {
+  generatePreamble();
+  puts(
+      "#include \"interp/ByteReadStream.h\"\n"
+      "#include \"interp/ByteWriteStream.h\"\n"
+      "#include \"interp/FormatHelpers-templates.h\"\n"
+      "#include \"stream/BitReadCursor.h\"\n"
+      "#include \"stream/BitWriteCursor.h\"\n"
+      "\n"
+      "#include <algorithm>\n"
+      "#include <cstdio>\n"
+      "#include <map>\n"
+      "#include <memory>\n"
+      "#include <vector>\n"
+      "\n");
+  generateEnterNamespaces();
+  puts(
+      "namespace {\n"
+      "\n"
+      "class Decoder {\n"
+      "  Decoder() = delete;\n"
+      "  Decoder(const Decoder&) = delete;\n"
+      "  Decoder& operator=(const Decoder&) = delete;\n"
+      "\n"
+      " public:\n"
+      "  Decoder(BitReadCursor& ReadPos,\n"
+      "          BitWriteCursor& WritePos,\n"
+      "          bool MinimizeBlockSize)\n"
+      "      : ReadPos(ReadPos),\n"
+      "        WritePos(WritePos),\n"
+      "        LastReadValue(0),\n"
+      "        MinimizeBlockSize(MinimizeBlockSize) {}\n"
+      "\n"
+      "  bool run() {\n");
+  DecoderIndent = 2;
+  const FileHeaderNode* Header = Symtab->getTargetHeader();
+  if (Header == nullptr)
+    generateBadDecoderNode(Header);
+  else {
+    for (const Node* Kid : *Header) {
+      const auto* Lit = dyn_cast<IntegerNode>(Kid);
+      if (Lit == nullptr || !Lit->definesIntTypeFormat()) {
+        generateBadDecoderNode(Kid);
+        continue;
+      }
+      charstring Format = nullptr;
+      switch (Lit->getIntTypeFormat()) {
+        case interp::IntTypeFormat::Uint8:
+          Format = "Uint8";
+          break;
+        case interp::IntTypeFormat::Uint32:
+          Format = "Uint32";
+          break;
+        case interp::IntTypeFormat::Uint64:
+          Format = "Uint64";
+          break;
+        default:
+          generateBadDecoderNode(Kid);
+          continue;
+      }
+      std::string Value = getDecoderInt(Lit->getValue());
+      putLine(std::string("if (read") + Format + "() != " + Value + ")");
+      ++DecoderIndent;
+      putLine("return fail(\"Unable to read header value\");");
+      --DecoderIndent;
+      putLine(std::string("write") + Format + "(" + Value + ");");
+    }
+  }
+  const SymbolNode* File = Symtab->getPredefined(PredefinedSymbol::File);
+  const DefineNode* FileDefn = File ? File->getDefineDefinition() : nullptr;
+  if (FileDefn == nullptr)
+    generateBadDecoderNode(File);
+  else {
+    putLine("if (!" + getDecoderFcn(FileDefn, false) + "())");
+    ++DecoderIndent;
+    putLine("return false;");
+    --DecoderIndent;
+  }
+  puts(
+      "    WritePos.freezeEof();\n"
+      "    return ReadPos.atEof() && ReadPos.isQueueGood() &&\n"
+      "           WritePos.isQueueGood();\n"
+      "  }\n"
+      "\n"
+      " private:\n"
+      "  BitReadCursor& ReadPos;\n"
+      "  BitWriteCursor& WritePos;\n"
+      "  interp::ByteReadStream Input;\n"
+      "  interp::ByteWriteStream Output;\n"
+      "  std::vector<BitWriteCursor> BlockStartStack;\n"
+      "  // Gaps left by backpatching minimized block sizes. As in\n"
+      "  // interp::ByteWriter, they are only removed when the outermost\n"
+      "  // block exits, so that each byte is moved at most once.\n"
+      "  struct BlockGap {\n"
+      "    size_t Address;\n"
+      "    size_t Size;\n"
+      "  };\n"
+      "  std::vector<BlockGap> Gaps;\n"
+      "  std::vector<size_t> FirstGapStack;\n"
+      "  // A saved read position.\n"
+      "  typedef BitReadCursor SavedReadPos;\n"
+      "  std::map<IntType, SavedReadPos> Table;\n"
+      "  std::vector<SavedReadPos> TableRestoreStack;\n"
+      "  IntType LastReadValue;\n"
+      "  bool MinimizeBlockSize;\n"
+      "\n"
+      "  bool fail(charstring Message) {\n"
+      "    fprintf(stderr, \"Error: %s\\n\", Message);\n"
+      "    return false;\n"
+      "  }\n"
+      "\n"
+      "  // Note: Reads use the (inlined) buffered word of ReadPos, and only\n"
+      "  // fall back to the cursor's virtual byte reads at page and block\n"
+      "  // boundaries.\n"
+      "  uint8_t readBit() {\n"
+      "    BitReadCursor::WordType Bits;\n"
+      "    if (!ReadPos.peekBits(1, Bits))\n"
+      "      return ReadPos.readBit();\n"
+      "    ReadPos.consumeBits(1);\n"
+      "    return uint8_t(Bits);\n"
+      "  }\n"
+      "\n"
+      "  uint8_t readUint8() {\n"
+      "    if (const ByteType* Buffer = ReadPos.peekBytes(1)) {\n"
+      "      ReadPos.consumeBits(CHAR_BIT);\n"
+      "      return *Buffer;\n"
+      "    }\n"
+      "    return interp::fmt::readUint8(ReadPos);\n"
+      "  }\n"
+      "\n"
+      "  uint32_t readUint32() {\n"
+      "    BitReadCursor::WordType Bits;\n"
+      "    if (!ReadPos.peekBits(32, Bits))\n"
+      "      return interp::fmt::readUint32(ReadPos);\n"
+      "    ReadPos.consumeBits(32);\n"
+      "    // Convert the (big-endian) bits to the little-endian value.\n"
+      "    uint32_t Value = uint32_t(Bits);\n"
+      "    return (Value >> 24) | ((Value >> 8) & 0xff00) |\n"
+      "           ((Value << 8) & 0xff0000) | (Value << 24);\n"
+      "  }\n"
+      "\n"
+      "  uint64_t readUint64() {\n"
+      "    uint64_t Low = readUint32();\n"
+      "    uint64_t High = readUint32();\n"
+      "    return (High << 32) | Low;\n"
+      "  }\n"
+      "\n");
+  DecoderIndent = 1;
+  generateDecoderLEB128Read("Varint32", "int32_t", "uint32_t", 32, true);
+  generateDecoderLEB128Read("Varint64", "int64_t", "uint64_t", 64, true);
+  generateDecoderLEB128Read("Varuint32", "uint32_t", "uint32_t", 32, false);
+  generateDecoderLEB128Read("Varuint64", "uint64_t", "uint64_t", 64, false);
+  puts(
+      "  // Note: Writes fill the page of WritePos directly, and only fall\n"
+      "  // back to the cursor's virtual byte writes at page boundaries.\n"
+      "  void writeUint8(uint8_t Value) {\n"
+      "    if (ByteType* Buffer = WritePos.reserveBytes(1)) {\n"
+      "      *Buffer = Value;\n"
+      "      WritePos.commitBytes(1);\n"
+      "      return;\n"
+      "    }\n"
+      "    WritePos.writeByte(Value);\n"
+      "  }\n"
+      "\n"
+      "  void writeUint32(uint32_t Value) {\n"
+      "    if (ByteType* Buffer = WritePos.reserveBytes(4)) {\n"
+      "      for (size_t i = 0; i < 4; ++i, Value >>= CHAR_BIT)\n"
+      "        Buffer[i] = ByteType(Value);\n"
+      "      WritePos.commitBytes(4);\n"
+      "      return;\n"
+      "    }\n"
+      "    interp::fmt::writeUint32(Value, WritePos);\n"
+      "  }\n"
+      "\n"
+      "  void writeUint64(uint64_t Value) {\n"
+      "    writeUint32(uint32_t(Value));\n"
+      "    writeUint32(uint32_t(Value >> 32));\n"
+      "  }\n"
+      "\n");
+  generateDecoderLEB128Write("Varint32", "int32_t", 32, true);
+  generateDecoderLEB128Write("Varint64", "int64_t", 64, true);
+  generateDecoderLEB128Write("Varuint32", "uint32_t", 32, false);
+  generateDecoderLEB128Write("Varuint64", "uint64_t", 64, false);
+  puts(
+      "  void writeBinary(IntType Value, unsigned NumBits) {\n"
+      "    while (NumBits) {\n"
+      "      --NumBits;\n"
+      "      WritePos.writeBit(uint8_t(Value & 0x1));\n"
+      "      Value >>= 1;\n"
+      "    }\n"
+      "  }\n"
+      "\n"
+      "  void saveReadPos(SavedReadPos& Saved) { Saved = ReadPos; }\n"
+      "\n"
+      "  bool restoreReadPos(const SavedReadPos& Saved) {\n"
+      "    ReadPos = Saved;\n"
+      "    return true;\n"
+      "  }\n"
+      "\n"
+      "  // Sets Moved to true if ReadPos was moved to the position saved for\n"
+      "  // Key, and must be restored by tablePop().\n"
+      "  bool tablePush(IntType Key, bool& Moved) {\n"
+      "    auto Iter = Table.find(Key);\n"
+      "    Moved = Iter != Table.end();\n"
+      "    if (!Moved) {\n"
+      "      saveReadPos(Table[Key]);\n"
+      "      return true;\n"
+      "    }\n"
+      "    TableRestoreStack.emplace_back();\n"
+      "    saveReadPos(TableRestoreStack.back());\n"
+      "    ReadPos = Iter->second;\n"
+      "    return true;\n"
+      "  }\n"
+      "\n"
+      "  bool tablePop() {\n"
+      "    bool Restored = restoreReadPos(TableRestoreStack.back());\n"
+      "    TableRestoreStack.pop_back();\n"
+      "    return Restored;\n"
+      "  }\n"
+      "\n"
+      "  void readBlockEnter() {\n"
+      "    ReadPos.alignToByte();\n"
+      "    Input.pushEobAddress(ReadPos, Input.readBlockSize(ReadPos));\n"
+      "  }\n"
+      "\n"
+      "  void readBlockExit() {\n"
+      "    ReadPos.alignToByte();\n"
+      "    ReadPos.popEobAddress();\n"
+      "  }\n"
+      "\n"
+      "  void writeBlockEnter() {\n"
+      "    WritePos.alignToByte();\n"
+      "    BlockStartStack.push_back(WritePos);\n"
+      "    Output.writeFixedBlockSize(WritePos, 0);\n"
+      "    BlockStartStack.push_back(WritePos);\n"
+      "    FirstGapStack.push_back(Gaps.size());\n"
+      "  }\n"
+      "\n"
+      "  void writeBlockExit() {\n"
+      "    WritePos.alignToByte();\n"
+      "    BitWriteCursor WriteAfterSizeWrite(BlockStartStack.back());\n"
+      "    BlockStartStack.pop_back();\n"
+      "    BitWriteCursor& BlockStart = BlockStartStack.back();\n"
+      "    size_t FirstGap = FirstGapStack.back();\n"
+      "    FirstGapStack.pop_back();\n"
+      "    size_t NewSize = Output.getBlockSize(BlockStart, WritePos);\n"
+      "    if (MinimizeBlockSize) {\n"
+      "      for (size_t i = FirstGap; i < Gaps.size(); ++i)\n"
+      "        NewSize -= Gaps[i].Size;\n"
+      "      Output.writeVarintBlockSize(BlockStart, NewSize);\n"
+      "      size_t SizeAfterBackPatch =\n"
+      "          Output.getStreamAddress(BlockStart);\n"
+      "      size_t SizeAfterSizeWrite =\n"
+      "          Output.getStreamAddress(WriteAfterSizeWrite);\n"
+      "      size_t Diff = SizeAfterSizeWrite - SizeAfterBackPatch;\n"
+      "      if (Diff)\n"
+      "        Gaps.push_back({SizeAfterBackPatch, Diff});\n"
+      "    } else {\n"
+      "      Output.writeFixedBlockSize(BlockStart, NewSize);\n"
+      "    }\n"
+      "    BlockStartStack.pop_back();\n"
+      "    if (BlockStartStack.empty())\n"
+      "      removeGaps();\n"
+      "  }\n"
+      "\n"
+      "  // Slides the contents between gaps down, in a single pass.\n"
+      "  void removeGaps() {\n"
+      "    if (Gaps.empty())\n"
+      "      return;\n"
+      "    // Blocks exit inside out, so gaps of enclosing blocks appear\n"
+      "    // after the gaps of their nested blocks.\n"
+      "    std::sort(Gaps.begin(), Gaps.end(),\n"
+      "              [](const BlockGap& G1, const BlockGap& G2) {\n"
+      "                return G1.Address < G2.Address;\n"
+      "              });\n"
+      "    BitWriteCursor CopyPos(WritePos, Gaps[0].Address);\n"
+      "    size_t EndAddress = Output.getStreamAddress(WritePos);\n"
+      "    for (size_t i = 0; i < Gaps.size(); ++i) {\n"
+      "      size_t StartAddress = Gaps[i].Address + Gaps[i].Size;\n"
+      "      size_t NextAddress =\n"
+      "          i + 1 < Gaps.size() ? Gaps[i + 1].Address : EndAddress;\n"
+      "      Output.moveBlock(CopyPos, StartAddress,\n"
+      "                       NextAddress - StartAddress);\n"
+      "    }\n"
+      "    WritePos.swap(CopyPos);\n"
+      "    Gaps.clear();\n"
+      "  }\n"
+      "\n");
+  DecoderIndent = 1;
+  // Note: Generating a function may add new functions to the worklist.
+  for (size_t i = 0; i < DecoderWorklist.size(); ++i)
+    generateDecoderFcn(DecoderWorklist[i]);
+  DecoderIndent = 0;
+  puts(
+      "};\n"
+      "\n"
+      "}  // end of anonymous namespace\n"
+      "\n");
+  generateDecoderSignature();
+  puts(
+      " {\n"
+      "  Decoder Dec(ReadPos, WritePos, MinimizeBlockSize);\n"
+      "  return Dec.run();\n");
+  generateFunctionFooter();
+  generateExitNamespaces();
+}
+
 std::shared_ptr<SymbolTable> readCasmFile(const char* Filename,
                                           bool TraceLexer,
                                           bool TraceParser) {
@@ -867,6 +1803,7 @@ int main(int Argc, charstring Argv[]) {
   bool TraceParser = false;
   bool Verbose = false;
   bool HeaderFile = false;
+  bool GenerateDecoder = false;
 
 #if WASM_CAST_BOOT > 1
   bool BitCompress = true;
@@ -888,6 +1825,13 @@ int main(int Argc, charstring Argv[]) {
                      "Use algorithm in ALGORITHM file "
                      "to parse text file"));
 
+    ArgsParser::Optional<bool> GenerateDecoderFlag(GenerateDecoder);
+    Args.add(GenerateDecoderFlag.setLongName("decoder").setDescription(
+        "Generate c++ source code to implement a function 'bool "
+        "decodeNAME(BitReadCursor&, BitWriteCursor&, bool)' that directly "
+        "decodes input using the INPUT cast algorithm (only applies when "
+        "'--function NAME' is specified)"));
+
     ArgsParser::Optional<bool> ExpectFailFlag(ExpectExitFail);
     Args.add(ExpectFailFlag.setDefault(false)
 
@@ -1029,6 +1973,11 @@ int main(int Argc, charstring Argv[]) {
       StripLiterals = true;
     }
 
+    if (GenerateDecoder && FunctionName == nullptr) {
+      fprintf(stderr, "Option --decoder can't be used without option -f\n");
+      return exit_status(EXIT_FAILURE);
+    }
+
 #if WASM_CAST_BOOT > 1
     // Be sure to update implications!
     if (TraceTree)
@@ -1040,6 +1989,11 @@ int main(int Argc, charstring Argv[]) {
       return exit_status(EXIT_FAILURE);
     }
 
+    if (UseArrayImpl && GenerateDecoder) {
+      fprintf(stderr, "Option --array can't be used with option --decoder\n");
+      return exit_status(EXIT_FAILURE);
+    }
+
     if (UseArrayImpl && HeaderFile) {
       fprintf(stderr, "Opition --array can't be used with option --header\n");
       return exit_status(EXIT_FAILURE);
@@ -1146,7 +2100,12 @@ int main(int Argc, charstring Argv[]) {
   Namespaces.push_back("decode");
   CodeGenerator Generator(InputFilename, Output, InputSymtab, Namespaces,
                           FunctionName);
-  if (HeaderFile)
+  if (GenerateDecoder) {
+    if (HeaderFile)
+      Generator.generateDecoderDeclFile();
+    else
+      Generator.generateDecoderImplFile();
+  } else if (HeaderFile)
     Generator.generateDeclFile();
   else {
 #if WASM_CAST_BOOT > 1
@@ -18,10 +18,13 @@
 #include "intcomp/IntCompress.h"
 #include "stream/FileReader.h"
 #include "stream/FileWriter.h"
+#include "stream/MmapQueue.h"
 #include "stream/ReadBackedQueue.h"
 #include "stream/WriteBackedQueue.h"
 #include "utils/ArgsParse.h"
 
+#include <sys/stat.h>
+
 using namespace wasm;
 using namespace wasm::decode;
 using namespace wasm::filt;
@@ -35,6 +38,21 @@ std::shared_ptr<RawStream> getInput() {
   return std::make_shared<FileReader>(InputFilename);
 }
 
+// Returns the queue to compress. Regular files are memory mapped, while stdin
+// and pipes are read.
+std::shared_ptr<Queue> getInputQueue() {
+  auto Mapped = std::make_shared<MmapQueue>(InputFilename);
+  if (Mapped->isGood())
+    return Mapped;
+  return std::make_shared<ReadBackedQueue>(getInput());
+}
+
+// Returns true if the input is a regular file (and hence can be read again).
+bool isInputRegularFile() {
+  struct stat Stat;
+  return stat(InputFilename, &Stat) == 0 && S_ISREG(Stat.st_mode);
+}
+
 std::shared_ptr<RawStream> getOutput() {
   return std::make_shared<FileWriter>(OutputFilename);
 }
@@ -159,6 +177,45 @@ int main(int Argc, const char* Argv[]) {
                      "Toggles removing patterns if already implied by previous "
                      "patterns"));
 
+    ArgsParser::Optional<size_t> NumThreadsFlag(MyCompressionFlags.NumThreads);
+    Args.add(NumThreadsFlag.setLongName("threads")
+                 .setOptionName("N")
+                 .setDescription(
+                     "Use N threads to collect integer sequence counts"));
+
+    ArgsParser::Optional<bool> UseSuffixArrayFlag(
+        MyCompressionFlags.UseSuffixArray);
+    Args.add(UseSuffixArrayFlag.setLongName("suffix-array")
+                 .setDescription(
+                     "Find integer sequences using a suffix array, allowing "
+                     "much larger values of 'max-length' (only applies when "
+                     "'min-count' is at least 2)"));
+
+    ArgsParser::Optional<bool> OptimalAbbrevSelectionFlag(
+        MyCompressionFlags.OptimalAbbrevSelection);
+    Args.add(OptimalAbbrevSelectionFlag.setLongName("optimal-select")
+                 .setDescription(
+                     "Select the abbreviations for each window that use the "
+                     "fewest bits (rather than a heuristic search)"));
+
+    ArgsParser::Optional<size_t> SampleSizeFlag(MyCompressionFlags.SampleSize);
+    Args.add(SampleSizeFlag.setLongName("sample")
+                 .setOptionName("N")
+                 .setDescription(
+                     "Only collect integer sequence counts on the first N "
+                     "integers of the input, and then stream the input through "
+                     "the abbreviation selector (input must be a file)"));
+
+    ArgsParser::Optional<size_t> ChunkSizeFlag(MyCompressionFlags.ChunkSize);
+    Args.add(ChunkSizeFlag.setLongName("chunk")
+                 .setOptionName("N")
+                 .setDescription(
+                     "Write selected abbreviations in chunks of N values, "
+                     "rather than holding them until the end of the input. "
+                     "Abbreviations are reassigned using the first chunk, "
+                     "and the output is written as each chunk is "
+                     "selected"));
+
     ArgsParser::Optional<bool> TraceReadingInputFlag(
         MyCompressionFlags.TraceReadingInput);
     Args.add(
@@ -343,9 +400,11 @@ int main(int Argc, const char* Argv[]) {
   // TODO(karlschimpf) Fill in code here to get default algorithm if not
   // explicitly defined.
 
-  IntCompressor Compressor(std::make_shared<ReadBackedQueue>(getInput()),
+  IntCompressor Compressor(getInputQueue(),
                            std::make_shared<WriteBackedQueue>(getOutput()),
                            getAlgwasm0xdSymtab(), MyCompressionFlags);
+  if (MyCompressionFlags.SampleSize > 0 && isInputRegularFile())
+    Compressor.setInputReopener(getInputQueue);
   Compressor.compress();
 
   if (Compressor.errorsFound()) {
@@ -23,11 +23,15 @@
 #include "interp/ByteReader.h"
 #include "interp/ByteWriter.h"
 #include "interp/Interpreter.h"
+#if WASM_DECODE_NO_THREADS == 0
+#include "interp/ParallelDecompressor.h"
+#endif
 #include "casm/CasmReader.h"
 #include "stream/FileReader.h"
+#include "stream/FileWriteQueue.h"
 #include "stream/FileWriter.h"
+#include "stream/MmapQueue.h"
 #include "stream/ReadBackedQueue.h"
-#include "stream/WriteBackedQueue.h"
 #include "utils/ArgsParse.h"
 
 using namespace wasm;
@@ -43,14 +47,30 @@ std::shared_ptr<RawStream> getInput() {
   return std::make_shared<FileReader>(InputFilename);
 }
 
+// Returns the queue to decompress from, or nullptr if the input can't be
+// opened. Regular files are memory mapped (and returned in Mapped), while
+// stdin and pipes are read.
+std::shared_ptr<Queue> getInputQueue(std::shared_ptr<MmapQueue>& Mapped) {
+  Mapped = std::make_shared<MmapQueue>(InputFilename);
+  if (Mapped->isGood())
+    return Mapped;
+  Mapped.reset();
+  std::shared_ptr<RawStream> Input = getInput();
+  if (Input->hasErrors())
+    return nullptr;
+  return std::make_shared<ReadBackedQueue>(Input);
+}
+
 std::shared_ptr<RawStream> getOutput() {
   return std::make_shared<FileWriter>(OutputFilename);
 }
 
-int runUsingCApi(bool TraceProgress) {
+int runUsingCApi(bool TraceProgress, size_t NumThreads) {
   void* Decomp = create_decompressor();
   if (TraceProgress)
     set_trace_decompression(Decomp, TraceProgress);
+  if (NumThreads > 1)
+    set_decompressor_threads(Decomp, NumThreads);
   auto Input = getInput();
   auto Output = getOutput();
   constexpr int32_t MaxBufferSize = 4096;
@@ -95,6 +115,7 @@ int main(const int Argc, const char* Argv[]) {
   bool MinimizeBlockSize = false;
   bool UseCApi = false;
   size_t NumTries = 1;
+  size_t NumThreads = 1;
   InterpreterFlags InterpFlags;
   std::vector<charstring> Algorithms;
 
@@ -137,12 +158,35 @@ int main(const int Argc, const char* Argv[]) {
                      "Toggle minimizing decompressed size (rather than "
                      "conanical size)"));
 
+    ArgsParser::Toggle FastEvalFlag(InterpFlags.FastEval);
+    Args.add(FastEvalFlag.setDefault(true)
+                 .setLongName("fast-eval")
+                 .setDescription(
+                     "Toggle evaluating leaf nodes without pushing "
+                     "interpreter call frames"));
+
+    ArgsParser::Toggle ThreadedEvalFlag(InterpFlags.ThreadedEval);
+    Args.add(ThreadedEvalFlag.setDefault(true)
+                 .setLongName("threaded-eval")
+                 .setDescription(
+                     "Toggle lowering define bodies to threaded code, "
+                     "rather than evaluating them node by node"));
+
     ArgsParser::Optional<size_t> NumTriesFlag(NumTries);
     Args.add(
         NumTriesFlag.setLongName("tries").setOptionName("N").setDescription(
             "Decompress N times (used to test performance "
             "when N!=1)"));
 
+    ArgsParser::Optional<size_t> NumThreadsFlag(NumThreads);
+    Args.add(NumThreadsFlag.setLongName("threads")
+                 .setOptionName("N")
+                 .setDescription(
+                     "Decompress sections of WASM (0xd) and compressed "
+                     "(casm) files using N threads. Other input, and input "
+                     "that isn't a regular file, is decompressed "
+                     "sequentially"));
+
     ArgsParser::Toggle VerboseFlag(Verbose);
     Args.add(VerboseFlag.setShortName('v')
                  .setLongName("verbose")
@@ -182,7 +226,7 @@ int main(const int Argc, const char* Argv[]) {
       fprintf(stderr, "-t and --c-api options not allowed");
       return exit_status(EXIT_FAILURE);
     }
-    return exit_status(runUsingCApi(Verbose >= 1));
+    return exit_status(runUsingCApi(Verbose >= 1, NumThreads));
   }
 
   std::vector<std::shared_ptr<SymbolTable>> AdditionalAlgorithms;
@@ -203,27 +247,77 @@ int main(const int Argc, const char* Argv[]) {
   for (size_t i = 0; i < NumTries; ++i) {
     if (Verbose)
       fprintf(stderr, "Opening input file: %s\n", InputFilename);
-    std::shared_ptr<RawStream> Input = getInput();
-    if (Input->hasErrors()) {
+    std::shared_ptr<MmapQueue> Mapped;
+    std::shared_ptr<Queue> Input = getInputQueue(Mapped);
+    if (!Input) {
       fprintf(stderr, "Problems opening %s!\n", InputFilename);
       return exit_status(EXIT_SUCCESS);
     }
     if (Verbose)
       fprintf(stderr, "Opening output file: %s\n", OutputFilename);
-    std::shared_ptr<RawStream> Output = getOutput();
-    if (Output->hasErrors()) {
+    auto BackedOutput = std::make_shared<FileWriteQueue>(OutputFilename);
+    if (!BackedOutput->isGood()) {
       fprintf(stderr, "Problems opening %s!\n", OutputFilename);
       return exit_status(EXIT_SUCCESS);
     }
+#if WASM_DECODE_NO_THREADS == 0
+    // Only mapped files are split, since the sections are found by scanning
+    // the whole input.
+    bool UseThreads = NumThreads > 1;
+    if (UseThreads && !Mapped) {
+      if (i == 0)
+        fprintf(stderr,
+                "Warning: --threads needs a regular input file, decompressing "
+                "%s sequentially\n",
+                InputFilename);
+      UseThreads = false;
+    }
+    if (UseThreads && !ParallelDecompressor::canSplit(
+                          Mapped->getContents(), Mapped->getContentsSize())) {
+      if (i == 0)
+        fprintf(stderr,
+                "Warning: --threads only applies to WASM (0xd) and casm input, "
+                "decompressing %s sequentially\n",
+                InputFilename);
+      UseThreads = false;
+    }
+    if (UseThreads) {
+      if (Verbose)
+        fprintf(stderr, "Decompressing using %" PRIuMAX " threads...\n",
+                uintmax_t(NumThreads));
+      ParallelDecompressor Parallel(InterpFlags);
+      for (std::shared_ptr<SymbolTable> Symtab : AdditionalAlgorithms)
+        Parallel.addAlgorithm(Symtab);
+      Parallel.addAlgorithm(getAlgcasm0x0Symtab());
+      Parallel.addAlgorithm(getAlgwasm0xdSymtab());
+      Parallel.addAlgorithm(getAlgcism0x0Symtab());
+      Parallel.setNumThreads(NumThreads);
+      Parallel.setMinimizeBlockSize(MinimizeBlockSize);
+      if (Parallel.decompress(Mapped->getContents(),
+                              Mapped->getContentsSize(), BackedOutput)) {
+        if (!BackedOutput->flush()) {
+          fprintf(stderr, "Unable to write %s!\n", OutputFilename);
+          Succeeded = false;
+        }
+        continue;
+      }
+      if (Parallel.errorsFound()) {
+        fatal("Failed to decompress due to errors!");
+        Succeeded = false;
+        continue;
+      }
+      // Not splittable into sections, so decompress sequentially (reporting
+      // any errors).
+      if (Verbose)
+        fprintf(stderr, "Unable to decompress in parallel\n");
+    }
+#endif
     if (Verbose)
       fprintf(stderr, "Decompressing...\n");
     // Create input, output, and decompressor.
-    std::shared_ptr<Queue> BackedOutput =
-        std::make_shared<WriteBackedQueue>(Output);
     auto Writer = std::make_shared<ByteWriter>(BackedOutput);
-    Interpreter Decompressor(
-        std::make_shared<ByteReader>(std::make_shared<ReadBackedQueue>(Input)),
-        Writer, InterpFlags);
+    InterpreterT<ByteReader, ByteWriter> Decompressor(
+        std::make_shared<ByteReader>(Input), Writer, InterpFlags);
     auto AlgState = std::make_shared<DecompAlgState>(&Decompressor);
     // Add additional algorithms first, so that they can override.
     for (std::shared_ptr<SymbolTable> Symtab : AdditionalAlgorithms) {
@@ -249,6 +343,10 @@ int main(const int Argc, const char* Argv[]) {
       fatal("Failed to decompress due to errors!");
       Succeeded = false;
     }
+    if (!BackedOutput->flush()) {
+      fprintf(stderr, "Unable to write %s!\n", OutputFilename);
+      Succeeded = false;
+    }
   }
   return exit_status(Succeeded ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -180,7 +180,8 @@ AbbrevAssignWriter::AbbrevAssignWriter(
     size_t BufSize,
     bool AssumeByteAlignment,
     const CompressionFlags& MyFlags)
-    : Writer(false),
+    // Note: Other actions (i.e. callbacks) are not part of the integer stream.
+    : Writer(true),
       MyFlags(MyFlags),
       Root(Root),
       Assignments(Assignments),
@@ -188,7 +189,8 @@ AbbrevAssignWriter::AbbrevAssignWriter(
       OutWriter(Output),
       Buffer(BufSize),
       AssumeByteAlignment(AssumeByteAlignment),
-      ProgressCount(0) {
+      ProgressCount(0),
+      NumFlushedValues(0) {
   assert(Root->getDefaultSingle()->hasAbbrevIndex());
   assert(Root->getDefaultMultiple()->hasAbbrevIndex());
 }
@@ -237,7 +239,7 @@ StreamType AbbrevAssignWriter::getStreamType() const {
 
 bool AbbrevAssignWriter::writeVaruint64(uint64_t Value) {
   bufferValue(Value);
-  return true;
+  return flushChunkIfFull();
 }
 
 void AbbrevAssignWriter::alignIfNecessary() {
@@ -250,10 +252,10 @@ bool AbbrevAssignWriter::writeFreezeEof() {
   writeUntilBufferEmpty();
   flushDefaultValues();
   alignIfNecessary();
-  return flushValues();
+  return flushValues(true) && OutWriter.writeFreezeEof();
 }
 
-void AbbrevAssignWriter::reassignAbbreviations() {
+void AbbrevAssignWriter::reassignAbbreviations(bool KeepUnused) {
   TRACE_METHOD("reassignAbbreviations");
   // First clear usage counts.
   CountNode::PtrVector Abbrevs;
@@ -268,22 +270,30 @@ void AbbrevAssignWriter::reassignAbbreviations() {
       Val->getAbbreviation()->increment();
   // Now do the assignments.
   Assignments.clear();
-  for (CountNode::Ptr& Nd : Abbrevs)
+  for (CountNode::Ptr& Nd : Abbrevs) {
+    if (KeepUnused && Nd->getCount() == 0)
+      // Not used yet, but may be used by values not yet seen.
+      Nd->setCount(1);
     if (Nd->getCount() > 0)
       Assignments.insert(Nd);
+  }
   EncodingRoot = CountNode::assignAbbreviations(Assignments, MyFlags);
   if (!MyFlags.TraceAbbreviationAssignments)
     return;
 }
 
-bool AbbrevAssignWriter::flushValues() {
+bool AbbrevAssignWriter::flushValues(bool AtEof) {
   TRACE_MESSAGE("Flushing collected abbreviations");
-  if (MyFlags.ReassignAbbreviations)
-    reassignAbbreviations();
-  if (MyFlags.TraceAbbreviationAssignments) {
-    fprintf(stderr, "abbreviation assignments:\n");
-    fprintf(stderr, "-------------------------\n");
-    CountNode::describeNodes(stderr, Assignments);
+  if (NumFlushedValues == 0) {
+    // Abbreviation indices can't change once values have been written. Hence,
+    // when writing in chunks, reassignment is based on the first chunk.
+    if (MyFlags.ReassignAbbreviations)
+      reassignAbbreviations(!AtEof);
+    if (MyFlags.TraceAbbreviationAssignments) {
+      fprintf(stderr, "abbreviation assignments:\n");
+      fprintf(stderr, "-------------------------\n");
+      CountNode::describeNodes(stderr, Assignments);
+    }
   }
   for (AbbrevAssignValue* Value : Values) {
     TRACE_BLOCK({
@@ -312,7 +322,17 @@ bool AbbrevAssignWriter::flushValues() {
       }
     }
   }
-  return OutWriter.writeFreezeEof();
+  NumFlushedValues += Values.size();
+  clearValues();
+  return true;
+}
+
+bool AbbrevAssignWriter::flushChunkIfFull() {
+  if (MyFlags.ChunkSize == 0 || Values.size() < MyFlags.ChunkSize)
+    return true;
+  if (!flushValues(false))
+    return false;
+  return !ChunkWritten || ChunkWritten();
 }
 
 bool AbbrevAssignWriter::writeHeaderValue(decode::IntType Value,
@@ -324,14 +344,14 @@ bool AbbrevAssignWriter::writeBlockEnter() {
   writeUntilBufferEmpty();
   flushDefaultValues();
   forwardAbbrev(Root->getBlockEnter());
-  return true;
+  return flushChunkIfFull();
 }
 
 bool AbbrevAssignWriter::writeBlockExit() {
   writeUntilBufferEmpty();
   flushDefaultValues();
   forwardAbbrev(Root->getBlockExit());
-  return true;
+  return flushChunkIfFull();
 }
 
 void AbbrevAssignWriter::bufferValue(IntType Value) {
@@ -361,12 +381,14 @@ void AbbrevAssignWriter::writeFromBuffer() {
   });
   AbbrevSelector Selector(Buffer, Root, DefaultValues.size(), MyFlags);
   Selector.setTrace(getTracePtr());
-  AbbrevSelection::Ptr Sel = Selector.select();
+  AbbrevSelection::Ptr Sel = MyFlags.OptimalAbbrevSelection
+                                 ? Selector.selectOptimal()
+                                 : Selector.select();
   // Report progress...
   // TODO(karlschimp): Figure out why TRACE macro can't be used!
   if (MyFlags.TraceAbbrevSelectionProgress != 0) {
     size_t Gap = MyFlags.TraceAbbrevSelectionProgress;
-    size_t Count = Values.size();
+    size_t Count = NumFlushedValues + Values.size();
     while (Count >= ProgressCount + Gap) {
       ProgressCount += Gap;
       fprintf(stderr, "Progress: %" PRIuMAX "\n", uintmax_t(ProgressCount));
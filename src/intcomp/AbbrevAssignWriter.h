@@ -19,6 +19,7 @@
 #ifndef DECOMPRESSOR_SRC_INTCOMP_ABBREVASSIGNWRITER_H
 #define DECOMPRESSOR_SRC_INTCOMP_ABBREVASSIGNWRITER_H
 
+#include <functional>
 #include <vector>
 
 #include "intcomp/CompressionFlags.h"
@@ -48,6 +49,10 @@ class AbbrevAssignWriter : public interp::Writer {
                      const CompressionFlags& MyFlags);
   ~AbbrevAssignWriter() OVERRIDE;
 
+  // Called after each (full) chunk of values is written to the output.
+  typedef std::function<bool()> ChunkHandler;
+  void setChunkHandler(ChunkHandler NewHandler) { ChunkWritten = NewHandler; }
+
   decode::StreamType getStreamType() const OVERRIDE;
   bool writeVaruint64(uint64_t Value) OVERRIDE;
   bool writeFreezeEof() OVERRIDE;
@@ -71,6 +76,9 @@ class AbbrevAssignWriter : public interp::Writer {
   std::vector<AbbrevAssignValue*> Values;
   bool AssumeByteAlignment;
   size_t ProgressCount;
+  // Number of values already written to OutWriter.
+  size_t NumFlushedValues;
+  ChunkHandler ChunkWritten;
 
   void bufferValue(decode::IntType Value);
   void forwardAbbrev(CountNode::Ptr Abbrev);
@@ -81,9 +89,10 @@ class AbbrevAssignWriter : public interp::Writer {
   void popValuesFromBuffer(size_t size);
   void flushDefaultValues();
   void alignIfNecessary();
-  bool flushValues();
+  bool flushValues(bool AtEof);
+  bool flushChunkIfFull();
   void clearValues();
-  void reassignAbbreviations();
+  void reassignAbbreviations(bool KeepUnused);
 
   const char* getDefaultTraceName() const OVERRIDE;
 };
@@ -19,6 +19,7 @@
 #include "intcomp/AbbrevSelector.h"
 
 #include <cassert>
+#include <limits>
 
 #ifdef NODEBUG
 
@@ -171,6 +172,15 @@ size_t AbbrevSelector::computeValueWeight(IntType Value) {
   return Formatter.getByteSize(Flags.DefaultFormat);
 }
 
+size_t AbbrevSelector::computeAbbrevBits(const CountNode* Abbrev) {
+  if (Flags.UseHuffmanEncoding) {
+    if (size_t NumBits = Abbrev->getAbbrevNumBits())
+      return NumBits;
+  }
+  IntTypeFormats Formatter(Abbrev->getAbbrevIndex());
+  return 8 * Formatter.getByteSize(Flags.AbbrevFormat);
+}
+
 AbbrevSelection::Ptr AbbrevSelector::create(CountNode::Ptr Abbreviation,
                                             AbbrevSelection::Ptr Previous,
                                             size_t LocalWeight,
@@ -328,6 +338,116 @@ AbbrevSelection::Ptr AbbrevSelector::select() {
   return Min;
 }
 
+AbbrevSelection::Ptr AbbrevSelector::selectOptimal() {
+  TRACE_METHOD("selectOptimal");
+  AbbrevSelection::Ptr Min;
+  const size_t Size = Buffer.size();
+  if (Size == 0)
+    return Min;
+
+  // The state after consuming a prefix of the buffer. Default values are
+  // written as a single default (abbreviation followed by value), or a run
+  // of defaults (abbreviation, count, and values). Hence the cost of the
+  // next default value depends on how many defaults precede it.
+  enum State { AfterPattern, AfterSingle, AfterMultiple, NumStates };
+  constexpr size_t Infinity = std::numeric_limits<size_t>::max();
+  struct Step {
+    size_t Bits;
+    // The state (and position) before the last abbreviation.
+    State Previous;
+    size_t Start;
+    CountNode* Abbrev;
+  };
+  std::vector<Step> Steps((Size + 1) * NumStates,
+                          Step{Infinity, AfterPattern, 0, nullptr});
+  auto getStep = [&](size_t Index, State St) -> Step& {
+    return Steps[Index * NumStates + St];
+  };
+  auto relax = [&](size_t Index, State St, size_t Bits, State Previous,
+                   size_t Start, CountNode* Abbrev) {
+    Step& S = getStep(Index, St);
+    if (Bits >= S.Bits)
+      return;
+    S.Bits = Bits;
+    S.Previous = Previous;
+    S.Start = Start;
+    S.Abbrev = Abbrev;
+  };
+  getStep(0, NumLeadingDefaultValues == 0
+                 ? AfterPattern
+                 : (NumLeadingDefaultValues == 1 ? AfterSingle
+                                                 : AfterMultiple))
+      .Bits = 0;
+  CountNode* DefaultSingle = Root->getDefaultSingle().get();
+  CountNode* DefaultMultiple = Root->getDefaultMultiple().get();
+  const size_t SingleBits = computeAbbrevBits(DefaultSingle);
+  constexpr size_t CounterBits = 8;
+  for (size_t i = 0; i < Size; ++i) {
+    const size_t ValueBits = 8 * computeValueWeight(Buffer[i]);
+    for (int Index = 0; Index < NumStates; ++Index) {
+      State St = State(Index);
+      size_t Bits = getStep(i, St).Bits;
+      if (Bits == Infinity)
+        continue;
+      switch (St) {
+        case AfterPattern:
+          relax(i + 1, AfterSingle, Bits + SingleBits + ValueBits, St, i,
+                DefaultSingle);
+          break;
+        case AfterSingle:
+          relax(i + 1, AfterMultiple, Bits + CounterBits + ValueBits, St, i,
+                DefaultMultiple);
+          break;
+        default:
+          relax(i + 1, AfterMultiple, Bits + ValueBits, St, i,
+                DefaultMultiple);
+          break;
+      }
+    }
+    // Note: The cost of a pattern doesn't depend on the preceding state.
+    State Best = AfterPattern;
+    for (int Index = 1; Index < NumStates; ++Index)
+      if (getStep(i, State(Index)).Bits < getStep(i, Best).Bits)
+        Best = State(Index);
+    size_t Bits = getStep(i, Best).Bits;
+    if (Bits == Infinity)
+      continue;
+    CountNode::IntPtr Nd;
+    for (size_t j = i; j < Size; ++j) {
+      Nd = Nd ? lookup(Nd, Buffer[j], false) : lookup(Root, Buffer[j], false);
+      if (!Nd)
+        break;
+      if (Nd->hasAbbrevIndex())
+        relax(j + 1, AfterPattern, Bits + computeAbbrevBits(Nd.get()), Best,
+              i, Nd.get());
+    }
+  }
+
+  // Find the best final state, and build the corresponding selection.
+  State St = AfterPattern;
+  for (int Index = 1; Index < NumStates; ++Index)
+    if (getStep(Size, State(Index)).Bits < getStep(Size, St).Bits)
+      St = State(Index);
+  std::vector<const Step*> Path;
+  for (size_t i = Size; i > 0;) {
+    const Step& S = getStep(i, St);
+    Path.push_back(&S);
+    i = S.Start;
+    St = S.Previous;
+  }
+  size_t Consumed = 0;
+  while (!Path.empty()) {
+    const Step* S = Path.back();
+    Path.pop_back();
+    Consumed += (Path.empty() ? Size : Path.back()->Start) - S->Start;
+    Min = std::make_shared<AbbrevSelection>(S->Abbrev->shared_from_this(), Min,
+                                            Consumed, S->Bits,
+                                            NextCreationIndex++);
+  }
+  TRACE_ABBREV_SELECTION("Selected min", Min);
+  return Min;
+}
+
 }  // end of namespace intcomp
 
 }  // end of namespace wasm
@@ -96,6 +96,10 @@ class AbbrevSelector {
   // Heuristically finds the best (measured by weight) abberviation selection
   // for the contents of the buffer.
   AbbrevSelection::Ptr select();
+  // Finds the selection for the contents of the buffer that uses the fewest
+  // bits, using dynamic programming over buffer positions. Takes
+  // O(buffer size * pattern length) time.
+  AbbrevSelection::Ptr selectOptimal();
 
   void setTrace(utils::TraceClass::Ptr Trace);
   utils::TraceClass::Ptr getTracePtr();
@@ -120,6 +124,7 @@ class AbbrevSelector {
 
   size_t computeAbbrevWeight(CountNode::Ptr Abbev);
   size_t computeValueWeight(decode::IntType Value);
+  size_t computeAbbrevBits(const CountNode* Abbrev);
   void createDefaults(AbbrevSelection::Ptr Previous);
   void createIntSeqMatches(AbbrevSelection::Ptr Previous);
   void createMatches(AbbrevSelection::Ptr Previous);
@@ -50,6 +50,11 @@ CompressionFlags::CompressionFlags()
       ReassignAbbreviations(true),
       DefaultFormat(IntTypeFormat::Varint64),
       LoopSizeFormat(IntTypeFormat::Varuint64),
+      NumThreads(1),
+      UseSuffixArray(false),
+      OptimalAbbrevSelection(false),
+      SampleSize(0),
+      ChunkSize(0),
       TraceHuffmanAssignments(false),
       TraceReadingInput(false),
       TraceReadingIntStream(false),
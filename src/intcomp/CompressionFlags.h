@@ -60,6 +60,21 @@ struct CompressionFlags {
   bool ReassignAbbreviations;
   interp::IntTypeFormat DefaultFormat;
   interp::IntTypeFormat LoopSizeFormat;
+  // Number of threads used to collect integer sequence counts.
+  size_t NumThreads;
+  // Collect integer sequences using a suffix array instead of a trie walk.
+  bool UseSuffixArray;
+  // Select abbreviations using dynamic programming instead of a heuristic
+  // search.
+  bool OptimalAbbrevSelection;
+  // When non-zero, only the first SampleSize integers of the input are used to
+  // collect counts, and the input is then streamed (read a second time)
+  // through the abbreviation assignment writer.
+  size_t SampleSize;
+  // When non-zero, the abbreviation assignment writer flushes its selected
+  // abbreviations every ChunkSize values, and the output is written as each
+  // chunk is flushed, rather than holding them until the end of the input.
+  size_t ChunkSize;
 
   interp::InterpreterFlags MyInterpFlags;
 
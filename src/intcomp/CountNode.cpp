@@ -126,6 +126,12 @@ decode::IntType CountNode::getAbbrevIndex() const {
   return AbbrevSymbol->getPath();
 }
 
+size_t CountNode::getAbbrevNumBits() const {
+  if (!AbbrevSymbol)
+    return 0;
+  return AbbrevSymbol->getNumBits();
+}
+
 bool CountNode::hasAbbrevIndex() const {
   return bool(AbbrevSymbol);
 }
@@ -149,7 +155,7 @@ CountNode::IntPtr lookup(CountNode::RootPtr Root,
     return CountNode::IntPtr();
 
   Succ = std::make_shared<SingletonCountNode>(Value);
-  Root->Successors[Value] = Succ;
+  Root->Successors.insert(Value, Succ);
   return Succ;
 }
 
@@ -164,7 +170,7 @@ CountNode::IntPtr lookup(CountNode::IntPtr Nd,
     return CountNode::IntPtr();
 
   Succ = std::make_shared<IntSeqCountNode>(Value, Nd);
-  Nd->Successors[Value] = Succ;
+  Nd->Successors.insert(Value, Succ);
   return Succ;
 }
 
@@ -219,9 +225,7 @@ CountNodeWithSuccs::~CountNodeWithSuccs() {
 }
 
 CountNode::IntPtr CountNodeWithSuccs::getSucc(IntType Value) {
-  if (Successors.count(Value))
-    return Successors[Value];
-  return CountNode::IntPtr();
+  return Successors.find(Value);
 }
 
 bool CountNodeWithSuccs::implementsClass(Kind K) {
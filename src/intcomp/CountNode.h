@@ -24,6 +24,7 @@
 #include <set>
 
 #include "intcomp/CompressionFlags.h"
+#include "intcomp/SuccessorMap.h"
 #include "utils/heap.h"
 #include "utils/HuffmanEncoding.h"
 
@@ -57,7 +58,7 @@ class CountNode : public std::enable_shared_from_this<CountNode> {
   typedef std::weak_ptr<IntCountNode> ParentPtr;
   typedef std::shared_ptr<RootCountNode> RootPtr;
   typedef std::shared_ptr<CountNodeWithSuccs> WithSuccsPtr;
-  typedef std::map<decode::IntType, CountNode::IntPtr> SuccMap;
+  typedef SuccessorMap SuccMap;
   typedef std::vector<Ptr> PtrVector;
   typedef std::set<Ptr> PtrSet;
   typedef std::map<size_t, Ptr> Int2PtrMap;
@@ -35,7 +35,7 @@ namespace intcomp {
 // the frequency usage of each integer in the input. The second time,
 // "UpToSize" defines the maximumal sequence of integers it should
 // collect on.
-class CountWriter : public interp::Writer {
+class CountWriter FINAL : public interp::Writer {
   CountWriter() = delete;
   CountWriter(const CountWriter&) = delete;
   CountWriter& operator=(const CountWriter&) = delete;
@@ -56,6 +56,8 @@ class CountWriter : public interp::Writer {
   size_t getUpToSize() const { return UpToSize; }
 
   void addToUsageMap(decode::IntType Value);
+  // Forgets the preceding values (i.e. as if a block was entered/exited).
+  void clearFrontier() { Frontier.clear(); }
 
   decode::StreamType getStreamType() const OVERRIDE;
   bool writeVaruint64(uint64_t Value) OVERRIDE;
@@ -23,15 +23,21 @@
 #include "intcomp/AbbreviationsCollector.h"
 #include "intcomp/CountWriter.h"
 #include "intcomp/RemoveNodesVisitor.h"
+#include "intcomp/SuffixArray.h"
 #include "interp/ByteReader.h"
 #include "interp/ByteWriter.h"
 #include "interp/Interpreter.h"
-#include "interp/IntInterpreter.h"
+#include "interp/IntInterpreter-templates.h"
 #include "interp/IntReader.h"
+#include "interp/IntWriter.h"
 #include "casm/CasmWriter.h"
 #include "sexp/TextWriter.h"
 #include "utils/ArgsParse.h"
 
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
 namespace wasm {
 
 using namespace decode;
@@ -42,6 +48,92 @@ using namespace wasm;
 
 namespace intcomp {
 
+namespace {
+
+// Counts the values between each pair of consecutive block boundaries in
+// [Begin, End).
+void countRuns(CountWriter& Writer,
+               const IntStream& Contents,
+               const size_t* Begin,
+               const size_t* End) {
+  if (Begin == End)
+    return;
+  IntStream::ValueReader Values(Contents, *Begin);
+  for (const size_t* Boundary = Begin; Boundary + 1 < End; ++Boundary) {
+    Writer.clearFrontier();
+    for (size_t i = Boundary[0]; i < Boundary[1]; ++i)
+      Writer.addToUsageMap(Values.read());
+  }
+}
+
+// Adds the counts of trie From to trie To.
+void addCounts(CountNode::IntPtr To, const CountNode::IntPtr& From) {
+  To->increment(From->getCount());
+  for (const auto& Pair : *From)
+    addCounts(lookup(To, Pair.first), Pair.second);
+}
+
+// Writes the first Limit integers of the input into an integer stream. Blocks
+// entered after the limit has been reached are dropped, while blocks already
+// open are closed when exited.
+class SampleWriter : public Writer {
+  SampleWriter() = delete;
+  SampleWriter(const SampleWriter&) = delete;
+  SampleWriter& operator=(const SampleWriter&) = delete;
+
+ public:
+  SampleWriter(std::shared_ptr<IntStream> Output, size_t Limit)
+      : Writer(true),
+        OutWriter(Output),
+        Limit(Limit),
+        NumValues(0),
+        SkippedDepth(0) {}
+  ~SampleWriter() OVERRIDE {}
+
+  StreamType getStreamType() const OVERRIDE { return StreamType::Int; }
+
+  bool writeVaruint64(uint64_t Value) OVERRIDE {
+    if (NumValues >= Limit)
+      return true;
+    ++NumValues;
+    return OutWriter.writeVaruint64(Value);
+  }
+
+  bool writeBlockEnter() OVERRIDE {
+    if (NumValues >= Limit) {
+      ++SkippedDepth;
+      return true;
+    }
+    return OutWriter.writeBlockEnter();
+  }
+
+  bool writeBlockExit() OVERRIDE {
+    if (SkippedDepth > 0) {
+      --SkippedDepth;
+      return true;
+    }
+    return OutWriter.writeBlockExit();
+  }
+
+  bool writeFreezeEof() OVERRIDE { return OutWriter.writeFreezeEof(); }
+
+  bool writeHeaderValue(IntType Value, IntTypeFormat Format) OVERRIDE {
+    return OutWriter.writeHeaderValue(Value, Format);
+  }
+
+  bool writeHeaderClose() OVERRIDE { return OutWriter.writeHeaderClose(); }
+
+ private:
+  IntWriter OutWriter;
+  const size_t Limit;
+  size_t NumValues;
+  size_t SkippedDepth;
+
+  const char* getDefaultTraceName() const OVERRIDE { return "SampleWriter"; }
+};
+
+}  // end of anonymous namespace
+
 IntCompressor::IntCompressor(std::shared_ptr<decode::Queue> Input,
                              std::shared_ptr<decode::Queue> Output,
                              std::shared_ptr<filt::SymbolTable> Symtab,
@@ -73,13 +165,20 @@ CountNode::RootPtr IntCompressor::getRoot() {
 
 void IntCompressor::readInput() {
   Contents = std::make_shared<IntStream>();
-  auto MyWriter = std::make_shared<IntWriter>(Contents);
-  Interpreter MyReader(std::make_shared<ByteReader>(Input), MyWriter,
-                       MyFlags.MyInterpFlags, Symtab);
+  auto MyInput = std::make_shared<ByteReader>(Input);
+  std::unique_ptr<Interpreter> MyReader;
+  if (MyFlags.SampleSize > 0)
+    MyReader.reset(new Interpreter(
+        MyInput, std::make_shared<SampleWriter>(Contents, MyFlags.SampleSize),
+        MyFlags.MyInterpFlags, Symtab));
+  else
+    MyReader.reset(new InterpreterT<ByteReader, IntWriter>(
+        MyInput, std::make_shared<IntWriter>(Contents), MyFlags.MyInterpFlags,
+        Symtab));
   if (MyFlags.TraceReadingInput)
-    MyReader.getTrace().setTraceProgress(true);
-  MyReader.algorithmRead();
-  bool Successful = MyReader.isFinished() && MyReader.isSuccessful();
+    MyReader->getTrace().setTraceProgress(true);
+  MyReader->algorithmRead();
+  bool Successful = MyReader->isFinished() && MyReader->isSuccessful();
   if (!Successful)
     ErrorsFound = true;
   Input.reset();
@@ -98,22 +197,49 @@ const BitWriteCursor IntCompressor::writeCodeOutput(
       .writeBinary(Symtab, Output);
 }
 
-void IntCompressor::writeDataOutput(const BitWriteCursor& StartPos,
+void IntCompressor::startDataOutput(const BitWriteCursor& StartPos,
                                     std::shared_ptr<SymbolTable> Symtab) {
-  TRACE_METHOD("writeDataOutput");
+  TRACE_METHOD("startDataOutput");
   auto Writer = std::make_shared<ByteWriter>(Output);
   Writer->setPos(StartPos);
-  Interpreter MyReader(std::make_shared<IntReader>(IntOutput), Writer,
-                       MyFlags.MyInterpFlags, Symtab);
+  DataReader = std::make_shared<IntReader>(IntOutput);
+  DataWriter.reset(
+      new Interpreter(DataReader, Writer, MyFlags.MyInterpFlags, Symtab));
   if (MyFlags.TraceWritingDataOutput)
-    MyReader.getTrace().setTraceProgress(true);
-  MyReader.useFileHeader(Symtab->getTargetHeader());
-  MyReader.algorithmStart();
-  MyReader.algorithmReadBackFilled();
-  bool Successful = MyReader.isFinished() && MyReader.isSuccessful();
-  if (!Successful)
+    DataWriter->getTrace().setTraceProgress(true);
+  DataWriter->useFileHeader(Symtab->getTargetHeader());
+  DataWriter->algorithmStart();
+}
+
+bool IntCompressor::startOutput(CountNode::PtrSet& Assignments) {
+  TRACE_MESSAGE("Appending compression algorithm to output");
+  const BitWriteCursor Pos =
+      writeCodeOutput(generateCodeForReading(Assignments));
+  if (errorsFound()) {
+    fprintf(stderr, "Unable to compress, output malformed\n");
+    return false;
+  }
+  TRACE(size_t, "Pos after code", Pos.getAddress());
+  TRACE_MESSAGE("Appending compressed WASM file to output");
+  startDataOutput(Pos, generateCodeForWriting(Assignments));
+  return true;
+}
+
+bool IntCompressor::writeOutputChunk(CountNode::PtrSet& Assignments) {
+  // Abbreviations can't change once the first chunk is written, so the
+  // algorithm can be written with it.
+  if (!DataWriter && !startOutput(Assignments))
+    return false;
+  DataWriter->algorithmResume();
+  if (DataWriter->errorsFound()) {
     ErrorsFound = true;
-  return;
+    fprintf(stderr, "Unable to compress, output malformed\n");
+    return false;
+  }
+  // Written values are no longer needed, unless the stream is traced.
+  if (!MyFlags.TraceCompressedIntOutput)
+    DataReader->releaseReadValues();
+  return true;
 }
 
 IntCompressor::~IntCompressor() {
@@ -127,18 +253,188 @@ bool IntCompressor::compressUpToSize(size_t Size) {
       TRACE_MESSAGE("Collecting integer sequences of (up to) length: " +
                     std::to_string(Size));
   });
+  if (Size > 1 && MyFlags.UseSuffixArray && MyFlags.CountCutoff >= 2 &&
+      !MyFlags.TraceReadingIntStream) {
+    countSequencesUsingSuffixArray(Size);
+    return true;
+  }
+  if (MyFlags.NumThreads > 1 && !MyFlags.TraceReadingIntStream) {
+    compressUpToSizeInParallel(Size);
+    return true;
+  }
   auto Writer = std::make_shared<CountWriter>(getRoot());
   Writer->setCountCutoff(MyFlags.CountCutoff);
   Writer->setUpToSize(Size);
 
-  IntInterpreter Reader(std::make_shared<IntReader>(Contents), Writer,
-                        MyFlags.MyInterpFlags, Symtab);
+  IntInterpreterT<CountWriter> Reader(std::make_shared<IntReader>(Contents),
+                                      Writer, MyFlags.MyInterpFlags, Symtab);
   if (MyFlags.TraceReadingIntStream)
     Reader.getTrace().setTraceProgress(true);
   Reader.structuralRead();
   return !Reader.errorsFound();
 }
 
+size_t IntCompressor::getBlockBoundaries(std::vector<size_t>& Boundaries) {
+  size_t NumValues = Contents->size();
+  Boundaries.push_back(0);
+  size_t NumBlocks = 0;
+  for (auto Iter = Contents->getBlocksBegin(), End = Contents->getBlocksEnd();
+       Iter != End; ++Iter) {
+    Boundaries.push_back(Iter->getBeginIndex());
+    Boundaries.push_back(std::min(Iter->getEndIndex(), NumValues));
+    ++NumBlocks;
+  }
+  Boundaries.push_back(NumValues);
+  std::sort(Boundaries.begin(), Boundaries.end());
+  Boundaries.erase(std::unique(Boundaries.begin(), Boundaries.end()),
+                   Boundaries.end());
+  return NumBlocks;
+}
+
+void IntCompressor::compressUpToSizeInParallel(size_t Size) {
+  // CountWriter forgets preceding values whenever a block is entered or
+  // exited. Hence, the values between block boundaries can be counted
+  // independently, and the counts added up afterwards.
+  getRoot();
+  const IntStream& Values = *Contents;
+  std::vector<size_t> Boundaries;
+  size_t NumBlocks = getBlockBoundaries(Boundaries);
+
+  // Partition the boundaries so that each thread counts (roughly) the same
+  // number of values.
+  size_t NumThreads = MyFlags.NumThreads;
+  size_t PartitionSize = (Values.size() + NumThreads - 1) / NumThreads;
+  std::vector<size_t> Cuts;
+  Cuts.push_back(0);
+  for (size_t i = 1; i + 1 < Boundaries.size(); ++i) {
+    if (Boundaries[i] - Boundaries[Cuts.back()] >= PartitionSize)
+      Cuts.push_back(i);
+  }
+  Cuts.push_back(Boundaries.size() - 1);
+
+  // Each thread counts into its own trie. Integers are seeded with the
+  // counts collected so far, since they define which sequences are counted.
+  std::vector<CountNode::RootPtr> Roots;
+  std::vector<std::thread> Threads;
+  for (size_t i = 0; i + 1 < Cuts.size(); ++i) {
+    Roots.push_back(std::make_shared<RootCountNode>());
+    CountNode::RootPtr LocalRoot = Roots.back();
+    for (const auto& Pair : *Root)
+      lookup(LocalRoot, Pair.first)->setCount(Pair.second->getCount());
+    const size_t* Begin = Boundaries.data() + Cuts[i];
+    const size_t* End = Boundaries.data() + Cuts[i + 1] + 1;
+    Threads.emplace_back([this, LocalRoot, Size, &Values, Begin, End]() {
+      CountWriter Writer(LocalRoot);
+      Writer.setCountCutoff(MyFlags.CountCutoff);
+      Writer.setUpToSize(Size);
+      countRuns(Writer, Values, Begin, End);
+    });
+  }
+  for (std::thread& Thread : Threads)
+    Thread.join();
+
+  // Remove the seeded counts before merging (which changes them).
+  for (CountNode::RootPtr LocalRoot : Roots) {
+    for (const auto& Pair : *LocalRoot) {
+      if (CountNode::IntPtr Nd = Root->getSucc(Pair.first))
+        Pair.second->setCount(Pair.second->getCount() - Nd->getCount());
+    }
+  }
+  for (CountNode::RootPtr LocalRoot : Roots) {
+    for (const auto& Pair : *LocalRoot)
+      addCounts(lookup(Root, Pair.first), Pair.second);
+  }
+  Root->getBlockEnter()->increment(NumBlocks);
+  Root->getBlockExit()->increment(NumBlocks);
+}
+
+void IntCompressor::countSequencesUsingSuffixArray(size_t Size) {
+  // Collects the same sequences as CountWriter: sequences (of length 2 to
+  // Size) that don't cross block boundaries, and only contain integers with
+  // weight at least CountCutoff. However, only sequences used at least
+  // CountCutoff times are added, since removeAllSmallUsageCounts() removes
+  // the others anyway.
+  getRoot();
+  std::vector<size_t> Boundaries;
+  size_t NumBlocks = getBlockBoundaries(Boundaries);
+
+  // Map the integers that can appear in sequences to (dense) symbols.
+  // Everything else, including block boundaries, is replaced by a unique
+  // separator, so that no repeated sequence contains it.
+  typedef SuffixArray::IndexType SymbolType;
+  std::unordered_map<IntType, SymbolType> Symbols;
+  std::vector<IntType> SymbolValues;
+  for (const auto& Pair : *Root) {
+    if (Pair.second->getWeight() < MyFlags.CountCutoff)
+      continue;
+    Symbols[Pair.first] = SymbolType(SymbolValues.size());
+    SymbolValues.push_back(Pair.first);
+  }
+  SuffixArray::IndexVector Text;
+  SymbolType NextSeparator = SymbolType(SymbolValues.size());
+  bool AtSeparator = true;
+  auto addSeparator = [&]() {
+    if (AtSeparator)
+      return;
+    Text.push_back(NextSeparator++);
+    AtSeparator = true;
+  };
+  IntStream::ValueReader Values(*Contents);
+  for (size_t i = 0; i + 1 < Boundaries.size(); ++i) {
+    for (size_t j = Boundaries[i]; j < Boundaries[i + 1]; ++j) {
+      auto Iter = Symbols.find(Values.read());
+      if (Iter == Symbols.end()) {
+        addSeparator();
+        continue;
+      }
+      Text.push_back(Iter->second);
+      AtSeparator = false;
+    }
+    addSeparator();
+  }
+  SuffixArray Suffixes(Text, NextSeparator);
+
+  // Adds the sequences starting at Start, whose lengths are in
+  // (MinLength, MaxLength], and that are used Count times.
+  auto addSequences = [&](size_t Start, size_t MinLength, size_t MaxLength,
+                          size_t Count) {
+    if (Count < MyFlags.CountCutoff || MaxLength < 2 || MaxLength <= MinLength)
+      return;
+    CountNode::IntPtr Nd = lookup(Root, SymbolValues[Text[Start]]);
+    for (size_t Length = 2; Length <= MaxLength; ++Length) {
+      Nd = lookup(Nd, SymbolValues[Text[Start + Length - 1]]);
+      if (Length > MinLength)
+        Nd->setCount(Count);
+    }
+  };
+
+  // Walk the (implicit) tree of lcp intervals bottom up. Each interval
+  // defines the sequences (of lengths between the lcp of the enclosing
+  // interval and its lcp) that are shared by all suffixes in the interval.
+  struct Interval {
+    size_t Lcp;
+    size_t Begin;
+  };
+  std::vector<Interval> Stack;
+  Stack.push_back(Interval{0, 0});
+  for (size_t i = 1; i <= Suffixes.size(); ++i) {
+    size_t Lcp = i < Suffixes.size() ? Suffixes.getLcp(i) : 0;
+    size_t Begin = i - 1;
+    while (Lcp < Stack.back().Lcp) {
+      Interval Top = Stack.back();
+      Stack.pop_back();
+      addSequences(Suffixes.getSuffix(Top.Begin),
+                   std::max(Lcp, Stack.back().Lcp), std::min(Top.Lcp, Size),
+                   i - Top.Begin);
+      Begin = Top.Begin;
+    }
+    if (Lcp > Stack.back().Lcp)
+      Stack.push_back(Interval{Lcp, Begin});
+  }
+  Root->getBlockEnter()->increment(NumBlocks);
+  Root->getBlockExit()->increment(NumBlocks);
+}
+
 void IntCompressor::removeSmallUsageCounts(bool KeepSingletonsUsingCount,
                                            bool ZeroOutSmallNodes) {
   // NOTE: The main purpose of this method is to shrink the size of
@@ -152,6 +448,11 @@ void IntCompressor::removeSmallUsageCounts(bool KeepSingletonsUsingCount,
 
 void IntCompressor::compress() {
   TRACE_METHOD("compress");
+  if (MyFlags.SampleSize > 0 && !Reopener) {
+    fprintf(stderr, "Unable to sample input, input can't be read twice\n");
+    ErrorsFound = true;
+    return;
+  }
   TRACE_MESSAGE("Reading input");
   readInput();
   if (errorsFound()) {
@@ -202,17 +503,11 @@ void IntCompressor::compress() {
         IntOutput->getNumIntegers());
   if (MyFlags.TraceCompressedIntOutput)
     IntOutput->describe(stderr, "Output int stream");
-  TRACE_MESSAGE("Appending compression algorithm to output");
-  const BitWriteCursor Pos =
-      writeCodeOutput(generateCodeForReading(AbbrevAssignments));
-  if (errorsFound()) {
-    fprintf(stderr, "Unable to compress, output malformed\n");
+  if (!DataWriter && !startOutput(AbbrevAssignments))
     return;
-  }
-  TRACE(size_t, "Pos after code", Pos.getAddress());
-  TRACE_MESSAGE("Appending compressed WASM file to output");
-  writeDataOutput(Pos, generateCodeForWriting(AbbrevAssignments));
-  if (errorsFound()) {
+  DataWriter->algorithmReadBackFilled();
+  if (!DataWriter->isFinished() || !DataWriter->isSuccessful()) {
+    ErrorsFound = true;
     fprintf(stderr, "Unable to compress, output malformed\n");
     return;
   }
@@ -230,6 +525,21 @@ bool IntCompressor::generateIntOutput(CountNode::PtrSet& Assignments) {
       Root, Assignments, EncodingRoot, IntOutput,
       MyFlags.PatternLengthLimit * MyFlags.PatternLengthMultiplier,
       !MyFlags.UseHuffmanEncoding, MyFlags);
+  if (MyFlags.ChunkSize > 0)
+    Writer->setChunkHandler(
+        [&]() -> bool { return writeOutputChunk(Assignments); });
+  if (MyFlags.SampleSize > 0) {
+    // Counts were only collected on a sample of the input. Stream the
+    // (complete) input directly into the writer.
+    Contents.reset();
+    Interpreter MyReader(std::make_shared<ByteReader>(Reopener()), Writer,
+                         MyFlags.MyInterpFlags, Symtab);
+    if (MyFlags.TraceIntStreamGeneration)
+      MyReader.getTrace().setTraceProgress(true);
+    MyReader.algorithmRead();
+    return MyReader.isFinished() && MyReader.isSuccessful() &&
+           IntOutput->isFrozen();
+  }
   IntInterpreter Interp(std::make_shared<IntReader>(Contents), Writer,
                         MyFlags.MyInterpFlags, Symtab);
   if (MyFlags.TraceIntStreamGeneration)
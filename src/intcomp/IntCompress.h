@@ -30,8 +30,14 @@
 #include "stream/BitWriteCursor.h"
 #include "utils/HuffmanEncoding.h"
 
+#include <functional>
+
 namespace wasm {
 
+namespace interp {
+class IntReader;
+}  // end of namespace interp
+
 namespace intcomp {
 
 class IntCounterWriter;
@@ -49,6 +55,13 @@ class IntCompressor FINAL {
 
   ~IntCompressor();
 
+  // Returns a new queue that reads the input from the beginning.
+  typedef std::function<std::shared_ptr<decode::Queue>()> InputReopener;
+
+  // Defines how to read the input a second time. Required when only a sample
+  // of the input is used to collect counts.
+  void setInputReopener(InputReopener NewReopener) { Reopener = NewReopener; }
+
   bool errorsFound() const { return ErrorsFound; }
 
   std::shared_ptr<RootCountNode> getRoot();
@@ -99,14 +112,29 @@ class IntCompressor FINAL {
   std::shared_ptr<filt::SymbolTable> Symtab;
   std::shared_ptr<interp::IntStream> Contents;
   std::shared_ptr<interp::IntStream> IntOutput;
+  // Writes the data of the output, reading IntOutput.
+  std::shared_ptr<interp::IntReader> DataReader;
+  std::unique_ptr<interp::Interpreter> DataWriter;
   std::shared_ptr<utils::TraceClass> Trace;
+  InputReopener Reopener;
   bool ErrorsFound;
   void readInput();
   const decode::BitWriteCursor writeCodeOutput(
       std::shared_ptr<filt::SymbolTable> Symtab);
-  void writeDataOutput(const decode::BitWriteCursor& StartPos,
+  void startDataOutput(const decode::BitWriteCursor& StartPos,
                        std::shared_ptr<filt::SymbolTable> Symtab);
+  // Writes the algorithm, and starts writing the data after it. Returns false
+  // if unable to write the algorithm.
+  bool startOutput(CountNode::PtrSet& Assignments);
+  // Writes the data of the chunks written to IntOutput so far.
+  bool writeOutputChunk(CountNode::PtrSet& Assignments);
   bool compressUpToSize(size_t Size);
+  void compressUpToSizeInParallel(size_t Size);
+  void countSequencesUsingSuffixArray(size_t Size);
+  // Adds the (sorted) indices of the integer stream where blocks are entered
+  // or exited, including the beginning and end of the stream. Returns the
+  // number of blocks.
+  size_t getBlockBoundaries(std::vector<size_t>& Boundaries);
   void removeSmallUsageCounts(bool KeepSingletonsUsingCount,
                               bool ZeroOutSmallNodes);
   void removeSmallSingletonUsageCounts() {
@@ -0,0 +1,150 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Implements the map from integer values to the successors of a count node.
+
+#include "intcomp/SuccessorMap.h"
+
+#include <algorithm>
+
+namespace wasm {
+
+using namespace decode;
+
+namespace intcomp {
+
+namespace {
+
+// Maximum number of entries searched linearly.
+constexpr size_t MaxLinearSize = 8;
+
+size_t getHash(IntType Value) {
+  return size_t((uint64_t(Value) * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+}  // end of anonymous namespace
+
+SuccessorMap::SuccessorMap() : NumErased(0), IsSorted(true) {
+}
+
+SuccessorMap::~SuccessorMap() {
+}
+
+size_t SuccessorMap::findIndex(IntType Value) const {
+  if (Slots.empty()) {
+    for (size_t i = 0; i < Entries.size(); ++i)
+      if (Entries[i].first == Value)
+        return i;
+    return Entries.size();
+  }
+  size_t Mask = Slots.size() - 1;
+  for (size_t Slot = getHash(Value) & Mask; Slots[Slot] != 0;
+       Slot = (Slot + 1) & Mask) {
+    size_t Index = Slots[Slot] - 1;
+    if (Entries[Index].first == Value)
+      return Index;
+  }
+  return Entries.size();
+}
+
+SuccessorMap::SuccPtr SuccessorMap::find(IntType Value) const {
+  size_t Index = findIndex(Value);
+  if (Index == Entries.size())
+    return SuccPtr();
+  return Entries[Index].second;
+}
+
+void SuccessorMap::insert(IntType Value, SuccPtr Succ) {
+  size_t Index = findIndex(Value);
+  if (Index < Entries.size()) {
+    // Reuse the erased entry.
+    assert(!Entries[Index].second);
+    Entries[Index].second = std::move(Succ);
+    --NumErased;
+    return;
+  }
+  if (IsSorted && !Entries.empty() && Entries.back().first > Value)
+    IsSorted = false;
+  Entries.emplace_back(Value, std::move(Succ));
+  if (Entries.size() <= MaxLinearSize)
+    return;
+  if (Entries.size() * 2 > Slots.size())
+    rehash();
+  else
+    addSlot(Index);
+}
+
+void SuccessorMap::erase(IntType Value) {
+  // Note: The entry is removed the next time the map is iterated over.
+  size_t Index = findIndex(Value);
+  if (Index == Entries.size() || !Entries[Index].second)
+    return;
+  Entries[Index].second.reset();
+  ++NumErased;
+}
+
+void SuccessorMap::clear() {
+  Entries.clear();
+  Slots.clear();
+  NumErased = 0;
+  IsSorted = true;
+}
+
+void SuccessorMap::addSlot(size_t Index) const {
+  size_t Mask = Slots.size() - 1;
+  size_t Slot = getHash(Entries[Index].first) & Mask;
+  while (Slots[Slot] != 0)
+    Slot = (Slot + 1) & Mask;
+  Slots[Slot] = uint32_t(Index + 1);
+}
+
+void SuccessorMap::rehash() const {
+  Slots.clear();
+  if (Entries.size() <= MaxLinearSize)
+    return;
+  size_t Size = 1;
+  while (Size < Entries.size() * 4)
+    Size <<= 1;
+  Slots.resize(Size, 0);
+  for (size_t i = 0; i < Entries.size(); ++i)
+    addSlot(i);
+}
+
+void SuccessorMap::compact() const {
+  if (NumErased == 0 && IsSorted)
+    return;
+  if (NumErased) {
+    Entries.erase(std::remove_if(Entries.begin(), Entries.end(),
+                                 [](const EntryType& Entry) {
+                                   return !Entry.second;
+                                 }),
+                  Entries.end());
+    NumErased = 0;
+  }
+  if (!IsSorted) {
+    std::sort(Entries.begin(), Entries.end(),
+              [](const EntryType& E1, const EntryType& E2) {
+                return E1.first < E2.first;
+              });
+    IsSorted = true;
+  }
+  rehash();
+}
+
+}  // end of namespace intcomp
+
+}  // end of namespace wasm
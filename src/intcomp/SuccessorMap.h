@@ -0,0 +1,91 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Defines the map from integer values to the successors of a count node.
+//
+// Most count nodes have only a few successors, so successors are kept in a
+// vector of (value, successor) pairs. Small vectors are searched linearly,
+// while larger ones are indexed by an open addressing hash table. The pairs
+// are sorted (by value) lazily, when iterated over, so that iteration order
+// is the same as a std::map.
+
+#ifndef DECOMPRESSOR_SRC_INTCOMP_SUCCESSORMAP_H
+#define DECOMPRESSOR_SRC_INTCOMP_SUCCESSORMAP_H
+
+#include "utils/Defs.h"
+
+#include <memory>
+#include <vector>
+
+namespace wasm {
+
+namespace intcomp {
+
+class IntCountNode;
+
+class SuccessorMap {
+  SuccessorMap(const SuccessorMap&) = delete;
+  SuccessorMap& operator=(const SuccessorMap&) = delete;
+
+ public:
+  typedef std::shared_ptr<IntCountNode> SuccPtr;
+  typedef std::pair<decode::IntType, SuccPtr> EntryType;
+  typedef std::vector<EntryType>::const_iterator const_iterator;
+
+  SuccessorMap();
+  ~SuccessorMap();
+
+  // Note: Iterating removes erased entries and sorts the remaining entries,
+  // invalidating existing iterators.
+  const_iterator begin() const {
+    compact();
+    return Entries.begin();
+  }
+  const_iterator end() const {
+    compact();
+    return Entries.end();
+  }
+  bool empty() const { return size() == 0; }
+  size_t size() const { return Entries.size() - NumErased; }
+
+  // Returns the successor for Value, or nullptr if not defined.
+  SuccPtr find(decode::IntType Value) const;
+  // Adds Succ as the successor for Value. Assumes Value isn't defined.
+  void insert(decode::IntType Value, SuccPtr Succ);
+  void erase(decode::IntType Value);
+  void clear();
+
+ private:
+  // Entries, some of which may have been erased (i.e. null successors).
+  mutable std::vector<EntryType> Entries;
+  // When non-empty, the hash table for Entries. Each slot holds the index
+  // (plus one) of the corresponding entry, or zero if empty.
+  mutable std::vector<uint32_t> Slots;
+  mutable size_t NumErased;
+  mutable bool IsSorted;
+
+  size_t findIndex(decode::IntType Value) const;
+  void addSlot(size_t Index) const;
+  void rehash() const;
+  void compact() const;
+};
+
+}  // end of namespace intcomp
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_INTCOMP_SUCCESSORMAP_H
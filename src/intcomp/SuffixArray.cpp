@@ -0,0 +1,104 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Implements a suffix array for a text of (small) integer symbols.
+
+#include "intcomp/SuffixArray.h"
+
+#include <algorithm>
+
+namespace wasm {
+
+namespace intcomp {
+
+SuffixArray::SuffixArray(const IndexVector& Text, IndexType AlphabetSize) {
+  const size_t Size = Text.size();
+  if (Size == 0)
+    return;
+  Suffixes.resize(Size);
+  IndexVector Rank(Text);
+  IndexVector Order(Size);
+  IndexVector Counts(std::max(size_t(AlphabetSize), Size) + 1);
+
+  // Counting sort of the suffixes (in Order) by their rank.
+  auto SortByRank = [&](size_t NumRanks) {
+    std::fill(Counts.begin(), Counts.begin() + NumRanks + 1, 0);
+    for (size_t i = 0; i < Size; ++i)
+      ++Counts[Rank[i] + 1];
+    for (size_t i = 1; i <= NumRanks; ++i)
+      Counts[i] += Counts[i - 1];
+    for (IndexType Start : Order)
+      Suffixes[Counts[Rank[Start]]++] = Start;
+  };
+
+  for (size_t i = 0; i < Size; ++i)
+    Order[i] = IndexType(i);
+  SortByRank(AlphabetSize);
+  IndexVector NewRank(Size);
+  size_t NumRanks = AlphabetSize;
+  for (size_t Width = 1;; Width <<= 1) {
+    // Order suffixes by the rank of their second half (suffixes without a
+    // second half come first), then stable sort by the rank of their first
+    // half.
+    size_t k = 0;
+    for (size_t i = Size - std::min(Width, Size); i < Size; ++i)
+      Order[k++] = IndexType(i);
+    for (IndexType Start : Suffixes)
+      if (Start >= Width)
+        Order[k++] = IndexType(Start - Width);
+    SortByRank(NumRanks);
+    // Rerank, based on both halves.
+    NewRank[Suffixes[0]] = 0;
+    for (size_t i = 1; i < Size; ++i) {
+      IndexType Prev = Suffixes[i - 1];
+      IndexType Cur = Suffixes[i];
+      bool Same = Rank[Prev] == Rank[Cur] && Prev + Width < Size &&
+                  Cur + Width < Size &&
+                  Rank[Prev + Width] == Rank[Cur + Width];
+      NewRank[Cur] = NewRank[Prev] + (Same ? 0 : 1);
+    }
+    Rank.swap(NewRank);
+    NumRanks = Rank[Suffixes[Size - 1]] + 1;
+    if (NumRanks == Size)
+      break;
+  }
+
+  // Compute the longest common prefixes (Kasai et al.). Rank is now the
+  // inverse of Suffixes.
+  Lcp.resize(Size);
+  size_t Length = 0;
+  for (size_t i = 0; i < Size; ++i) {
+    if (Rank[i] == 0) {
+      Length = 0;
+      continue;
+    }
+    size_t j = Suffixes[Rank[i] - 1];
+    while (i + Length < Size && j + Length < Size &&
+           Text[i + Length] == Text[j + Length])
+      ++Length;
+    Lcp[Rank[i]] = IndexType(Length);
+    if (Length)
+      --Length;
+  }
+}
+
+SuffixArray::~SuffixArray() {
+}
+
+}  // end of namespace intcomp
+
+}  // end of namespace wasm
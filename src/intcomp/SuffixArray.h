@@ -0,0 +1,62 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Defines a suffix array (and the corresponding longest common prefix
+// array) for a text of (small) integer symbols.
+
+#ifndef DECOMPRESSOR_SRC_INTCOMP_SUFFIXARRAY_H
+#define DECOMPRESSOR_SRC_INTCOMP_SUFFIXARRAY_H
+
+#include "utils/Defs.h"
+
+#include <vector>
+
+namespace wasm {
+
+namespace intcomp {
+
+class SuffixArray {
+  SuffixArray(const SuffixArray&) = delete;
+  SuffixArray& operator=(const SuffixArray&) = delete;
+
+ public:
+  typedef uint32_t IndexType;
+  typedef std::vector<IndexType> IndexVector;
+
+  // Builds the suffix array of Text, whose symbols must be less than
+  // AlphabetSize. Uses prefix doubling (with counting sorts), so the
+  // construction takes O(n log n) time and O(n) space.
+  SuffixArray(const IndexVector& Text, IndexType AlphabetSize);
+  ~SuffixArray();
+
+  size_t size() const { return Suffixes.size(); }
+  // Returns the start of the i-th (lexicographically smallest) suffix.
+  IndexType getSuffix(size_t i) const { return Suffixes[i]; }
+  // Returns the length of the longest common prefix of the (i-1)-th and
+  // i-th suffixes (zero for i == 0).
+  IndexType getLcp(size_t i) const { return Lcp[i]; }
+
+ private:
+  IndexVector Suffixes;
+  IndexVector Lcp;
+};
+
+}  // end of namespace intcomp
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_INTCOMP_SUFFIXARRAY_H
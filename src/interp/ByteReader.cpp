@@ -18,7 +18,11 @@
 
 #include "interp/ByteReader.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "interp/ByteReadStream.h"
+#include "interp/FormatHelpers-templates.h"
 #include "interp/ReadStream.h"
 #include "sexp/Ast.h"
 #include "utils/Casting.h"
@@ -31,6 +35,17 @@ using namespace utils;
 
 namespace interp {
 
+namespace {
+
+// Converts the (big-endian) bits read from a BitReadCursor into the
+// corresponding little-endian (fixed width) value.
+uint32_t swapBytes(uint32_t Value) {
+  return (Value >> 24) | ((Value >> 8) & 0xff00) | ((Value << 8) & 0xff0000) |
+         (Value << 24);
+}
+
+}  // end of anonymous namespace
+
 // Implemented separately so that details are not exposed to users of a
 // ByteReader.
 class ByteReader::TableHandler {
@@ -45,12 +60,16 @@ class ByteReader::TableHandler {
   bool tablePush(IntType Value) {
     TableType::iterator Iter = Table.find(Value);
     if (Iter == Table.end()) {
-      Table[Value] = Reader.ReadPos;
+      Entry& E = Table[Value];
+      Reader.ReadPos.save(E.Pos);
+      E.PinnedPage = Reader.ReadPos.getPage();
+      E.PinnedEob = Reader.ReadPos.getEobPtr();
       RestoreStack.push_back(false);
     } else {
       if (!Reader.pushPeekPos())
         return false;
-      Reader.ReadPos = Iter->second;
+      Reader.PinnedEobs.push_back(Reader.ReadPos.getEobPtr());
+      Reader.ReadPos.restore(Iter->second.Pos);
       RestoreStack.push_back(true);
     }
     return true;
@@ -70,8 +89,14 @@ class ByteReader::TableHandler {
  private:
   ByteReader& Reader;
   std::vector<bool> RestoreStack;
-  // The map of read cursors associated with table indices.
-  typedef std::map<decode::IntType, decode::BitReadCursor> TableType;
+  struct Entry {
+    decode::CursorSnapshot Pos;
+    // Keep the page and block eob of Pos alive.
+    std::shared_ptr<decode::Page> PinnedPage;
+    std::shared_ptr<decode::BlockEob> PinnedEob;
+  };
+  // The map of read positions associated with table indices.
+  typedef std::map<decode::IntType, Entry> TableType;
   TableType Table;
 };
 
@@ -80,8 +105,10 @@ ByteReader::ByteReader(std::shared_ptr<decode::Queue> StrmInput)
       ReadPos(StreamType::Byte, StrmInput),
       Input(std::make_shared<ByteReadStream>()),
       FillPos(0),
+      SavedPos(),
       SavedPosStack(SavedPos),
-      TblHandler(nullptr) {
+      TblHandler(nullptr),
+      UseBinaryDecodeTables(true) {
 }
 
 ByteReader::~ByteReader() {
@@ -131,15 +158,22 @@ bool ByteReader::atInputEof() {
 }
 
 bool ByteReader::pushPeekPos() {
-  SavedPosStack.push(ReadPos);
+  SavedPosStack.push();
+  ReadPos.save(SavedPos);
+  if (PinnedPages.empty() || PinnedPages.back().get() != SavedPos.CurPage)
+    PinnedPages.push_back(ReadPos.getPage());
   return true;
 }
 
 bool ByteReader::popPeekPos() {
   if (SavedPosStack.empty())
     return false;
-  ReadPos = SavedPos;
+  ReadPos.restore(SavedPos);
   SavedPosStack.pop();
+  if (SavedPosStack.empty()) {
+    PinnedPages.clear();
+    PinnedEobs.clear();
+  }
   return true;
 }
 
@@ -164,6 +198,8 @@ bool ByteReader::readBlockEnter() {
 bool ByteReader::readBlockExit() {
   // Force alignment before processing, in case non-byte encodings
   alignToByte();
+  if (!SavedPosStack.empty())
+    PinnedEobs.push_back(ReadPos.getEobPtr());
   ReadPos.popEobAddress();
   return true;
 }
@@ -172,7 +208,31 @@ bool ByteReader::readBinary(const Node* Eval, IntType& Value) {
   Value = 0;
   if (!isa<BinaryEvalNode>(Eval))
     return false;
-  const Node* Encoding = cast<BinaryEvalNode>(Eval)->getKid(0);
+  const auto* BinEval = cast<BinaryEvalNode>(Eval);
+  const Node* Encoding = BinEval->getKid(0);
+  if (UseBinaryDecodeTables) {
+    const auto& Tables = BinEval->getDecodeTables();
+    const auto& Entries = BinEval->getDecodeEntries();
+    size_t Index = 0;
+    while (Index < Tables.size()) {
+      const BinaryEvalNode::DecodeTable& Table = Tables[Index];
+      BitReadCursor::WordType Bits;
+      if (!ReadPos.peekBits(Table.NumBits, Bits)) {
+        // Near end of page/block, finish by reading a bit at a time.
+        Encoding = Table.Root;
+        break;
+      }
+      const BinaryEvalNode::DecodeEntry& Entry = Entries[Table.Offset + Bits];
+      if (Entry.NumBits == 0)
+        return false;
+      ReadPos.consumeBits(Entry.NumBits);
+      if (Entry.Accept) {
+        Value = Entry.Value;
+        return true;
+      }
+      Index = Entry.Value;
+    }
+  }
   while (1) {
     switch (Encoding->getType()) {
       case OpBinaryAccept:
@@ -208,33 +268,117 @@ uint8_t ByteReader::readBit() {
 }
 
 uint8_t ByteReader::readUint8() {
-  return Input->readUint8(ReadPos);
+  BitReadCursor::WordType Bits;
+  if (!ReadPos.peekBits(CHAR_BIT, Bits))
+    return Input->readUint8(ReadPos);
+  ReadPos.consumeBits(CHAR_BIT);
+  return uint8_t(Bits);
 }
 
 uint32_t ByteReader::readUint32() {
-  return Input->readUint32(ReadPos);
+  BitReadCursor::WordType Bits;
+  constexpr unsigned NumBits = sizeof(uint32_t) * CHAR_BIT;
+  if (!ReadPos.peekBits(NumBits, Bits))
+    return Input->readUint32(ReadPos);
+  ReadPos.consumeBits(NumBits);
+  return swapBytes(uint32_t(Bits));
 }
 
 uint64_t ByteReader::readUint64() {
-  return Input->readUint64(ReadPos);
+  uint64_t Low = readUint32();
+  uint64_t High = readUint32();
+  return (High << 32) | Low;
 }
 
 int32_t ByteReader::readVarint32() {
+  uint32_t Value;
+  if (const ByteType* Buffer = ReadPos.peekBytes(fmt::MaxLEB128Bytes)) {
+    if (size_t Size = fmt::decodeSignedLEB128(Buffer, Value)) {
+      ReadPos.consumeBits(Size * CHAR_BIT);
+      return int32_t(Value);
+    }
+  }
   return Input->readVarint32(ReadPos);
 }
 
 int64_t ByteReader::readVarint64() {
+  uint64_t Value;
+  if (const ByteType* Buffer = ReadPos.peekBytes(fmt::MaxLEB128Bytes)) {
+    if (size_t Size = fmt::decodeSignedLEB128(Buffer, Value)) {
+      ReadPos.consumeBits(Size * CHAR_BIT);
+      return int64_t(Value);
+    }
+  }
   return Input->readVarint64(ReadPos);
 }
 
 uint32_t ByteReader::readVaruint32() {
+  uint32_t Value;
+  if (const ByteType* Buffer = ReadPos.peekBytes(fmt::MaxLEB128Bytes)) {
+    if (size_t Size = fmt::decodeLEB128(Buffer, Value)) {
+      ReadPos.consumeBits(Size * CHAR_BIT);
+      return Value;
+    }
+  }
   return Input->readVaruint32(ReadPos);
 }
 
 uint64_t ByteReader::readVaruint64() {
+  uint64_t Value;
+  if (const ByteType* Buffer = ReadPos.peekBytes(fmt::MaxLEB128Bytes)) {
+    if (size_t Size = fmt::decodeLEB128(Buffer, Value)) {
+      ReadPos.consumeBits(Size * CHAR_BIT);
+      return Value;
+    }
+  }
   return Input->readVaruint64(ReadPos);
 }
 
+size_t ByteReader::readValues(const Node* Format,
+                              size_t Count,
+                              IntType* Values) {
+  // Note: Specialized for the common formats, so that the per-value reads are
+  // not virtual calls.
+  size_t i = 0;
+  switch (Format->getType()) {
+    case OpUint8:
+      for (; i < Count && ByteReader::stillMoreInputToProcessNow(); ++i)
+        Values[i] = ByteReader::readUint8();
+      return i;
+    case OpVaruint32:
+      for (; i < Count && ByteReader::stillMoreInputToProcessNow(); ++i)
+        Values[i] = ByteReader::readVaruint32();
+      return i;
+    case OpVaruint64:
+      for (; i < Count && ByteReader::stillMoreInputToProcessNow(); ++i)
+        Values[i] = ByteReader::readVaruint64();
+      return i;
+    default:
+      return Reader::readValues(Format, Count, Values);
+  }
+}
+
+size_t ByteReader::readBytes(uint8_t* Buffer, size_t Size) {
+  size_t Count = 0;
+  while (Count < Size && ByteReader::stillMoreInputToProcessNow() &&
+         !ReadPos.atEob()) {
+    // Note: Don't copy past FillPos, so that the reader stops where
+    // stillMoreInputToProcessNow() would.
+    size_t Available =
+        std::min(std::min(Size - Count, FillPos + 1 - ReadPos.getCurAddress()),
+                 ReadPos.getNumPeekableBytes());
+    if (Available == 0) {
+      // Not byte aligned, or at a page boundary.
+      Buffer[Count++] = ByteReader::readUint8();
+      continue;
+    }
+    memcpy(Buffer + Count, ReadPos.peekBytes(Available), Available);
+    ReadPos.consumeBits(Available * CHAR_BIT);
+    Count += Available;
+  }
+  return Count;
+}
+
 bool ByteReader::tablePush(IntType Value) {
   if (TblHandler == nullptr)
     TblHandler = new TableHandler(*this);
@@ -252,8 +396,11 @@ void ByteReader::describePeekPosStack(FILE* File) {
     return;
   fprintf(File, "*** Saved Pos Stack ***\n");
   fprintf(File, "**********************\n");
+  // Note: Whole bytes buffered in CurWord precede CurAddress.
   for (const auto& Pos : SavedPosStack.iterRange(1))
-    fprintf(File, "@%" PRIxMAX "\n", uintmax_t(Pos.getCurAddress()));
+    fprintf(File, "@%" PRIxMAX "
+",
+            uintmax_t(Pos.CurAddress - Pos.NumBits / CHAR_BIT));
   fprintf(File, "**********************\n");
 }
 
@@ -30,7 +30,7 @@ namespace interp {
 
 class ReadStream;
 
-class ByteReader : public Reader {
+class ByteReader FINAL : public Reader {
   ByteReader() = delete;
   ByteReader(const ByteReader&) = delete;
   ByteReader& operator=(const ByteReader&) = delete;
@@ -40,6 +40,11 @@ class ByteReader : public Reader {
   ~ByteReader() OVERRIDE;
   void setReadPos(const decode::BitReadCursor& ReadPos);
   decode::BitReadCursor& getPos();
+  // When true (the default), binary encodings are decoded using lookup
+  // tables, rather than a bit at a time.
+  void setUseBinaryDecodeTables(bool NewValue) {
+    UseBinaryDecodeTables = NewValue;
+  }
 
   void describePeekPosStack(FILE* Out) OVERRIDE;
   bool canProcessMoreInputNow() OVERRIDE;
@@ -64,6 +69,10 @@ class ByteReader : public Reader {
   bool readBlockEnter() OVERRIDE;
   bool readBlockExit() OVERRIDE;
   bool readBinary(const filt::Node* Encoding, decode::IntType& Value) OVERRIDE;
+  size_t readValues(const filt::Node* Format,
+                    size_t Count,
+                    decode::IntType* Values) OVERRIDE;
+  size_t readBytes(uint8_t* Buffer, size_t Size) OVERRIDE;
   bool tablePush(decode::IntType Value) OVERRIDE;
   bool tablePop() OVERRIDE;
 
@@ -79,9 +88,14 @@ class ByteReader : public Reader {
   // The input cursor position if back filling.
   decode::ReadCursor FillCursor;
   // The stack of saved read cursors.
-  decode::BitReadCursor SavedPos;
-  utils::ValueStack<decode::BitReadCursor> SavedPosStack;
+  decode::CursorSnapshot SavedPos;
+  utils::ValueStack<decode::CursorSnapshot> SavedPosStack;
+  // Pages and block eobs that saved read cursors may refer to, kept alive
+  // until the stack of saved read cursors is empty.
+  std::vector<std::shared_ptr<decode::Page>> PinnedPages;
+  std::vector<std::shared_ptr<decode::BlockEob>> PinnedEobs;
   TableHandler* TblHandler;
+  bool UseBinaryDecodeTables;
 };
 
 }  // end of namespace interp
@@ -17,9 +17,11 @@
 // Implements a byte stream writer.
 
 #include "interp/ByteWriteStream.h"
-#include "stream/ReadCursor.h"
+#include "stream/Queue.h"
 #include "stream/WriteCursor.h"
 
+#include <algorithm>
+
 namespace wasm {
 
 using namespace decode;
@@ -56,9 +58,21 @@ size_t ByteWriteStream::getBlockSize(decode::WriteCursor& StartPos,
 void ByteWriteStream::moveBlock(decode::WriteCursor& Pos,
                                 size_t StartAddress,
                                 size_t Size) {
-  ReadCursor CopyPos(Pos, StartAddress);
-  for (size_t i = 0; i < Size; ++i)
-    Pos.writeByte(CopyPos.readByte());
+  // Note: Copies a buffer (rather than a byte) at a time, reading it before
+  // writing. This is safe, since blocks only move to lower addresses.
+  constexpr size_t BufferSize = 4096;
+  ByteType Buffer[BufferSize];
+  std::shared_ptr<Queue> Que = Pos.getQueue();
+  AddressType Address = StartAddress;
+  while (Size > 0) {
+    size_t Count = Que->read(Address, Buffer, std::min(Size, BufferSize));
+    if (Count == 0) {
+      Que->fail();
+      return;
+    }
+    Pos.writeBytes(Buffer, Count);
+    Size -= Count;
+  }
 }
 
 }  // end of namespace decode
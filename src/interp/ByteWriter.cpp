@@ -18,6 +18,7 @@
 
 #include "interp/ByteWriter.h"
 
+#include <algorithm>
 #include <unordered_set>
 
 #include "interp/ByteWriteStream.h"
@@ -110,6 +111,8 @@ ByteWriter::~ByteWriter() {
 void ByteWriter::reset() {
   BlockStart = BitWriteCursor();
   BlockStartStack.clear();
+  Gaps.clear();
+  FirstGapStack.clear();
 }
 
 void ByteWriter::setPos(const decode::BitWriteCursor& NewPos) {
@@ -142,6 +145,11 @@ bool ByteWriter::writeUint8(uint8_t Value) {
   return WritePos.isQueueGood();
 }
 
+bool ByteWriter::writeBytes(const uint8_t* Buffer, size_t Size) {
+  WritePos.writeBytes(Buffer, Size);
+  return WritePos.isQueueGood();
+}
+
 bool ByteWriter::writeUint32(uint32_t Value) {
   Stream->writeUint32(Value, WritePos);
   return WritePos.isQueueGood();
@@ -207,6 +215,7 @@ bool ByteWriter::writeBlockEnter() {
   BlockStartStack.push(WritePos);
   Stream->writeFixedBlockSize(WritePos, 0);
   BlockStartStack.push(WritePos);
+  FirstGapStack.push_back(Gaps.size());
   return true;
 }
 
@@ -215,35 +224,69 @@ bool ByteWriter::writeBlockExit() {
   // are used.
   WritePos.alignToByte();
   if (MinimizeBlockSize) {
-    // Mimimized block. Backpatch new size of block. If needed, move
-    // block to fill gap between fixed and variable widths for block
-    // size.
+    // Mimimized block. Backpatch new size of block (not counting gaps of
+    // nested blocks), and remember the gap between the fixed and variable
+    // widths for the block size.
     WriteCursor WriteAfterSizeWrite(BlockStart);
     BlockStartStack.pop();
-    const size_t NewSize = Stream->getBlockSize(BlockStart, WritePos);
+    size_t FirstGap = FirstGapStack.back();
+    FirstGapStack.pop_back();
+    const size_t NewSize = Stream->getBlockSize(BlockStart, WritePos) -
+                           getGapSize(FirstGap);
     TRACE(uint32_t, "New block size", NewSize);
     Stream->writeVarintBlockSize(BlockStart, NewSize);
     size_t SizeAfterBackPatch = Stream->getStreamAddress(BlockStart);
     size_t SizeAfterSizeWrite = Stream->getStreamAddress(WriteAfterSizeWrite);
     size_t Diff = SizeAfterSizeWrite - SizeAfterBackPatch;
-    if (Diff) {
-      size_t CurAddress = Stream->getStreamAddress(WritePos);
-      Stream->moveBlock(BlockStart, SizeAfterSizeWrite,
-                        (CurAddress - Diff) - SizeAfterBackPatch);
-      WritePos.swap(BlockStart);
-    }
-  } else {
-    // Non-minimized block. Just backpatch in new size.
-    WriteCursor WriteAfterSizeWrite(BlockStart);
+    if (Diff)
+      Gaps.emplace_back(SizeAfterBackPatch, Diff);
     BlockStartStack.pop();
-    const size_t NewSize = Stream->getBlockSize(BlockStart, WritePos);
-    TRACE(uint32_t, "New block size", NewSize);
-    Stream->writeFixedBlockSize(BlockStart, NewSize);
+    // Remove gaps once the enclosing block (if any) is in a different queue
+    // (i.e. a table scratchpad), since the gaps can't cross queues.
+    if (BlockStart.getQueue() != WritePos.getQueue())
+      removeGaps(FirstGap);
+    return true;
   }
+  // Non-minimized block. Just backpatch in new size.
+  WriteCursor WriteAfterSizeWrite(BlockStart);
+  BlockStartStack.pop();
+  FirstGapStack.pop_back();
+  const size_t NewSize = Stream->getBlockSize(BlockStart, WritePos);
+  TRACE(uint32_t, "New block size", NewSize);
+  Stream->writeFixedBlockSize(BlockStart, NewSize);
   BlockStartStack.pop();
   return true;
 }
 
+size_t ByteWriter::getGapSize(size_t FirstGap) const {
+  size_t Size = 0;
+  for (size_t i = FirstGap; i < Gaps.size(); ++i)
+    Size += Gaps[i].Size;
+  return Size;
+}
+
+void ByteWriter::removeGaps(size_t FirstGap) {
+  if (FirstGap == Gaps.size())
+    return;
+  // Blocks exit inside out, so gaps of enclosing blocks appear after the
+  // gaps of their nested blocks.
+  std::sort(Gaps.begin() + FirstGap, Gaps.end(),
+            [](const BlockGap& G1, const BlockGap& G2) {
+              return G1.Address < G2.Address;
+            });
+  // Slide the contents between gaps down, in a single pass.
+  BitWriteCursor CopyPos(WritePos, Gaps[FirstGap].Address);
+  size_t EndAddress = Stream->getStreamAddress(WritePos);
+  for (size_t i = FirstGap; i < Gaps.size(); ++i) {
+    size_t StartAddress = Gaps[i].Address + Gaps[i].Size;
+    size_t NextAddress =
+        i + 1 < Gaps.size() ? Gaps[i + 1].Address : EndAddress;
+    Stream->moveBlock(CopyPos, StartAddress, NextAddress - StartAddress);
+  }
+  WritePos.swap(CopyPos);
+  Gaps.erase(Gaps.begin() + FirstGap, Gaps.end());
+}
+
 bool ByteWriter::tablePush(IntType Value) {
   if (TblHandler == nullptr)
     TblHandler = new TableHandler(*this);
@@ -20,6 +20,7 @@
 #define DECOMPRESSOR_SRC_INTERP_BYTEWRITER_H
 
 #include <map>
+#include <vector>
 
 #include "interp/Writer.h"
 #include "stream/BitWriteCursor.h"
@@ -31,7 +32,7 @@ namespace interp {
 
 class WriteStream;
 
-class ByteWriter : public Writer {
+class ByteWriter FINAL : public Writer {
   ByteWriter() = delete;
   ByteWriter(const ByteWriter&) = delete;
   ByteWriter& operator=(const ByteWriter&) = delete;
@@ -58,6 +59,7 @@ class ByteWriter : public Writer {
   bool writeBlockExit() OVERRIDE;
   bool writeFreezeEof() OVERRIDE;
   bool writeBinary(decode::IntType, const filt::Node* Encoding) OVERRIDE;
+  bool writeBytes(const uint8_t* Buffer, size_t Size) OVERRIDE;
   bool tablePush(decode::IntType Value) OVERRIDE;
   bool tablePop() OVERRIDE;
 
@@ -71,6 +73,20 @@ class ByteWriter : public Writer {
   // The stack of block patch locations.
   decode::BitWriteCursor BlockStart;
   utils::ValueStack<decode::BitWriteCursor> BlockStartStack;
+  // Minimized blocks are backpatched in place, leaving a gap between the
+  // (shorter) block size and the block contents. Gaps are only removed when
+  // the outermost block (of the output queue) exits, so that each byte is
+  // moved at most once, independent of how deeply blocks are nested.
+  struct BlockGap {
+    size_t Address;
+    size_t Size;
+    BlockGap(size_t Address, size_t Size) : Address(Address), Size(Size) {}
+  };
+  std::vector<BlockGap> Gaps;
+  // For each entered block, the index of the first gap within the block.
+  std::vector<size_t> FirstGapStack;
+  size_t getGapSize(size_t FirstGap) const;
+  void removeGaps(size_t FirstGap);
   void describeBlockStartStack(FILE* File);
   const char* getDefaultTraceName() const OVERRIDE;
   TableHandler* TblHandler;
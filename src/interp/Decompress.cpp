@@ -23,6 +23,9 @@
 #include "interp/ByteWriter.h"
 #include "interp/DecompressSelector.h"
 #include "interp/Interpreter.h"
+#if WASM_DECODE_NO_THREADS == 0
+#include "interp/ParallelDecompressor.h"
+#endif
 #include "stream/Pipe.h"
 #include "stream/Queue.h"
 #include "stream/WriteCursor2ReadQueue.h"
@@ -55,6 +58,11 @@ struct Decompressor {
   std::shared_ptr<DecompAlgState> AlgState;
   State MyState;
   InterpreterFlags Flags;
+  size_t NumThreads;
+#if WASM_DECODE_NO_THREADS == 0
+  // Input collected while NumThreads > 1 (see collectInput()).
+  ParallelDecompressor::BufferType CollectedInput;
+#endif
   Decompressor();
   uint8_t* getBuffer(int32_t Size);
   int32_t resume(int32_t Size);
@@ -68,6 +76,10 @@ struct Decompressor {
 
  private:
   int32_t flushOutput();
+  int32_t resumeReader();
+#if WASM_DECODE_NO_THREADS == 0
+  int32_t collectInput(int32_t Size);
+#endif
   int32_t fail() {
     MyState = State::Failed;
     return DECOMPRESSOR_ERROR;
@@ -78,7 +90,8 @@ Decompressor::Decompressor()
     : BufferSize(0),
       Input(std::make_shared<Queue>()),
       AlgState(std::make_shared<DecompAlgState>()),
-      MyState(State::NeedsMoreInput) {
+      MyState(State::NeedsMoreInput),
+      NumThreads(1) {
   InputPos = std::make_shared<WriteCursor2ReadQueue>(Input);
   OutputPos = std::make_shared<ReadCursor>(OutputPipe.getOutput());
 }
@@ -101,16 +114,83 @@ int32_t Decompressor::flushOutput() {
   return DECOMPRESSOR_SUCCESS;
 }
 
+void Decompressor::closeInput() {
+  if (InputPos->atEof())
+    return;
+  TRACE_MESSAGE("Closing input");
+  InputPos->freezeEof();
+  InputPos->close();
+}
+
+int32_t Decompressor::resumeReader() {
+  MyReader->algorithmResume();
+  if (MyReader->errorsFound())
+    return fail();
+  if (!MyReader->isFinished())
+    return getOutputSize();
+  OutputPipe.getInput()->close();
+  if (!MyReader->isSuccessful())
+    return fail();
+  MyState = State::FlushingOutput;
+  return flushOutput();
+}
+
+#if WASM_DECODE_NO_THREADS == 0
+// Collects the input, so that it can be split into sections and decompressed
+// in parallel. Input that isn't a WASM (0xd) or casm file is passed on to the
+// (sequential) interpreter, as soon as the file header shows it can't be
+// split.
+int32_t Decompressor::collectInput(int32_t Size) {
+  TRACE_METHOD("collectInput");
+  if (Size > BufferSize) {
+    MyReader->throwMessage("resume_decompression(" + std::to_string(Size) +
+                           "): illegal size");
+    return fail();
+  }
+  uint8_t* Buf = Buffer.get();
+  CollectedInput.insert(CollectedInput.end(), Buf, Buf + Size);
+  const bool CanSplit = ParallelDecompressor::canSplit(CollectedInput.data(),
+                                                       CollectedInput.size());
+  if (Size > 0 && (CanSplit || CollectedInput.size() <
+                                   ParallelDecompressor::getHeaderSize()))
+    return 0;
+  if (CanSplit) {
+    ParallelDecompressor Parallel(Flags);
+    Parallel.addAlgorithm(getAlgcasm0x0Symtab());
+    Parallel.addAlgorithm(getAlgwasm0xdSymtab());
+    Parallel.setNumThreads(NumThreads);
+    if (Parallel.decompress(CollectedInput.data(), CollectedInput.size(),
+                            OutputPipe.getInput())) {
+      OutputPipe.getInput()->close();
+      ParallelDecompressor::BufferType().swap(CollectedInput);
+      MyState = State::FlushingOutput;
+      return flushOutput();
+    }
+    if (Parallel.errorsFound())
+      return fail();
+  }
+  // Decompress sequentially (reporting any errors).
+  TRACE_MESSAGE("Decompressing sequentially");
+  NumThreads = 1;
+  for (uint8_t Byte : CollectedInput)
+    InputPos->writeByte(Byte);
+  ParallelDecompressor::BufferType().swap(CollectedInput);
+  if (Size == 0)
+    closeInput();
+  return resumeReader();
+}
+#endif
+
 int32_t Decompressor::resume(int32_t Size) {
   TRACE_METHOD("resume_decompression");
   switch (MyState) {
     case State::NeedsMoreInput:
+#if WASM_DECODE_NO_THREADS == 0
+      if (NumThreads > 1)
+        return collectInput(Size);
+#endif
       if (Size == 0) {
-        if (!InputPos->atEof()) {
-          TRACE_MESSAGE("Closing input");
-          InputPos->freezeEof();
-          InputPos->close();
-        }
+        closeInput();
       } else {
         if (InputPos->atEof()) {
           MyReader->throwMessage("resume_decompression(" +
@@ -128,16 +208,7 @@ int32_t Decompressor::resume(int32_t Size) {
         for (int32_t i = 0; i < Size; ++i)
           InputPos->writeByte(Buf[i]);
       }
-      MyReader->algorithmResume();
-      if (MyReader->errorsFound())
-        return fail();
-      if (!MyReader->isFinished())
-        return getOutputSize();
-      OutputPipe.getInput()->close();
-      if (!MyReader->isSuccessful())
-        return fail();
-      MyState = State::FlushingOutput;
-      return flushOutput();
+      return resumeReader();
     case State::FlushingOutput:
       return flushOutput();
     case State::Succeeded:
@@ -179,9 +250,9 @@ extern "C" {
 void* create_decompressor() {
   auto* Decomp = new Decompressor();
   Decomp->Writer = std::make_shared<ByteWriter>(Decomp->OutputPipe.getInput());
-  Decomp->MyReader =
-      std::make_shared<Interpreter>(std::make_shared<ByteReader>(Decomp->Input),
-                                    Decomp->Writer, Decomp->Flags);
+  Decomp->MyReader = std::make_shared<InterpreterT<ByteReader, ByteWriter>>(
+      std::make_shared<ByteReader>(Decomp->Input), Decomp->Writer,
+      Decomp->Flags);
   Decomp->AlgState->setInterpreter(Decomp->MyReader.get());
   Decomp->MyReader->addSelector(std::make_shared<DecompressSelector>(
       getAlgcasm0x0Symtab(), Decomp->AlgState));
@@ -196,6 +267,11 @@ void set_trace_decompression(void* Dptr, bool NewValue) {
   D->setTraceProgress(NewValue);
 }
 
+void set_decompressor_threads(void* Dptr, int32_t NumThreads) {
+  Decompressor* D = (Decompressor*)Dptr;
+  D->NumThreads = NumThreads < 1 ? 1 : size_t(NumThreads);
+}
+
 uint8_t* get_decompressor_buffer(void* Dptr, int32_t Size) {
   Decompressor* D = (Decompressor*)Dptr;
   return D->getBuffer(Size);
@@ -38,6 +38,15 @@ extern uint8_t* get_decompressor_buffer(void* D, int32_t Size);
 /* Turns on verbose tracing. */
 extern void set_trace_decompression(void* D, bool NewValue);
 
+/* Decompress WASM (0xd) and compressed (casm) input using NumThreads
+ * threads. Must be called before the first call to resume_decompression().
+ * Note: Since the input must be split into sections, such input is collected
+ * until Size == 0, before any output is available. Other input is
+ * decompressed sequentially. Ignored when built without threads (i.e. when
+ * built as WASM).
+ */
+extern void set_decompressor_threads(void* D, int32_t NumThreads);
+
 /* Resume decopmression, assuming the buffer contains Size bytes to read.  If
  * non-negative, returns the number of output bytes available to fetch using
  * fetch_decompressor_output().  If negative, either DECOMPRESSOR_SUCCESS or
@@ -50,6 +50,12 @@ DecompAlgState::DecompAlgState(Interpreter* MyInterpreter)
 DecompAlgState::~DecompAlgState() {
 }
 
+std::shared_ptr<SymbolTable> DecompAlgState::popQueuedAlgorithm() {
+  std::shared_ptr<SymbolTable> Algorithm = AlgQueue.front();
+  AlgQueue.pop();
+  return Algorithm;
+}
+
 DecompressSelector::DecompressSelector(
     std::shared_ptr<filt::SymbolTable> Symtab,
     std::shared_ptr<DecompAlgState> State)
@@ -53,6 +53,10 @@ class DecompAlgState : public std::enable_shared_from_this<DecompAlgState> {
   explicit DecompAlgState(Interpreter* MyInterpreter = nullptr);
   virtual ~DecompAlgState();
   void setInterpreter(Interpreter* NewValue) { MyInterpreter = NewValue; }
+  // Returns the number of algorithms read, but not yet applied.
+  size_t getNumQueuedAlgorithms() const { return AlgQueue.size(); }
+  // Removes (and returns) the next algorithm to apply.
+  std::shared_ptr<filt::SymbolTable> popQueuedAlgorithm();
 
  private:
   Interpreter* MyInterpreter;
@@ -70,6 +70,47 @@ Type readSignedLEB128(ReadCursor& Pos) {
   return Value;
 }
 
+template <class Type>
+size_t decodeLEB128(const decode::ByteType* Buffer, Type& Value) {
+  if (Buffer[0] < 0x80) {
+    Value = Buffer[0];
+    return 1;
+  }
+  // Decode the first 8 bytes as a (little-endian) word, using the high bit
+  // of each byte to find the last byte of the value.
+  uint64_t Word = 0;
+  for (size_t i = 0; i < sizeof(uint64_t); ++i)
+    Word |= uint64_t(Buffer[i]) << (i * CHAR_BIT);
+  uint64_t Stops = ~Word & UINT64_C(0x8080808080808080);
+  if (Stops == 0)
+    return 0;
+  size_t Size = (utils::countTrailingZeros(Stops) + 1) / CHAR_BIT;
+  constexpr size_t MaxSize = (sizeof(Type) * CHAR_BIT + 6) / 7;
+  if (Size > MaxSize)
+    return 0;
+  Word &= Stops ^ (Stops - 1);
+  Word = (Word & UINT64_C(0x7f)) | ((Word >> 1) & (UINT64_C(0x7f) << 7)) |
+         ((Word >> 2) & (UINT64_C(0x7f) << 14)) |
+         ((Word >> 3) & (UINT64_C(0x7f) << 21)) |
+         ((Word >> 4) & (UINT64_C(0x7f) << 28)) |
+         ((Word >> 5) & (UINT64_C(0x7f) << 35)) |
+         ((Word >> 6) & (UINT64_C(0x7f) << 42)) |
+         ((Word >> 7) & (UINT64_C(0x7f) << 49));
+  Value = Type(Word);
+  return Size;
+}
+
+template <class Type>
+size_t decodeSignedLEB128(const decode::ByteType* Buffer, Type& Value) {
+  size_t Size = decodeLEB128(Buffer, Value);
+  if (Size == 0)
+    return 0;
+  uint32_t Shift = Size * 7;
+  if ((Buffer[Size - 1] & 0x40) && (Shift < sizeof(Type) * CHAR_BIT))
+    Value |= ~Type(0) << Shift;
+  return Size;
+}
+
 template <class ReadCursor>
 uint8_t readUint8(ReadCursor& Pos) {
   return Pos.readByte();
@@ -39,6 +39,18 @@ Type readLEB128(ReadCursor& Pos);
 template <class Type, class ReadCursor>
 Type readSignedLEB128(ReadCursor& Pos);
 
+// Maximum number of bytes in a (64-bit) LEB128 value.
+static constexpr size_t MaxLEB128Bytes = 10;
+
+// Decodes the LEB128 value in Buffer, which must contain at least
+// MaxLEB128Bytes bytes. Returns the number of bytes decoded, or zero if the
+// value is too long for this fast path (use readLEB128 instead).
+template <class Type>
+size_t decodeLEB128(const decode::ByteType* Buffer, Type& Value);
+
+template <class Type>
+size_t decodeSignedLEB128(const decode::ByteType* Buffer, Type& Value);
+
 template <class ReadCursor>
 uint8_t readUint8(ReadCursor& Pos);
 
@@ -0,0 +1,200 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Defines the structural read loop of integer stream readers, templated on
+// the type of writer.
+
+#ifndef DECOMPRESSOR_SRC_INTERP_INTINTERPRETER_TEMPLATES_H_
+#define DECOMPRESSOR_SRC_INTERP_INTINTERPRETER_TEMPLATES_H_
+
+#include "interp/IntInterpreter.h"
+#include "interp/IntReader.h"
+#include "interp/IntStream.h"
+#include "sexp/Ast.h"
+#include "utils/Trace.h"
+
+namespace wasm {
+
+namespace interp {
+
+template <class WriterT>
+void IntInterpreter::resumeStructure(WriterT& Out) {
+  if (!IntInput->canProcessMoreInputNow())
+    return;
+  while (IntInput->stillMoreInputToProcessNow()) {
+    if (errorsFound())
+      break;
+    switch (Frame.CallMethod) {
+      default:
+        return handleOtherMethods();
+      case Method::GetFile:
+        switch (Frame.CallState) {
+          case State::Enter:
+            for (auto Pair : IntInput->getStream()->getHeader()) {
+              decode::IntType Value;
+              if (!IntInput->readHeaderValue(Pair.second, Value)) {
+                TRACE(IntType, "Lit Value", Pair.first);
+                TRACE(string, "Lit format", wasm::interp::getName(Pair.second));
+                return throwMessage("unable to read header literal");
+              }
+              if (Value != Pair.first)
+                return throwBadHeaderValue(Pair.first, Value,
+                                           decode::ValueFormat::Hexidecimal);
+              Out.writeHeaderValue(Pair.first, Pair.second);
+            }
+            LocalValues.push_back(IntInput->getStream()->size());
+            Frame.CallState = State::Exit;
+            call(Method::ReadIntBlock, Frame.CallModifier, nullptr);
+            break;
+          case State::Exit:
+            if (FreezeEofAtExit && !Out.writeFreezeEof())
+              return throwCantFreezeEof();
+            popAndReturn();
+            break;
+          default:
+            return failBadState();
+        }
+        break;
+      case Method::ReadIntBlock:
+        switch (Frame.CallState) {
+          case State::Enter:
+            Frame.CallState = State::Loop;
+            break;
+          case State::Loop: {
+            // Check if end of current (enclosing) block has been reached.
+            size_t Eob = LocalValues.back();
+            if (IntInput->atInputEob()) {
+              Frame.CallState = State::Exit;
+              break;
+            }
+            // Check if any nested blocks.
+            bool hasNestedBlocks = IntInput->hasMoreBlocks();
+            if (hasNestedBlocks) {
+              const IntStream::Block& Blk = IntInput->getNextBlock();
+              if (Blk.getBeginIndex() >= Eob)
+                hasNestedBlocks = false;
+            }
+            if (!hasNestedBlocks) {
+              // Only top-level values left. Read until all processed.
+              LocalValues.push_back(Eob);
+              Frame.CallState = State::Exit;
+              call(Method::ReadIntValues, Frame.CallModifier, nullptr);
+              break;
+            }
+            // Read to beginning of nested block.
+            const IntStream::Block& Blk = IntInput->getNextBlock();
+            LocalValues.push_back(Blk.getBeginIndex());
+            Frame.CallState = State::Step2;
+            call(Method::ReadIntValues, Frame.CallModifier, nullptr);
+            break;
+          }
+          case State::Step2: {
+            // At the beginning of a nested block.
+            const IntStream::Block& Blk = IntInput->getNextBlock();
+            TRACE_BLOCK(
+                { TRACE(hex_size_t, "block.open", Blk.getBeginIndex()); });
+            decode::IntType EnterBlock =
+                decode::IntType(filt::PredefinedSymbol::Block_enter);
+            if (!IntInput->readAction(EnterBlock) ||
+                !Out.writeAction(EnterBlock))
+              return decode::fatal("Unable to enter block");
+            Frame.CallState = State::Step3;
+            LocalValues.push_back(Blk.getEndIndex());
+            call(Method::ReadIntBlock, Frame.CallModifier, nullptr);
+            break;
+          }
+          case State::Step3: {
+            // At the end of a nested block.
+            TRACE_BLOCK(
+                { TRACE(hex_size_t, "block.close", LocalValues.back()); });
+            decode::IntType ExitBlock =
+                decode::IntType(filt::PredefinedSymbol::Block_exit);
+            if (!IntInput->readAction(ExitBlock) || !Out.writeAction(ExitBlock))
+              return decode::fatal("unable to close block");
+            // Continue to process rest of block.
+            Frame.CallState = State::Loop;
+            break;
+          }
+          case State::Exit:
+            LocalValues.pop_back();
+            popAndReturn();
+            break;
+          default:
+            return failBadState();
+        }
+        break;
+      case Method::ReadIntValues:
+        switch (Frame.CallState) {
+          case State::Enter:
+            Frame.CallState = State::Loop;
+            break;
+          case State::Loop: {
+            size_t EndIndex = LocalValues.back();
+            if (IntInput->getIndex() >= EndIndex) {
+              Frame.CallState = State::Exit;
+              break;
+            }
+            decode::IntType Value = IntInput->read();
+            TRACE(IntType, "value", Value);
+            if (!Out.writeVarint64(Value))
+              return throwMessage("Unable to write last value");
+            break;
+          }
+          case State::Exit:
+            LocalValues.pop_back();
+            popAndReturn();
+            break;
+          default:
+            return failBadState();
+        }
+        break;
+    }
+  }
+}
+
+// Defines an integer stream reader specialized on the (concrete) type of its
+// writer, so that the writes of the structural read loop are not virtual
+// calls. Falls back to the generic loop if the writer is replaced.
+template <class WriterT>
+class IntInterpreterT : public IntInterpreter {
+  IntInterpreterT() = delete;
+  IntInterpreterT(const IntInterpreterT&) = delete;
+  IntInterpreterT& operator=(const IntInterpreterT&) = delete;
+
+ public:
+  IntInterpreterT(std::shared_ptr<IntReader> Input,
+                  std::shared_ptr<WriterT> Output,
+                  const InterpreterFlags& Flags,
+                  std::shared_ptr<filt::SymbolTable> Symtab)
+      : IntInterpreter(Input, Output, Flags, Symtab),
+        TypedOutput(Output.get()) {}
+  ~IntInterpreterT() OVERRIDE {}
+
+  void structuralResume() OVERRIDE {
+    if (Output.get() == TypedOutput)
+      return resumeStructure(*TypedOutput);
+    IntInterpreter::structuralResume();
+  }
+
+ private:
+  WriterT* TypedOutput;
+};
+
+}  // end of namespace interp
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_INTERP_INTINTERPRETER_TEMPLATES_H_
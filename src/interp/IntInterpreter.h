@@ -43,7 +43,13 @@ class IntInterpreter : public Interpreter {
   void structuralStart();
   void structuralRead();
   void structuralReadBackFilled();
-  void structuralResume();
+  virtual void structuralResume();
+
+ protected:
+  // Runs the structural read loop, writing to Out (see IntInterpreterT).
+  // Defined in IntInterpreter-templates.h.
+  template <class WriterT>
+  void resumeStructure(WriterT& Out);
 
  private:
   const char* getDefaultTraceName() const OVERRIDE;
@@ -41,12 +41,12 @@ class IntReader::TableHandler {
   bool tablePush(IntType Value) {
     TableType::iterator Iter = Table.find(Value);
     if (Iter == Table.end()) {
-      Table[Value] = Reader.Pos;
+      Reader.Pos.save(Table[Value]);
       RestoreStack.push_back(false);
     } else {
       if (!Reader.pushPeekPos())
         return false;
-      Reader.Pos = Iter->second;
+      Reader.Pos.restore(Iter->second);
       RestoreStack.push_back(true);
     }
     return true;
@@ -66,7 +66,7 @@ class IntReader::TableHandler {
  private:
   IntReader& Reader;
   std::vector<bool> RestoreStack;
-  typedef std::map<decode::IntType, IntStream::ReadCursor> TableType;
+  typedef std::map<decode::IntType, IntStream::CursorSnapshot> TableType;
   TableType Table;
 };
 
@@ -76,6 +76,7 @@ IntReader::IntReader(std::shared_ptr<IntStream> Input)
       Input(Input),
       HeaderIndex(0),
       StillAvailable(0),
+      SavedPos(),
       SavedPosStack(SavedPos),
       TblHandler(nullptr) {
 }
@@ -119,14 +120,15 @@ bool IntReader::atInputEof() {
 }
 
 bool IntReader::pushPeekPos() {
-  SavedPosStack.push(Pos);
+  SavedPosStack.push();
+  Pos.save(SavedPos);
   return true;
 }
 
 bool IntReader::popPeekPos() {
   if (SavedPosStack.empty())
     return false;
-  Pos = SavedPos;
+  Pos.restore(SavedPos);
   SavedPosStack.pop();
   return true;
 }
@@ -157,6 +159,11 @@ decode::IntType IntReader::read() {
   return Pos.read();
 }
 
+void IntReader::releaseReadValues() {
+  if (SavedPosStack.empty() && TblHandler == nullptr)
+    Input->releaseValuesBefore(Pos.getIndex());
+}
+
 uint64_t IntReader::readVaruint64() {
   return read();
 }
@@ -191,7 +198,7 @@ void IntReader::describePeekPosStack(FILE* File) {
   fprintf(File, "*** Saved Pos Stack ***\n");
   fprintf(File, "**********************\n");
   for (const auto& Pos : SavedPosStack.iterRange(1))
-    fprintf(File, "@%" PRIxMAX "\n", uintmax_t(Pos.getIndex()));
+    fprintf(File, "@%" PRIxMAX "\n", uintmax_t(Pos.Index));
   fprintf(File, "**********************\n");
 }
 
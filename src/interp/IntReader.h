@@ -28,7 +28,7 @@ namespace wasm {
 
 namespace interp {
 
-class IntReader : public Reader {
+class IntReader FINAL : public Reader {
   IntReader(const IntReader&) = delete;
   IntReader& operator=(const IntReader&) = delete;
 
@@ -38,10 +38,13 @@ class IntReader : public Reader {
 
   std::shared_ptr<IntStream> getStream() { return Input; }
   bool hasMoreBlocks() { return Pos.hasMoreBlocks(); }
-  IntStream::BlockPtr getNextBlock() { return Pos.getNextBlock(); }
+  const IntStream::Block& getNextBlock() { return Pos.getNextBlock(); }
   size_t getIndex() { return Pos.getIndex(); }
 
   decode::IntType read();
+  // Releases the values of the stream that have been read, unless they may
+  // be read again (i.e. by a peek or a table).
+  void releaseReadValues();
   void describePeekPosStack(FILE* Out) OVERRIDE;
 
   bool canProcessMoreInputNow() OVERRIDE;
@@ -72,8 +75,8 @@ class IntReader : public Reader {
   // Shows how many are still available since last call to
   // canProcessMoreInputNow().
   size_t StillAvailable;
-  IntStream::ReadCursor SavedPos;
-  utils::ValueStack<IntStream::Cursor> SavedPosStack;
+  IntStream::CursorSnapshot SavedPos;
+  utils::ValueStack<IntStream::CursorSnapshot> SavedPosStack;
   TableHandler* TblHandler;
 };
 
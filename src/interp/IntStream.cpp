@@ -27,13 +27,6 @@ using namespace utils;
 
 namespace interp {
 
-IntStream::Block::Block(size_t BeginIndex, size_t EndIndex)
-    : BeginIndex(BeginIndex), EndIndex(EndIndex) {
-}
-
-IntStream::Block::~Block() {
-}
-
 class IntStream::Cursor::TraceContext : public utils::TraceContext {
   TraceContext() = delete;
   TraceContext(const TraceContext&) = delete;
@@ -48,7 +41,7 @@ class IntStream::Cursor::TraceContext : public utils::TraceContext {
   Cursor& Pos;
 };
 
-void IntStream::Block::describe(FILE* File) {
+void IntStream::Block::describe(FILE* File) const {
   fprintf(File, "[%" PRIxMAX "", uintmax_t(BeginIndex));
   if (EndIndex != std::numeric_limits<size_t>::max())
     fprintf(File, ":%" PRIxMAX "", uintmax_t(EndIndex));
@@ -62,18 +55,19 @@ void IntStream::Cursor::TraceContext::describe(FILE* File) {
   Pos.describe(File);
 }
 
-IntStream::Cursor::Cursor() : Index(0) {
+IntStream::Cursor::Cursor() : Index(0), Address(0), CurBlock(0) {
 }
 
-IntStream::Cursor::Cursor(Ptr Stream) : Index(0), Stream(Stream) {
+IntStream::Cursor::Cursor(Ptr Stream)
+    : Index(0), Address(0), CurBlock(0), Stream(Stream) {
   assert(Stream);
-  EnclosingBlocks.push_back(Stream->TopBlock);
 }
 
 IntStream::Cursor::Cursor(const IntStream::Cursor& C)
     : std::enable_shared_from_this<Cursor>(C),
       Index(C.Index),
-      EnclosingBlocks(C.EnclosingBlocks),
+      Address(C.Address),
+      CurBlock(C.CurBlock),
       Stream(C.Stream) {
 }
 
@@ -82,7 +76,8 @@ IntStream::Cursor::~Cursor() {
 
 IntStream::Cursor& IntStream::Cursor::operator=(const IntStream::Cursor& C) {
   Index = C.Index;
-  EnclosingBlocks = C.EnclosingBlocks;
+  Address = C.Address;
+  CurBlock = C.CurBlock;
   Stream = C.Stream;
   return *this;
 }
@@ -102,8 +97,13 @@ FILE* IntStream::Cursor::describe(FILE* File,
       fprintf(File, "{%" PRIxMAX ":%s}", uintmax_t(Pair.first),
               getName(Pair.second));
   }
-  for (auto Blk : EnclosingBlocks)
-    Blk->describe(File);
+  std::vector<size_t> EnclosingBlocks;
+  for (size_t Blk = CurBlock; Blk != 0; Blk = Stream->Blocks[Blk].getParent())
+    EnclosingBlocks.push_back(Blk);
+  Stream->Blocks[0].describe(File);
+  for (auto Iter = EnclosingBlocks.rbegin(); Iter != EnclosingBlocks.rend();
+       ++Iter)
+    Stream->Blocks[*Iter].describe(File);
   if (IncludeDetail)
     fputc('>', File);
   if (AddEoln)
@@ -112,26 +112,22 @@ FILE* IntStream::Cursor::describe(FILE* File,
 }
 
 bool IntStream::Cursor::atEof() const {
-  assert(!EnclosingBlocks.empty());
-  return Index >= EnclosingBlocks.front()->getEndIndex();
+  return Index >= Stream->Blocks[0].getEndIndex();
 }
 
 bool IntStream::Cursor::atEob() const {
-  assert(!EnclosingBlocks.empty());
-  return Index >= EnclosingBlocks.back()->getEndIndex();
+  return Index >= Stream->Blocks[CurBlock].getEndIndex();
 }
 
 bool IntStream::Cursor::atEnd() const {
-  return EnclosingBlocks.size() == 1 && atEof();
+  return CurBlock == 0 && atEof();
 }
 
-IntStream::BlockPtr IntStream::Cursor::closeBlock() {
-  BlockPtr Blk;
-  if (EnclosingBlocks.size() <= 1)
-    return Blk;
-  Blk = EnclosingBlocks.back();
-  EnclosingBlocks.pop_back();
-  return Blk;
+bool IntStream::Cursor::closeBlock() {
+  if (CurBlock == 0)
+    return false;
+  CurBlock = Stream->Blocks[CurBlock].getParent();
+  return true;
 }
 
 IntStream::WriteCursor::WriteCursor() : Cursor() {
@@ -148,50 +144,52 @@ IntStream::WriteCursor::~WriteCursor() {
 
 bool IntStream::WriteCursor::write(IntType Value) {
   // TODO(karlschimpf): Add capability to communicate failure to caller.
-  assert(!EnclosingBlocks.empty());
-  assert(EnclosingBlocks.back()->getEndIndex() >= Index);
-  Stream->Values.push_back(Value);
+  assert(Stream->Blocks[CurBlock].getEndIndex() >= Index);
+  Stream->appendValue(Value);
   ++Index;
   return true;
 }
 
+bool IntStream::WriteCursor::write(const IntType* Values, size_t Count) {
+  assert(Stream->Blocks[CurBlock].getEndIndex() >= Index + Count);
+  for (size_t i = 0; i < Count; ++i)
+    Stream->appendValue(Values[i]);
+  Index += Count;
+  return true;
+}
+
 bool IntStream::WriteCursor::freezeEof() {
   if (Stream->isFrozen())
     return false;
   Stream->isFrozenFlag = true;
-  size_t EofIndex = Stream->Values.size();
-  for (auto Block : EnclosingBlocks)
-    Block->EndIndex = EofIndex;
+  size_t EofIndex = Stream->NumValues;
+  for (size_t Blk = CurBlock; Blk != 0; Blk = Stream->Blocks[Blk].getParent())
+    Stream->Blocks[Blk].EndIndex = EofIndex;
+  Stream->Blocks[0].EndIndex = EofIndex;
   return true;
 }
 
 bool IntStream::WriteCursor::openBlock() {
-  assert(!EnclosingBlocks.empty());
-  std::shared_ptr<Block> CurBlock = EnclosingBlocks.back();
-  assert(CurBlock);
-  auto Blk = std::make_shared<Block>(Index);
-  CurBlock->Subblocks.push_back(Blk);
-  EnclosingBlocks.push_back(Blk);
   assert(Stream);
-  Stream->Blocks.push_back(Blk);
+  Stream->Blocks.emplace_back(Index, std::numeric_limits<size_t>::max(),
+                              CurBlock);
+  CurBlock = Stream->Blocks.size() - 1;
   return true;
 }
 
 bool IntStream::WriteCursor::closeBlock() {
-  BlockPtr Blk = Cursor::closeBlock();
-  if (!Blk)
+  size_t Blk = CurBlock;
+  if (!Cursor::closeBlock())
     return false;
-  Blk->EndIndex = Index;
+  Stream->Blocks[Blk].EndIndex = Index;
   return true;
 }
 
-IntStream::ReadCursor::ReadCursor() : Cursor() {
+IntStream::ReadCursor::ReadCursor() : Cursor(), NextBlock(0), EndBlocks(0) {
 }
 
 IntStream::ReadCursor::ReadCursor(Ptr Stream)
-    : Cursor(Stream),
-      NextBlock(Stream->getBlocksBegin()),
-      EndBlocks(Stream->getBlocksEnd()) {
+    : Cursor(Stream), NextBlock(1), EndBlocks(Stream->Blocks.size()) {
 }
 
 IntStream::ReadCursor::ReadCursor(const ReadCursor& C)
@@ -203,31 +201,32 @@ IntStream::ReadCursor::~ReadCursor() {
 
 IntType IntStream::ReadCursor::read() {
   // TODO(karlschimpf): Add capability to communicate failure to caller.
-  assert(!EnclosingBlocks.empty());
-  assert(EnclosingBlocks.back()->getEndIndex() >= Index);
-  assert(Index < Stream->Values.size());
-  return Stream->Values[Index++];
+  assert(Stream->Blocks[CurBlock].getEndIndex() >= Index);
+  assert(Index < Stream->NumValues);
+  ++Index;
+  return Stream->readValue(Address);
 }
 
 bool IntStream::ReadCursor::openBlock() {
   if (NextBlock == EndBlocks)
     return false;
-  BlockPtr Blk = *NextBlock;
-  if (Index != Blk->getBeginIndex())
+  const Block& Blk = Stream->Blocks[NextBlock];
+  if (Index != Blk.getBeginIndex())
     return false;
-  assert(!EnclosingBlocks.empty());
-  std::shared_ptr<Block> CurBlock = EnclosingBlocks.back();
-  assert(CurBlock);
-  EnclosingBlocks.push_back(Blk);
+  CurBlock = NextBlock;
   ++NextBlock;
   return true;
 }
 
 bool IntStream::ReadCursor::closeBlock() {
-  BlockPtr Blk = Cursor::closeBlock();
-  if (!Blk)
+  size_t Blk = CurBlock;
+  if (!Cursor::closeBlock())
     return false;
-  return Blk->getEndIndex() == Index;
+  return Stream->Blocks[Blk].getEndIndex() == Index;
+}
+
+IntStream::ValueReader::ValueReader(const IntStream& Stream, size_t Index)
+    : Stream(Stream), Address(Stream.getAddress(Index)) {
 }
 
 IntStream::IntStream() {
@@ -240,22 +239,61 @@ IntStream::~IntStream() {
 void IntStream::reset() {
   Header.clear();
   IsHeaderClosed = false;
-  Values.clear();
-  TopBlock = std::make_shared<Block>();
+  Pages.clear();
+  NumReleasedPages = 0;
+  ValueIndex.clear();
+  NumValues = 0;
+  EndAddress = 0;
   isFrozenFlag = false;
   Blocks.clear();
+  Blocks.emplace_back();
+}
+
+void IntStream::appendValue(IntType Value) {
+  EndAddress = fixAddress(EndAddress);
+  if ((NumValues % IndexStride) == 0)
+    ValueIndex.push_back(EndAddress);
+  size_t PageIndex = EndAddress >> PageSizeLog2;
+  if (PageIndex == Pages.size())
+    Pages.emplace_back(new uint8_t[PageSize]);
+  uint8_t* Bytes = Pages[PageIndex].get() + (EndAddress & (PageSize - 1));
+  size_t i = 0;
+  while (Value >= 0x80) {
+    Bytes[i++] = uint8_t(Value) | 0x80;
+    Value >>= 7;
+  }
+  Bytes[i++] = uint8_t(Value);
+  EndAddress += i;
+  ++NumValues;
 }
 
-size_t IntStream::getNumIntegers() const {
-  return Values.size() + Blocks.size() * 2;
+size_t IntStream::getAddress(size_t Index) const {
+  if (Index >= NumValues)
+    return EndAddress;
+  size_t Address = ValueIndex[Index / IndexStride];
+  for (size_t i = Index % IndexStride; i > 0; --i)
+    readValue(Address);
+  return Address;
+}
+
+void IntStream::releaseValuesBefore(size_t Index) {
+  if (Index / IndexStride >= ValueIndex.size())
+    return;
+  // Keep the page holding the indexed value that precedes Index, since
+  // getAddress() decodes from there.
+  const size_t EndPage = ValueIndex[Index / IndexStride] >> PageSizeLog2;
+  for (; NumReleasedPages < EndPage; ++NumReleasedPages)
+    Pages[NumReleasedPages].reset();
 }
 
-IntStream::BlockIterator IntStream::getBlocksBegin() {
-  return Blocks.begin();
+size_t IntStream::getNumIntegers() const {
+  return NumValues + (Blocks.size() - 1) * 2;
 }
 
-IntStream::BlockIterator IntStream::getBlocksEnd() {
-  return Blocks.end();
+size_t IntStream::getByteSize() const {
+  return (Pages.size() - NumReleasedPages) * PageSize +
+         ValueIndex.capacity() * sizeof(size_t) +
+         Blocks.capacity() * sizeof(Block);
 }
 
 void IntStream::appendHeader(decode::IntType Value,
@@ -274,18 +312,17 @@ void IntStream::describe(FILE* File, const char* Name) {
     fprintf(File, " : %s\n", getName(Pair.second));
   }
   fputs("Blocks:\n", File);
-  for (auto BlkIter = Blocks.begin(); BlkIter != Blocks.end(); ++BlkIter) {
+  for (auto BlkIter = getBlocksBegin(); BlkIter != getBlocksEnd(); ++BlkIter) {
     fputs("  ", File);
-    BlkIter->get()->describe(File);
+    BlkIter->describe(File);
     fputc('\n', File);
   }
   fputs("Values:\n", File);
-  size_t Index = 0;
-  for (auto V : Values) {
+  ValueReader Values(*this);
+  for (size_t Index = 0; Index < NumValues; ++Index) {
     fprintf(File, "  [%" PRIxMAX "] ", Index);
-    fprint_IntType(File, V);
+    fprint_IntType(File, Values.read());
     fputc('\n', File);
-    ++Index;
   }
   fprintf(File, "******\n");
 }
@@ -19,6 +19,8 @@
 #ifndef DECOMPRESSOR_SRC_INTERP_INTSTREAM_H_
 #define DECOMPRESSOR_SRC_INTERP_INTSTREAM_H_
 
+#include <limits>
+#include <memory>
 #include <vector>
 
 #include "interp/IntFormats.h"
@@ -38,28 +40,41 @@ class IntStream : public std::enable_shared_from_this<IntStream> {
   class WriteCursor;
   typedef std::vector<decode::IntType> IntVector;
   typedef std::vector<std::pair<decode::IntType, IntTypeFormat>> HeaderVector;
-  typedef std::shared_ptr<Block> BlockPtr;
-  typedef std::vector<BlockPtr> BlockVector;
-  typedef BlockVector::iterator BlockIterator;
+  typedef std::vector<Block> BlockVector;
+  typedef BlockVector::const_iterator BlockIterator;
   typedef std::shared_ptr<IntStream> Ptr;
-  class Block : public std::enable_shared_from_this<Block> {
-    Block(const Block&) = delete;
-    Block& operator=(const Block&) = delete;
+
+  // Blocks are kept in a flat vector (in the order they were opened), and
+  // refer to their enclosing block by its index in that vector. Index 0 is
+  // the (implicit) top-level block of the stream.
+  class Block {
     friend class WriteCursor;
 
    public:
     explicit Block(size_t BeginIndex = 0,
-                   size_t EndIndex = std::numeric_limits<size_t>::max());
-    ~Block();
+                   size_t EndIndex = std::numeric_limits<size_t>::max(),
+                   size_t Parent = 0)
+        : BeginIndex(BeginIndex), EndIndex(EndIndex), Parent(Parent) {}
     size_t getBeginIndex() const { return BeginIndex; }
     size_t getEndIndex() const { return EndIndex; }
+    size_t getParent() const { return Parent; }
 
-    void describe(FILE* File);
+    void describe(FILE* File) const;
 
    private:
     size_t BeginIndex;
     size_t EndIndex;
-    BlockVector Subblocks;
+    size_t Parent;
+  };
+
+  // Holds the state of a ReadCursor, so that it can be saved and restored
+  // (e.g. when peeking) without copying the stream pointer.
+  struct CursorSnapshot {
+    size_t Index;
+    size_t Address;
+    size_t CurBlock;
+    size_t NextBlock;
+    size_t EndBlocks;
   };
 
   class Cursor : public std::enable_shared_from_this<Cursor> {
@@ -86,9 +101,12 @@ class IntStream : public std::enable_shared_from_this<IntStream> {
 
    protected:
     size_t Index;
-    BlockVector EnclosingBlocks;
+    // Address of the encoded value at Index.
+    size_t Address;
+    // Index of the innermost enclosing block.
+    size_t CurBlock;
     Ptr Stream;
-    BlockPtr closeBlock();
+    bool closeBlock();
   };
 
   class WriteCursor : public Cursor {
@@ -102,6 +120,8 @@ class IntStream : public std::enable_shared_from_this<IntStream> {
       return *this;
     }
     bool write(decode::IntType Value);
+    // Appends the Count values in Values.
+    bool write(const decode::IntType* Values, size_t Count);
     bool freezeEof();
     bool openBlock();
     bool closeBlock();
@@ -120,14 +140,41 @@ class IntStream : public std::enable_shared_from_this<IntStream> {
       return *this;
     }
     decode::IntType read();
+    // Saves (restores) the state of the cursor to (from) Snapshot. Assumes
+    // that the stream of the cursor doesn't change in between.
+    void save(CursorSnapshot& Snapshot) const {
+      Snapshot.Index = Index;
+      Snapshot.Address = Address;
+      Snapshot.CurBlock = CurBlock;
+      Snapshot.NextBlock = NextBlock;
+      Snapshot.EndBlocks = EndBlocks;
+    }
+    void restore(const CursorSnapshot& Snapshot) {
+      Index = Snapshot.Index;
+      Address = Snapshot.Address;
+      CurBlock = Snapshot.CurBlock;
+      NextBlock = Snapshot.NextBlock;
+      EndBlocks = Snapshot.EndBlocks;
+    }
     bool openBlock();
     bool closeBlock();
     bool hasMoreBlocks() const { return NextBlock != EndBlocks; }
-    BlockPtr getNextBlock() const { return *NextBlock; }
+    const Block& getNextBlock() const { return Stream->Blocks[NextBlock]; }
+
+   private:
+    size_t NextBlock;
+    size_t EndBlocks;
+  };
+
+  // Reads the values of a stream sequentially, without following blocks.
+  class ValueReader {
+   public:
+    explicit ValueReader(const IntStream& Stream, size_t Index = 0);
+    decode::IntType read() { return Stream.readValue(Address); }
 
    private:
-    IntStream::BlockIterator NextBlock;
-    IntStream::BlockIterator EndBlocks;
+    const IntStream& Stream;
+    size_t Address;
   };
 
   // WARNING: Don't call constructor directly. Call std::make_shared().
@@ -135,13 +182,21 @@ class IntStream : public std::enable_shared_from_this<IntStream> {
   void reset();
   ~IntStream();
 
-  size_t size() const { return Values.size(); }
+  size_t size() const { return NumValues; }
   size_t getNumIntegers() const;
-  BlockPtr getTopBlock() { return TopBlock; }
   bool isFrozen() const { return isFrozenFlag; }
 
-  BlockIterator getBlocksBegin();
-  BlockIterator getBlocksEnd();
+  // Frees the pages that only hold values before Index. Values before Index
+  // can no longer be read.
+  void releaseValuesBefore(size_t Index);
+
+  // Iterates over the written blocks (excluding the top-level block).
+  BlockIterator getBlocksBegin() const { return Blocks.begin() + 1; }
+  BlockIterator getBlocksEnd() const { return Blocks.end(); }
+
+  // Returns the (approximate) number of bytes used to hold the values and
+  // blocks of the stream.
+  size_t getByteSize() const;
 
   void describe(FILE* File, const char* Name = nullptr);
 
@@ -152,15 +207,59 @@ class IntStream : public std::enable_shared_from_this<IntStream> {
   bool getIsHeaderClosed() const { return IsHeaderClosed; }
 
  private:
+  // Values are stored LEB128 encoded in pages of PageSize bytes. A value
+  // never spans pages. Addresses are byte offsets into the concatenated
+  // pages.
+  //
+  // Values are not zigzag encoded. Sign extended negative values take 10
+  // bytes, but they are rare (about 2% of the values read from the 0xD test
+  // sources). Zigzag encoding would add a byte to each value in [64, 128),
+  // which includes many opcodes, and makes those streams 0.5% larger.
+  static constexpr size_t PageSizeLog2 = 12;
+  static constexpr size_t PageSize = size_t(1) << PageSizeLog2;
+  static constexpr size_t MaxEncodedSize = 10;
+  // The address of every IndexStride-th value is recorded in ValueIndex, so
+  // that values can be found without decoding from the beginning.
+  static constexpr size_t IndexStride = 64;
+
   HeaderVector Header;
   bool IsHeaderClosed;
-  IntVector Values;
-  BlockPtr TopBlock;
+  std::vector<std::unique_ptr<uint8_t[]>> Pages;
+  // The number of (leading) pages freed by releaseValuesBefore().
+  size_t NumReleasedPages;
+  std::vector<size_t> ValueIndex;
+  size_t NumValues;
+  size_t EndAddress;
   bool isFrozenFlag;
 
-  // The following fields is defined by openBlock(), and defines the
-  // sequence of written blocks.
+  // The top-level block, followed by the sequence of written blocks (defined
+  // by openBlock()).
   BlockVector Blocks;
+
+  static size_t fixAddress(size_t Address) {
+    // Skip to the next page if a value might not fit on the current page.
+    if (PageSize - (Address & (PageSize - 1)) < MaxEncodedSize)
+      Address = (Address | (PageSize - 1)) + 1;
+    return Address;
+  }
+  void appendValue(decode::IntType Value);
+  decode::IntType readValue(size_t& Address) const {
+    Address = fixAddress(Address);
+    const uint8_t* Bytes =
+        Pages[Address >> PageSizeLog2].get() + (Address & (PageSize - 1));
+    decode::IntType Value = 0;
+    unsigned Shift = 0;
+    size_t i = 0;
+    uint8_t Byte;
+    do {
+      Byte = Bytes[i++];
+      Value |= decode::IntType(Byte & 0x7f) << Shift;
+      Shift += 7;
+    } while (Byte & 0x80);
+    Address += i;
+    return Value;
+  }
+  size_t getAddress(size_t Index) const;
 };
 
 }  // end of namespace interp
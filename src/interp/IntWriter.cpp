@@ -142,6 +142,12 @@ bool IntWriter::writeVaruint64(uint64_t Value) {
   return write(Value);
 }
 
+bool IntWriter::writeValues(const IntType* Values,
+                            size_t Count,
+                            const filt::Node* Format) {
+  return Pos.write(Values, Count);
+}
+
 bool IntWriter::writeBlockEnter() {
   return Pos.openBlock();
 }
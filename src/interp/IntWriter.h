@@ -26,7 +26,7 @@ namespace wasm {
 
 namespace interp {
 
-class IntWriter : public Writer {
+class IntWriter FINAL : public Writer {
   IntWriter() = delete;
   IntWriter(const IntWriter&) = delete;
   IntWriter& operator=(const IntWriter&) = delete;
@@ -38,6 +38,9 @@ class IntWriter : public Writer {
   decode::StreamType getStreamType() const OVERRIDE;
   bool write(decode::IntType Value) { return Pos.write(Value); }
   bool writeVaruint64(uint64_t Value) OVERRIDE;
+  bool writeValues(const decode::IntType* Values,
+                   size_t Count,
+                   const filt::Node* Format) OVERRIDE;
   bool writeBlockEnter() OVERRIDE;
   bool writeBlockExit() OVERRIDE;
   bool writeFreezeEof() OVERRIDE;
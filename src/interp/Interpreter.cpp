@@ -19,7 +19,14 @@
 
 #include "interp/Interpreter.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "interp/AlgorithmSelector.h"
+#include "interp/ByteReader.h"
+#include "interp/ByteWriter.h"
+#include "interp/IntWriter.h"
+#include "interp/InterpreterCode.h"
 #include "interp/Reader.h"
 #include "interp/Writer.h"
 #include "sexp/Ast.h"
@@ -106,7 +113,9 @@ struct {
 InterpreterFlags::InterpreterFlags()
     : TraceProgress(false),
       TraceIntermediateStreams(false),
-      TraceAppliedAlgorithms(false) {
+      TraceAppliedAlgorithms(false),
+      FastEval(true),
+      ThreadedEval(true) {
 }
 
 Interpreter::CallFrame::CallFrame() {
@@ -268,7 +277,9 @@ Interpreter::Interpreter(std::shared_ptr<Reader> Input,
       LocalsBaseStack(LocalsBase),
       OpcodeLocalsStack(OpcodeLocals),
       HeaderOverride(nullptr),
-      FreezeEofAtExit(true) {
+      FreezeEofAtExit(true),
+      CodeAddress(0),
+      CodeValue(0) {
   init();
 }
 
@@ -291,7 +302,9 @@ Interpreter::Interpreter(std::shared_ptr<Reader> Input,
       LocalsBaseStack(LocalsBase),
       OpcodeLocalsStack(OpcodeLocals),
       HeaderOverride(nullptr),
-      FreezeEofAtExit(true) {
+      FreezeEofAtExit(true),
+      CodeAddress(0),
+      CodeValue(0) {
   init();
 }
 
@@ -436,6 +449,24 @@ void Interpreter::reset() {
 void Interpreter::call(Method Method,
                        MethodModifier Modifier,
                        const filt::Node* Nd) {
+  call(*Input, *Output, Method, Modifier, Nd);
+}
+
+template <class ReaderT, class WriterT>
+void Interpreter::call(ReaderT& In,
+                       WriterT& Out,
+                       Method Method,
+                       MethodModifier Modifier,
+                       const filt::Node* Nd) {
+  if (Method == Method::Eval && Flags.FastEval &&
+      evalLeaf(In, Out, Modifier, Nd))
+    return;
+  pushCall(Method, Modifier, Nd);
+}
+
+void Interpreter::pushCall(Method Method,
+                           MethodModifier Modifier,
+                           const filt::Node* Nd) {
   Frame.ReturnValue = 0;
   FrameStack.push();
   Frame.CallMethod = Method;
@@ -446,6 +477,127 @@ void Interpreter::call(Method Method,
   traceEnterFrame();
 }
 
+template <class ReaderT, class WriterT>
+bool Interpreter::evalLeaf(ReaderT& In,
+                           WriterT& Out,
+                           MethodModifier Modifier,
+                           const filt::Node* Nd) {
+  // Note: Each case must read at most one value, so that the check for
+  // available input in algorithmResume() still applies.
+  switch (Nd->getType()) {
+    default:
+      return false;
+    case OpI32Const:
+    case OpI64Const:
+    case OpU8Const:
+    case OpU32Const:
+    case OpU64Const: {
+      IntType Value = cast<IntegerNode>(Nd)->getValue();
+      if (isReadModifier(Modifier))
+        LastReadValue = Value;
+      Frame.ReturnValue = Value;
+      break;
+    }
+    case OpLastRead:
+    case OpVoid:
+      Frame.ReturnValue = LastReadValue;
+      break;
+    case OpLocal: {
+      size_t Index = cast<LocalNode>(Nd)->getValue();
+      if (LocalsBase + Index >= LocalValues.size()) {
+        throwMessage("Local variable index out of range!");
+        return true;
+      }
+      Frame.ReturnValue = LocalValues[LocalsBase + Index];
+      break;
+    }
+    case OpBit:
+    case OpUint32:
+    case OpUint64:
+    case OpUint8:
+    case OpVarint32:
+    case OpVarint64:
+    case OpVaruint32:
+    case OpVaruint64:
+      if (isReadModifier(Modifier) && !In.readValue(Nd, LastReadValue)) {
+        throwCantRead();
+        return true;
+      }
+      if (isWriteModifier(Modifier) && !Out.writeValue(LastReadValue, Nd)) {
+        throwCantWrite();
+        return true;
+      }
+      Frame.ReturnValue = LastReadValue;
+      break;
+    case OpBinaryEval:
+      if (isReadModifier(Modifier) && !In.readBinary(Nd, LastReadValue)) {
+        throwCantRead();
+        return true;
+      }
+      if (isWriteModifier(Modifier) && !Out.writeBinary(LastReadValue, Nd)) {
+        throwCantWrite();
+        return true;
+      }
+      Frame.ReturnValue = LastReadValue;
+      break;
+  }
+  TRACE(node_ptr, "leaf", Nd);
+  TRACE(IntType, "returns", Frame.ReturnValue);
+  return true;
+}
+
+template <class ReaderT, class WriterT>
+bool Interpreter::evalLoopValues(ReaderT& In,
+                                 WriterT& Out,
+                                 MethodModifier Modifier,
+                                 const Node* Body) {
+  if (!isReadModifier(Modifier))
+    return false;
+  switch (Body->getType()) {
+    case OpUint8: {
+      size_t Count = copyBytes(In, Out, Modifier, LoopCounter);
+      LoopCounter -= Count;
+      return Count > 0;
+    }
+    case OpBit:
+    case OpUint32:
+    case OpUint64:
+    case OpVarint32:
+    case OpVarint64:
+    case OpVaruint32:
+    case OpVaruint64:
+      break;
+    default:
+      return false;
+  }
+  constexpr size_t MaxValues = 256;
+  IntType Values[MaxValues];
+  size_t Count = In.readValues(Body, std::min(LoopCounter, MaxValues), Values);
+  if (Count == 0)
+    return false;
+  LoopCounter -= Count;
+  LastReadValue = Values[Count - 1];
+  if (isWriteModifier(Modifier) && !Out.writeValues(Values, Count, Body))
+    throwCantWrite();
+  return true;
+}
+
+template <class ReaderT, class WriterT>
+size_t Interpreter::copyBytes(ReaderT& In,
+                              WriterT& Out,
+                              MethodModifier Modifier,
+                              size_t MaxBytes) {
+  constexpr size_t BufferSize = 4096;
+  uint8_t Buffer[BufferSize];
+  size_t Count = In.readBytes(Buffer, std::min(MaxBytes, BufferSize));
+  if (Count == 0)
+    return 0;
+  LastReadValue = Buffer[Count - 1];
+  if (isWriteModifier(Modifier) && !Out.writeBytes(Buffer, Count))
+    throwCantWrite();
+  return Count;
+}
+
 void Interpreter::popAndReturn(decode::IntType Value) {
   TRACE(IntType, "returns", Value);
   traceExitFrame();
@@ -624,15 +776,20 @@ void Interpreter::algorithmRead() {
 }
 
 void Interpreter::algorithmResume() {
+  resume(*Input, *Output);
+}
+
+template <class ReaderT, class WriterT>
+void Interpreter::resume(ReaderT& In, WriterT& Out) {
 // TODO(karlschimpf) Add catches for methods that modify local statcks, so
 // that state is correctly cleaned up on a throw.
 #if LOG_RUNMETHODS
   TRACE_METHOD("resume");
   TRACE_BLOCK({ describeState(tracE.getFile()); });
 #endif
-  if (!Input->canProcessMoreInputNow())
+  if (!In.canProcessMoreInputNow())
     return;
-  while (Input->stillMoreInputToProcessNow()) {
+  while (In.stillMoreInputToProcessNow()) {
     if (errorsFound())
       break;
 #if LOG_CALLSTACKS
@@ -647,12 +804,12 @@ void Interpreter::algorithmResume() {
             Frame.CallState = State::Loop;
             break;
           case State::Loop:
-            if (Input->atInputEob()) {
+            if (In.atInputEob()) {
               Frame.CallState = State::Exit;
               break;
             }
-            LastReadValue = Input->readUint8();
-            Output->writeUint8(LastReadValue);
+            copyBytes(In, Out, MethodModifier::ReadAndWrite,
+                      std::numeric_limits<size_t>::max());
             break;
           case State::Exit:
             popAndReturn();
@@ -709,7 +866,7 @@ void Interpreter::algorithmResume() {
                       "Format header contains badly formed constant");
                 IntTypeFormat TypeFormat = Lit->getIntTypeFormat();
                 IntType FoundValue;
-                if (!Input->readHeaderValue(TypeFormat, FoundValue)) {
+                if (!In.readHeaderValue(TypeFormat, FoundValue)) {
                   TRACE(IntType, "Found", FoundValue);
                   return throwMessage("Unable to read header value");
                 }
@@ -719,7 +876,7 @@ void Interpreter::algorithmResume() {
                   return throwBadHeaderValue(WantedValue, FoundValue,
                                              Lit->getFormat());
                 if (hasWriteMode())
-                  Output->writeHeaderValue(FoundValue, TypeFormat);
+                  Out.writeHeaderValue(FoundValue, TypeFormat);
                 break;
               }
               case State::Catch:
@@ -742,12 +899,14 @@ void Interpreter::algorithmResume() {
                 if (!hasReadMode())
                   return throwCantWriteInWriteOnlyMode();
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 LocalValues.push_back(Frame.ReturnValue);
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(1));
                 break;
               case State::Exit: {
                 IntType Arg2 = Frame.ReturnValue;
@@ -766,12 +925,14 @@ void Interpreter::algorithmResume() {
                 if (!hasReadMode())
                   return throwCantWriteInWriteOnlyMode();
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 LocalValues.push_back(Frame.ReturnValue);
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(1));
                 break;
               case State::Exit: {
                 IntType Arg2 = Frame.ReturnValue;
@@ -790,12 +951,14 @@ void Interpreter::algorithmResume() {
                 if (!hasReadMode())
                   return throwCantWriteInWriteOnlyMode();
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 LocalValues.push_back(Frame.ReturnValue);
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(1));
                 break;
               case State::Exit: {
                 IntType Arg2 = Frame.ReturnValue;
@@ -814,7 +977,8 @@ void Interpreter::algorithmResume() {
                 if (!hasReadMode())
                   return throwCantWriteInWriteOnlyMode();
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Exit: {
                 IntType Arg = Frame.ReturnValue;
@@ -829,7 +993,7 @@ void Interpreter::algorithmResume() {
           case OpCallback: {  // Method::Eval
             IntType Action =
                 cast<CallbackNode>(Frame.Nd)->getValue()->getValue();
-            if (!Input->readAction(Action) || !Output->writeAction(Action))
+            if (!In.readAction(Action) || !Out.writeAction(Action))
               return throwMessage("Unable to apply action: ", Action);
             popAndReturn(LastReadValue);
             break;
@@ -860,14 +1024,14 @@ void Interpreter::algorithmResume() {
           case OpPeek:
             switch (Frame.CallState) {
               case State::Enter:
-                if (!Input->pushPeekPos())
+                if (!In.pushPeekPos())
                   return failBadState();
                 Frame.CallState = State::Exit;
-                call(Method::Eval, MethodModifier::ReadOnly,
+                call(In, Out, Method::Eval, MethodModifier::ReadOnly,
                      Frame.Nd->getKid(0));
                 break;
               case State::Exit:
-                if (!Input->popPeekPos())
+                if (!In.popPeekPos())
                   return failBadState();
                 popAndReturn(Frame.ReturnValue);
                 break;
@@ -879,7 +1043,7 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Exit;
-                call(Method::Eval, MethodModifier::ReadOnly,
+                call(In, Out, Method::Eval, MethodModifier::ReadOnly,
                      Frame.Nd->getKid(0));
                 break;
               case State::Exit:
@@ -898,10 +1062,10 @@ void Interpreter::algorithmResume() {
           case OpVaruint32:
           case OpVaruint64: {
             if (hasReadMode())
-              if (!Input->readValue(Frame.Nd, LastReadValue))
+              if (!In.readValue(Frame.Nd, LastReadValue))
                 return throwCantRead();
             if (hasWriteMode()) {
-              if (!Output->writeValue(LastReadValue, Frame.Nd))
+              if (!Out.writeValue(LastReadValue, Frame.Nd))
                 return throwCantWrite();
             }
             popAndReturn(LastReadValue);
@@ -909,10 +1073,10 @@ void Interpreter::algorithmResume() {
           }
           case OpBinaryEval:
             if (hasReadMode())
-              if (!Input->readBinary(Frame.Nd, LastReadValue))
+              if (!In.readBinary(Frame.Nd, LastReadValue))
                 return throwCantRead();
             if (hasWriteMode())
-              if (!Output->writeBinary(LastReadValue, Frame.Nd))
+              if (!Out.writeBinary(LastReadValue, Frame.Nd))
                 return throwCantWrite();
             popAndReturn(LastReadValue);
             break;
@@ -921,13 +1085,14 @@ void Interpreter::algorithmResume() {
               case State::Enter:
                 Frame.CallState = State::Step2;
                 if (hasReadMode())
-                  call(Method::Eval, MethodModifier::ReadOnly, Frame.Nd);
+                  call(In, Out, Method::Eval, MethodModifier::ReadOnly,
+                       Frame.Nd);
                 break;
               case State::Step2:
                 Frame.CallState = State::Exit;
                 if (hasReadMode()) {
                   LastReadValue = Frame.ReturnValue;
-                  call(Method::Eval, MethodModifier::ReadOnly,
+                  call(In, Out, Method::Eval, MethodModifier::ReadOnly,
                        cast<MapNode>(Frame.Nd)->getCase(LastReadValue));
                 }
                 break;
@@ -946,7 +1111,8 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(1));
                 break;
               case State::Exit: {
                 const auto* Local = dyn_cast<LocalNode>(Frame.Nd->getKid(0));
@@ -975,12 +1141,12 @@ void Interpreter::algorithmResume() {
                   break;
                 }
                 Frame.CallState = State::Step2;
-                call(Method::Eval, MethodModifier::ReadOnly,
+                call(In, Out, Method::Eval, MethodModifier::ReadOnly,
                      Frame.Nd->getKid(LoopCounter));
                 break;
               case State::Step2:
                 Frame.CallState = State::Loop;
-                call(Method::Eval, MethodModifier::WriteOnly,
+                call(In, Out, Method::Eval, MethodModifier::WriteOnly,
                      Frame.Nd->getKid(0));
                 break;
               case State::Exit:
@@ -997,7 +1163,8 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Exit: {
                 popAndReturn(Frame.ReturnValue);
@@ -1013,12 +1180,14 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 Frame.CallState = State::Exit;
                 if (Frame.ReturnValue != 0)
-                  call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                  call(In, Out, Method::Eval, Frame.CallModifier,
+                       Frame.Nd->getKid(1));
                 break;
               case State::Exit: {
                 popAndReturn(Frame.ReturnValue);
@@ -1034,12 +1203,14 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 Frame.CallState = State::Exit;
                 if (Frame.ReturnValue == 0)
-                  call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                  call(In, Out, Method::Eval, Frame.CallModifier,
+                       Frame.Nd->getKid(1));
                 break;
               case State::Exit: {
                 popAndReturn(Frame.ReturnValue);
@@ -1060,7 +1231,7 @@ void Interpreter::algorithmResume() {
                   Frame.CallState = State::Exit;
                   break;
                 }
-                call(Method::Eval, Frame.CallModifier,
+                call(In, Out, Method::Eval, Frame.CallModifier,
                      Frame.Nd->getKid(LoopCounter++));
                 break;
               case State::Exit:
@@ -1075,24 +1246,26 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 if (hasReadMode())
-                  if (!Input->tablePush(Frame.ReturnValue))
+                  if (!In.tablePush(Frame.ReturnValue))
                     return throwCantRead();
                 if (hasWriteMode())
-                  if (!Output->tablePush(Frame.ReturnValue))
+                  if (!Out.tablePush(Frame.ReturnValue))
                     return throwCantWrite();
                 Frame.CallState = State::Step3;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(1));
                 break;
               case State::Exit:
                 if (hasReadMode())
-                  if (!Input->tablePop())
+                  if (!In.tablePop())
                     return throwCantRead();
                 if (hasWriteMode())
-                  if (!Output->tablePop())
+                  if (!Out.tablePop())
                     return throwCantWrite();
                 popAndReturn(LastReadValue);
                 break;
@@ -1104,18 +1277,24 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 LoopCounterStack.push(Frame.ReturnValue);
                 Frame.CallState = State::Loop;
                 break;
               case State::Loop:
+                if (Flags.FastEval && LoopCounter > 0 &&
+                    evalLoopValues(In, Out, Frame.CallModifier,
+                                   Frame.Nd->getKid(1)))
+                  break;
                 if (LoopCounter-- == 0) {
                   Frame.CallState = State::Exit;
                   break;
                 }
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(1));
                 break;
               case State::Exit:
                 LoopCounterStack.pop();
@@ -1131,11 +1310,19 @@ void Interpreter::algorithmResume() {
                 Frame.CallState = State::Loop;
                 break;
               case State::Loop:
-                if (Input->atInputEob()) {
+                if (In.atInputEob()) {
                   Frame.CallState = State::Exit;
                   break;
                 }
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                // Note: Copies unknown sections a page at a time.
+                if (Flags.FastEval &&
+                    Frame.Nd->getKid(0)->getType() == OpUint8 &&
+                    isReadModifier(Frame.CallModifier) &&
+                    copyBytes(In, Out, Frame.CallModifier,
+                              std::numeric_limits<size_t>::max()) > 0)
+                  break;
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Exit:
                 popAndReturn();
@@ -1148,12 +1335,14 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 Frame.CallState = State::Exit;
                 if (Frame.ReturnValue != 0)
-                  call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                  call(In, Out, Method::Eval, Frame.CallModifier,
+                       Frame.Nd->getKid(1));
                 break;
               case State::Exit:
                 popAndReturn();
@@ -1166,14 +1355,17 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2:
                 Frame.CallState = State::Exit;
                 if (Frame.ReturnValue)
-                  call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                  call(In, Out, Method::Eval, Frame.CallModifier,
+                       Frame.Nd->getKid(1));
                 else
-                  call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(2));
+                  call(In, Out, Method::Eval, Frame.CallModifier,
+                       Frame.Nd->getKid(2));
                 break;
               case State::Exit:
                 popAndReturn();
@@ -1186,15 +1378,17 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(0));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(0));
                 break;
               case State::Step2: {
                 Frame.CallState = State::Exit;
                 const auto* Sel = cast<SwitchNode>(Frame.Nd);
                 if (const auto* Case = Sel->getCase(Frame.ReturnValue))
-                  call(Method::Eval, Frame.CallModifier, Case);
+                  call(In, Out, Method::Eval, Frame.CallModifier, Case);
                 else
-                  call(Method::Eval, Frame.CallModifier, Sel->getKid(1));
+                  call(In, Out, Method::Eval, Frame.CallModifier,
+                       Sel->getKid(1));
                 break;
               }
               case State::Exit:
@@ -1208,7 +1402,8 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Frame.Nd->getKid(1));
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Frame.Nd->getKid(1));
                 break;
               case State::Exit:
                 popAndReturn();
@@ -1227,7 +1422,8 @@ void Interpreter::algorithmResume() {
                     LocalValues.push_back(0);
                 }
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Define->getBody());
+                call(In, Out, Method::Eval, Frame.CallModifier,
+                     Define->getBody());
                 break;
               }
               case State::Exit: {
@@ -1249,7 +1445,7 @@ void Interpreter::algorithmResume() {
               case State::Enter:
                 Frame.CallState = State::Exit;
                 DispatchedMethod = Method::Eval;
-                call(Method::EvalParam, Frame.CallModifier, Frame.Nd);
+                call(In, Out, Method::EvalParam, Frame.CallModifier, Frame.Nd);
                 break;
               case State::Exit:
                 popAndReturn();
@@ -1269,13 +1465,13 @@ void Interpreter::algorithmResume() {
                 // from the current algorithm, not the algorithm the symbol was
                 // defined in.
                 const LiteralActionDefNode* Defn =
-                    Symtab->getSymbolDefn(Sym)->getLiteralActionDefinition();
+                    cast<LiteralActionUseNode>(Frame.Nd)->getDef(*Symtab);
                 if (Defn == nullptr) {
                   fprintf(stderr, "Eval can't find literal action: %s\n",
                           Sym->getName().c_str());
                   return throwMessage("Unable to evaluate literal action");
                 }
-                call(Method::Eval, Frame.CallModifier, Defn);
+                call(In, Out, Method::Eval, Frame.CallModifier, Defn);
                 break;
               }
               case State::Exit:
@@ -1296,13 +1492,13 @@ void Interpreter::algorithmResume() {
                 // from the current algorithm, not the algorithm the symbol was
                 // defined in.
                 const LiteralDefNode* Defn =
-                    Symtab->getSymbolDefn(Sym)->getLiteralDefinition();
+                    cast<LiteralUseNode>(Frame.Nd)->getDef(*Symtab);
                 if (Defn == nullptr) {
                   fprintf(stderr, "Eval can't find literal: %s\n",
                           Sym->getName().c_str());
                   return throwMessage("Unable to evaluate literal");
                 }
-                call(Method::Eval, Frame.CallModifier, Defn);
+                call(In, Out, Method::Eval, Frame.CallModifier, Defn);
                 break;
               }
               case State::Exit:
@@ -1322,7 +1518,7 @@ void Interpreter::algorithmResume() {
                 // from the current algorithm, not the algorithm the symbol was
                 // defined in.
                 const DefineNode* Defn =
-                    Symtab->getSymbolDefn(Sym)->getDefineDefinition();
+                    cast<EvalNode>(Frame.Nd)->getDef(*Symtab);
                 if (Defn == nullptr) {
                   fprintf(stderr, "Eval can't find definition: %s\n",
                           Sym->getName().c_str());
@@ -1344,7 +1540,7 @@ void Interpreter::algorithmResume() {
                 CallingEval.Caller = cast<EvalNode>(Frame.Nd);
                 CallingEval.CallingEvalIndex = CallingEvalIndex;
                 Frame.CallState = State::Exit;
-                call(Method::Eval, Frame.CallModifier, Defn);
+                call(In, Out, Method::Eval, Frame.CallModifier, Defn);
                 break;
               }
               case State::Exit:
@@ -1371,7 +1567,7 @@ void Interpreter::algorithmResume() {
 #endif
                 Frame.CallState = State::Exit;
                 DispatchedMethod = Method::Eval;
-                call(Method::EvalBlock, Frame.CallModifier,
+                call(In, Out, Method::EvalBlock, Frame.CallModifier,
                      Frame.Nd->getKid(0));
                 break;
               case State::Exit:
@@ -1399,17 +1595,15 @@ void Interpreter::algorithmResume() {
         switch (Frame.CallState) {
           case State::Enter: {
             IntType EnterBlock = IntType(PredefinedSymbol::Block_enter);
-            if (!Input->readAction(EnterBlock) ||
-                !Output->writeAction(EnterBlock))
+            if (!In.readAction(EnterBlock) || !Out.writeAction(EnterBlock))
               return fatal("Unable to enter block");
             Frame.CallState = State::Exit;
-            call(DispatchedMethod, Frame.CallModifier, Frame.Nd);
+            call(In, Out, DispatchedMethod, Frame.CallModifier, Frame.Nd);
             break;
           }
           case State::Exit: {
             IntType ExitBlock = IntType(PredefinedSymbol::Block_exit);
-            if (!Input->readAction(ExitBlock) ||
-                !Output->writeAction(ExitBlock))
+            if (!In.readAction(ExitBlock) || !Out.writeAction(ExitBlock))
               return fatal("unable to close block");
             popAndReturn();
             break;
@@ -1418,6 +1612,31 @@ void Interpreter::algorithmResume() {
             return failBadState();
         }
         break;
+      case Method::EvalCode:
+        switch (Frame.CallState) {
+          case State::Enter: {
+            if (!Code || Code->getSymtab() != Symtab.get())
+              Code = std::make_shared<InterpreterCode>(Symtab);
+            CodeReturnStack.clear();
+            CodeValue = 0;
+            CodeAddress = Code->getEntryAddress(
+                Code->getEntry(cast<DefineNode>(Frame.Nd),
+                               uint8_t(Frame.CallModifier)));
+            Frame.CallState = State::Loop;
+            break;
+          }
+          case State::Loop:
+            runCode(In, Out);
+            break;
+          case State::Step2:
+            // Returned from a node evaluated by the interpreter.
+            CodeValue = Frame.ReturnValue;
+            Frame.CallState = State::Loop;
+            break;
+          default:
+            return failBadState();
+        }
+        break;
       case Method::EvalParam:
         switch (Frame.CallState) {
           case State::Enter: {
@@ -1435,7 +1654,7 @@ void Interpreter::algorithmResume() {
             CallingEvalStack.push(
                 CallingEvalStack.at(CallingEval.CallingEvalIndex));
             Frame.CallState = State::Exit;
-            call(DispatchedMethod, Frame.CallModifier, Context);
+            call(In, Out, DispatchedMethod, Frame.CallModifier, Context);
             break;
           }
           case State::Exit:
@@ -1453,7 +1672,7 @@ void Interpreter::algorithmResume() {
             assert(CatchStack.empty());
             assert(LoopCounterStack.empty());
             CatchStack.push(Method::GetAlgorithm);
-            if (!Input->pushPeekPos())
+            if (!In.pushPeekPos())
               return failBadState();
             LoopCounterStack.push(0);
             Frame.CallState = State::Loop;
@@ -1463,13 +1682,13 @@ void Interpreter::algorithmResume() {
             assert(LoopCounterStack.size() == 1);
             if (LoopCounter >= Selectors.size()) {
               CatchStack.pop();
-              if (!Input->popPeekPos())
+              if (!In.popPeekPos())
                 return failBadState();
               LoopCounterStack.pop();
               return throwMessage("Unable to find algorithm to apply!");
             }
             Frame.CallState = State::Step2;
-            call(Method::Eval, MethodModifier::ReadOnly,
+            call(In, Out, Method::Eval, MethodModifier::ReadOnly,
                  Selectors[LoopCounter]->getSymtab()->getTargetHeader());
             break;
           case State::Step2:
@@ -1477,7 +1696,7 @@ void Interpreter::algorithmResume() {
             assert(LoopCounterStack.size() == 1);
             // Found algorithm. Install and then use.
             CatchStack.pop();
-            if (!Input->popPeekPos())
+            if (!In.popPeekPos())
               return failBadState();
             TRACE(size_t, "Select counter", LoopCounter);
             if (!Selectors[LoopCounter]->configure(this))
@@ -1485,6 +1704,9 @@ void Interpreter::algorithmResume() {
             if (!Symtab)
               return fail("No algorithm defined for selected algorithm!");
             Frame.CallState = State::Step3;
+            // The selector may have replaced the reader or writer.
+            if (&In != Input.get() || &Out != Output.get())
+              return algorithmResume();
             break;
           case State::Step3:
             assert(CatchStack.empty());
@@ -1495,35 +1717,38 @@ void Interpreter::algorithmResume() {
               TextWriter Writer;
               (++Writer).write(stderr, Symtab.get());
             }
-            call(Method::GetFile, Frame.CallModifier, Frame.Nd);
+            call(In, Out, Method::GetFile, Frame.CallModifier, Frame.Nd);
             break;
           case State::Step4:
             assert(CatchStack.empty());
             assert(LoopCounterStack.size() == 1);
             // Parsed data associated with algorithm. Now process rest of input.
             TRACE(size_t, "Select counter", LoopCounter);
-            if (Selectors[LoopCounter]->reset(this)) {
-              if (Symtab) {
-                TRACE_MESSAGE("Reset with symtab");
-                // Defined a symbol table to apply next, so process it without
-                // changing the selector.
-                Frame.CallState = State::Step3;
-                break;
-              }
-            } else
+            if (!Selectors[LoopCounter]->reset(this))
               return throwMessage(
                   "Unable to reset state after appplying algorithm");
-            TRACE_MESSAGE("Reset did not specify any more symtabs");
-            if (Input->atInputEob()) {
-              LoopCounterStack.pop();
-              Frame.CallState = State::Exit;
-              break;
+            if (Symtab) {
+              TRACE_MESSAGE("Reset with symtab");
+              // Defined a symbol table to apply next, so process it without
+              // changing the selector.
+              Frame.CallState = State::Step3;
+            } else {
+              TRACE_MESSAGE("Reset did not specify any more symtabs");
+              // Note: Uses Input, since the selector may have replaced it.
+              if (Input->atInputEob()) {
+                LoopCounterStack.pop();
+                Frame.CallState = State::Exit;
+              } else {
+                CatchStack.push(Method::GetAlgorithm);
+                if (!Input->pushPeekPos())
+                  return failBadState();
+                LoopCounter = 0;
+                Frame.CallState = State::Loop;
+              }
             }
-            CatchStack.push(Method::GetAlgorithm);
-            if (!Input->pushPeekPos())
-              return failBadState();
-            LoopCounter = 0;
-            Frame.CallState = State::Loop;
+            // The selector may have replaced the reader or writer.
+            if (&In != Input.get() || &Out != Output.get())
+              return algorithmResume();
             break;
           case State::Catch:
             assert(CatchStack.empty());
@@ -1533,7 +1758,7 @@ void Interpreter::algorithmResume() {
               case State::Step2:
                 assert(LoopCounterStack.size() == 1);
                 CatchStack.push(Method::GetAlgorithm);
-                if (!(Input->popPeekPos() && Input->pushPeekPos()))
+                if (!(In.popPeekPos() && In.pushPeekPos()))
                   return failBadState();
                 LoopCounter++;
                 Frame.CallState = State::Loop;
@@ -1562,12 +1787,12 @@ void Interpreter::algorithmResume() {
             if (!isa<FileHeaderNode>(Header))
               return fail("Can't find matching header definition");
             Frame.CallState = State::Step2;
-            call(Method::Eval, Frame.CallModifier, Header);
+            call(In, Out, Method::Eval, Frame.CallModifier, Header);
             break;
           }
           case State::Step2: {
             Frame.CallState = State::Exit;
-            if (!Output->writeHeaderClose())
+            if (!Out.writeHeaderClose())
               return fail("Unable to write header");
             SymbolNode* File = Symtab->getPredefined(PredefinedSymbol::File);
             if (File == nullptr)
@@ -1575,11 +1800,14 @@ void Interpreter::algorithmResume() {
             const Node* FileDefn = File->getDefineDefinition();
             if (FileDefn == nullptr)
               throwMessage("Can't find sexpression to process file");
-            call(Method::Eval, Frame.CallModifier, FileDefn);
+            if (Flags.ThreadedEval)
+              pushCall(Method::EvalCode, Frame.CallModifier, FileDefn);
+            else
+              call(In, Out, Method::Eval, Frame.CallModifier, FileDefn);
             break;
           }
           case State::Exit:
-            if (FreezeEofAtExit && !Output->writeFreezeEof())
+            if (FreezeEofAtExit && !Out.writeFreezeEof())
               return throwCantFreezeEof();
             popAndReturn();
             break;
@@ -1596,7 +1824,7 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Step2;
-                call(Method::ReadOpcode, Frame.CallModifier,
+                call(In, Out, Method::ReadOpcode, Frame.CallModifier,
                      Frame.Nd->getKid(0));
                 break;
               case State::Step2: {
@@ -1605,7 +1833,7 @@ void Interpreter::algorithmResume() {
                         Sel->getCase(OpcodeLocals.CaseMask)) {
                   Frame.CallState = State::Step3;
                   OpcodeLocalsStack.push();
-                  call(Method::ReadOpcode, Frame.CallModifier, Case);
+                  call(In, Out, Method::ReadOpcode, Frame.CallModifier, Case);
                   break;
                 }
                 Frame.CallState = State::Exit;
@@ -1631,7 +1859,7 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Exit;
-                call(Method::Eval, MethodModifier::ReadOnly, Frame.Nd);
+                call(In, Out, Method::Eval, MethodModifier::ReadOnly, Frame.Nd);
                 break;
               case State::Exit:
                 OpcodeLocals.CaseMask = Frame.ReturnValue;
@@ -1645,7 +1873,7 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Exit;
-                call(Method::Eval, MethodModifier::ReadOnly, Frame.Nd);
+                call(In, Out, Method::Eval, MethodModifier::ReadOnly, Frame.Nd);
                 break;
               case State::Exit:
                 OpcodeLocals.CaseMask = Frame.ReturnValue;
@@ -1660,7 +1888,7 @@ void Interpreter::algorithmResume() {
             switch (Frame.CallState) {
               case State::Enter:
                 Frame.CallState = State::Exit;
-                call(Method::Eval, MethodModifier::ReadOnly, Frame.Nd);
+                call(In, Out, Method::Eval, MethodModifier::ReadOnly, Frame.Nd);
                 break;
               case State::Exit:
                 OpcodeLocals.CaseMask = Frame.ReturnValue;
@@ -1681,6 +1909,200 @@ void Interpreter::algorithmResume() {
 #endif
 }
 
+template <class ReaderT, class WriterT>
+void Interpreter::runCode(ReaderT& In, WriterT& Out) {
+  typedef InterpreterCode::Opcode Opcode;
+  size_t Address = CodeAddress;
+  IntType Value = CodeValue;
+  while (true) {
+    const InterpreterCode::Instruction& Inst = Code->getInstruction(Address);
+    // Note: Like resume(), only reads when input is available, so that
+    // evaluation can stop here and resume when more input is added.
+    if (Inst.MayRead && !In.stillMoreInputToProcessNow())
+      break;
+    const MethodModifier Modifier = MethodModifier(Inst.Modifier);
+    switch (Inst.Op) {
+      case Opcode::NO_SUCH_OPCODE:
+        return failBadState();
+      case Opcode::Interpret:
+        CodeAddress = Address + 1;
+        CodeValue = Value;
+        Frame.CallState = State::Step2;
+        return call(In, Out, Method::Eval, Modifier, Inst.Nd);
+      case Opcode::Zero:
+        Value = 0;
+        break;
+      case Opcode::Const:
+        Value = Inst.Value;
+        if (isReadModifier(Modifier))
+          LastReadValue = Value;
+        break;
+      case Opcode::LastRead:
+        Value = LastReadValue;
+        break;
+      case Opcode::Local:
+        if (LocalsBase + Inst.Arg >= LocalValues.size())
+          return throwMessage("Local variable index out of range!");
+        Value = LocalValues[LocalsBase + Inst.Arg];
+        break;
+      case Opcode::SetLocal:
+        if (LocalsBase + Inst.Arg >= LocalValues.size())
+          return throwMessage("Local variable index out of range, can't set!");
+        LocalValues[LocalsBase + Inst.Arg] = Value;
+        Value = LastReadValue;
+        break;
+      case Opcode::Value:
+        if (isReadModifier(Modifier) && !In.readValue(Inst.Nd, LastReadValue))
+          return throwCantRead();
+        if (isWriteModifier(Modifier) &&
+            !Out.writeValue(LastReadValue, Inst.Nd))
+          return throwCantWrite();
+        Value = LastReadValue;
+        break;
+      case Opcode::BinaryValue:
+        if (isReadModifier(Modifier) && !In.readBinary(Inst.Nd, LastReadValue))
+          return throwCantRead();
+        if (isWriteModifier(Modifier) &&
+            !Out.writeBinary(LastReadValue, Inst.Nd))
+          return throwCantWrite();
+        Value = LastReadValue;
+        break;
+      case Opcode::Callback:
+        if (!In.readAction(Inst.Value) || !Out.writeAction(Inst.Value))
+          return throwMessage("Unable to apply action: ", Inst.Value);
+        Value = LastReadValue;
+        break;
+      case Opcode::BlockEnter: {
+        IntType EnterBlock = IntType(PredefinedSymbol::Block_enter);
+        if (!In.readAction(EnterBlock) || !Out.writeAction(EnterBlock))
+          return fatal("Unable to enter block");
+        break;
+      }
+      case Opcode::BlockExit: {
+        IntType ExitBlock = IntType(PredefinedSymbol::Block_exit);
+        if (!In.readAction(ExitBlock) || !Out.writeAction(ExitBlock))
+          return fatal("unable to close block");
+        break;
+      }
+      case Opcode::Error:
+        return throwMessage("Algorithm error!");
+      case Opcode::PeekEnter:
+        if (!In.pushPeekPos())
+          return failBadState();
+        break;
+      case Opcode::PeekExit:
+        if (!In.popPeekPos())
+          return failBadState();
+        break;
+      case Opcode::PushValue:
+        LocalValues.push_back(Value);
+        break;
+      case Opcode::BitwiseAnd:
+        Value = LocalValues.back() & Value;
+        LocalValues.pop_back();
+        break;
+      case Opcode::BitwiseOr:
+        Value = LocalValues.back() | Value;
+        LocalValues.pop_back();
+        break;
+      case Opcode::BitwiseXor:
+        Value = LocalValues.back() ^ Value;
+        LocalValues.pop_back();
+        break;
+      case Opcode::Jump:
+        Address = Inst.Arg;
+        continue;
+      case Opcode::JumpIfZero:
+        if (Value == 0) {
+          Address = Inst.Arg;
+          continue;
+        }
+        break;
+      case Opcode::JumpIfNonZero:
+        if (Value != 0) {
+          Address = Inst.Arg;
+          continue;
+        }
+        break;
+      case Opcode::LoopEnter:
+        LoopCounterStack.push(Value);
+        break;
+      case Opcode::LoopNext:
+        if (Flags.FastEval && LoopCounter > 0 &&
+            evalLoopValues(In, Out, Modifier, Inst.Nd)) {
+          // Note: Returns if the write failed.
+          if (Frame.CallMethod != Method::EvalCode)
+            return;
+          continue;
+        }
+        if (LoopCounter-- == 0) {
+          Address = Inst.Arg;
+          continue;
+        }
+        break;
+      case Opcode::LoopExit:
+        LoopCounterStack.pop();
+        Value = 0;
+        break;
+      case Opcode::LoopUnboundedNext:
+        if (In.atInputEob()) {
+          Address = Inst.Arg;
+          continue;
+        }
+        // Note: Copies unknown sections a page at a time.
+        if (Flags.FastEval && Inst.Nd->getType() == OpUint8 &&
+            isReadModifier(Modifier) &&
+            copyBytes(In, Out, Modifier, std::numeric_limits<size_t>::max()) >
+                0) {
+          if (Frame.CallMethod != Method::EvalCode)
+            return;
+          continue;
+        }
+        break;
+      case Opcode::Switch:
+        Address = Code->getCaseAddress(Inst.Arg, Value);
+        continue;
+      case Opcode::Call: {
+        size_t CallingEvalIndex = CallingEvalStack.size();
+        CallingEvalStack.push();
+        CallingEval.Caller = cast<EvalNode>(Inst.Nd);
+        CallingEval.CallingEvalIndex = CallingEvalIndex;
+        CodeReturnStack.push_back(Address + 1);
+        Address = Code->getEntryAddress(Inst.Arg);
+        continue;
+      }
+      case Opcode::CallExit:
+        CallingEvalStack.pop();
+        Value = LastReadValue;
+        break;
+      case Opcode::DefineEnter:
+        if (Inst.Arg) {
+          LocalsBaseStack.push(LocalValues.size());
+          for (size_t i = 0; i < Inst.Arg; ++i)
+            LocalValues.push_back(0);
+        }
+        break;
+      case Opcode::DefineExit:
+        if (Inst.Arg) {
+          while (LocalValues.size() > LocalsBase)
+            LocalValues.pop_back();
+          LocalsBaseStack.pop();
+        }
+        Value = 0;
+        break;
+      case Opcode::Return:
+        if (CodeReturnStack.empty())
+          return popAndReturn(Value);
+        Address = CodeReturnStack.back();
+        CodeReturnStack.pop_back();
+        continue;
+    }
+    ++Address;
+  }
+  CodeAddress = Address;
+  CodeValue = Value;
+}
+
 void Interpreter::algorithmReadBackFilled() {
 #if LOG_RUNMETHODS
   TRACE_METHOD("readBackFilled");
@@ -1692,6 +2114,40 @@ void Interpreter::algorithmReadBackFilled() {
   }
 }
 
+template <class ReaderT, class WriterT>
+InterpreterT<ReaderT, WriterT>::InterpreterT(
+    std::shared_ptr<ReaderT> Input,
+    std::shared_ptr<WriterT> Output,
+    const InterpreterFlags& Flags,
+    std::shared_ptr<filt::SymbolTable> Symtab)
+    : Interpreter(Input, Output, Flags, Symtab),
+      TypedInput(Input.get()),
+      TypedOutput(Output.get()) {
+}
+
+template <class ReaderT, class WriterT>
+InterpreterT<ReaderT, WriterT>::InterpreterT(std::shared_ptr<ReaderT> Input,
+                                             std::shared_ptr<WriterT> Output,
+                                             const InterpreterFlags& Flags)
+    : Interpreter(Input, Output, Flags),
+      TypedInput(Input.get()),
+      TypedOutput(Output.get()) {
+}
+
+template <class ReaderT, class WriterT>
+InterpreterT<ReaderT, WriterT>::~InterpreterT() {
+}
+
+template <class ReaderT, class WriterT>
+void InterpreterT<ReaderT, WriterT>::algorithmResume() {
+  if (Input.get() == TypedInput && Output.get() == TypedOutput)
+    return resume(*TypedInput, *TypedOutput);
+  Interpreter::algorithmResume();
+}
+
+template class InterpreterT<ByteReader, ByteWriter>;
+template class InterpreterT<ByteReader, IntWriter>;
+
 }  // end of namespace interp
 
 }  // end of namespace wasm
@@ -43,6 +43,7 @@ namespace interp {
 
 class AlgorithmSelector;
 class Interpreter;
+class InterpreterCode;
 class Reader;
 class Writer;
 
@@ -92,7 +93,7 @@ class Interpreter {
   // Resumes decompression where it left off. Assumes that more
   // input has been added since the previous start()/resume() call.
   // Resume should be called until isFinished() is true.
-  void algorithmResume();
+  virtual void algorithmResume();
 
   // Reads from backfilled input stream.
   void algorithmReadBackFilled();
@@ -268,6 +269,14 @@ class Interpreter {
   const filt::FileHeaderNode* HeaderOverride;
   bool FreezeEofAtExit;
 
+  // The (threaded) code the define bodies of Symtab are lowered to, and the
+  // state of Method::EvalCode: the address of the next instruction, the
+  // value of the last evaluated instruction, and the addresses to return to.
+  std::shared_ptr<InterpreterCode> Code;
+  size_t CodeAddress;
+  decode::IntType CodeValue;
+  std::vector<size_t> CodeReturnStack;
+
   void reset();
 
   void handleOtherMethods();
@@ -277,6 +286,55 @@ class Interpreter {
   void callTopLevel(Method Method, const filt::Node* Nd);
 
   void call(Method Method, MethodModifier Modifier, const filt::Node* Nd);
+  // Pushes a call frame for Method with argument Nd.
+  void pushCall(Method Method, MethodModifier Modifier, const filt::Node* Nd);
+
+  // The methods below are templates on the type of the reader (In) and
+  // writer (Out), so that reads and writes in the interpreter loop can be
+  // resolved statically (see InterpreterT). They are only instantiated in
+  // Interpreter.cpp.
+  template <class ReaderT, class WriterT>
+  void resume(ReaderT& In, WriterT& Out);
+
+  template <class ReaderT, class WriterT>
+  void call(ReaderT& In,
+            WriterT& Out,
+            Method Method,
+            MethodModifier Modifier,
+            const filt::Node* Nd);
+
+  // Evaluates Nd in the current frame (leaving the result in
+  // Frame.ReturnValue) if it is a leaf node. Returns false if Nd must be
+  // evaluated by calling method Eval.
+  template <class ReaderT, class WriterT>
+  bool evalLeaf(ReaderT& In,
+                WriterT& Out,
+                MethodModifier Modifier,
+                const filt::Node* Nd);
+
+  // Evaluates (a batch of) the remaining iterations of a loop in the current
+  // frame, if the loop Body is a single format node. Returns false if
+  // no iterations were evaluated.
+  template <class ReaderT, class WriterT>
+  bool evalLoopValues(ReaderT& In,
+                      WriterT& Out,
+                      MethodModifier Modifier,
+                      const filt::Node* Body);
+
+  // Copies (a batch of) up to MaxBytes uint8 values from input to output
+  // (writing only if a write modifier), stopping early at the end of the
+  // current block. Returns the number of bytes copied.
+  template <class ReaderT, class WriterT>
+  size_t copyBytes(ReaderT& In,
+                   WriterT& Out,
+                   MethodModifier Modifier,
+                   size_t MaxBytes);
+
+  // Runs the instructions of Code, starting at CodeAddress, until the
+  // lowered define returns, a node must be evaluated by the interpreter, or
+  // the next instruction reads and no more input is available.
+  template <class ReaderT, class WriterT>
+  void runCode(ReaderT& In, WriterT& Out);
 
   void popAndReturn(decode::IntType Value = 0);
 
@@ -297,6 +355,35 @@ class Interpreter {
   void init();
 };
 
+// Defines an interpreter specialized on the (concrete) types of its reader
+// and writer, so that the reads and writes of the interpreter loop are not
+// virtual calls. Falls back to the generic interpreter loop if the reader or
+// writer is replaced (for example, while an algorithm selector reads an
+// algorithm). Instantiated (in Interpreter.cpp) for ByteReader with
+// ByteWriter and IntWriter.
+template <class ReaderT, class WriterT>
+class InterpreterT : public Interpreter {
+  InterpreterT() = delete;
+  InterpreterT(const InterpreterT&) = delete;
+  InterpreterT& operator=(const InterpreterT&) = delete;
+
+ public:
+  InterpreterT(std::shared_ptr<ReaderT> Input,
+               std::shared_ptr<WriterT> Output,
+               const InterpreterFlags& Flags,
+               std::shared_ptr<filt::SymbolTable> Symtab);
+  InterpreterT(std::shared_ptr<ReaderT> Input,
+               std::shared_ptr<WriterT> Output,
+               const InterpreterFlags& Flags);
+  ~InterpreterT() OVERRIDE;
+
+  void algorithmResume() OVERRIDE;
+
+ private:
+  ReaderT* TypedInput;
+  WriterT* TypedOutput;
+};
+
 }  // end of namespace interp
 
 }  // end of namespace wasm
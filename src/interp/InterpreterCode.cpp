@@ -0,0 +1,373 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Implements the (threaded) code that the interpreter lowers the define
+// bodies of an algorithm to.
+
+#include "interp/InterpreterCode.h"
+
+#include <algorithm>
+
+#include "sexp/Ast.h"
+#include "sexp/TextWriter.h"
+#include "utils/Casting.h"
+
+namespace wasm {
+
+using namespace decode;
+using namespace filt;
+using namespace utils;
+
+namespace interp {
+
+namespace {
+
+const char* OpcodeName[] = {
+#define X(tag, may_read) #tag,
+    INTERPRETER_CODE_OPCODES_TABLE
+#undef X
+    "NO_SUCH_OPCODE"};
+
+const bool OpcodeMayRead[] = {
+#define X(tag, may_read) may_read,
+    INTERPRETER_CODE_OPCODES_TABLE
+#undef X
+    false};
+
+// Only use a (dense) case table if it isn't (much) bigger than the number of
+// cases (see SelectBaseNode::installCaseTable()).
+constexpr size_t MinCaseTableSize = 256;
+
+// Returns the number of cases within Nd that are installed on (the
+// enclosing) selector Nd (see CaseNode::validateNode()).
+size_t countCases(const Node* Nd) {
+  size_t Count = 0;
+  for (const Node* Kid : *Nd) {
+    if (isa<SelectBaseNode>(Kid))
+      continue;
+    if (isa<CaseNode>(Kid))
+      ++Count;
+    Count += countCases(Kid);
+  }
+  return Count;
+}
+
+}  // end of anonymous namespace
+
+const char* InterpreterCode::getName(Opcode Op) {
+  size_t Index = size_t(Op);
+  if (Index >= size(OpcodeName))
+    Index = size_t(Opcode::NO_SUCH_OPCODE);
+  return OpcodeName[Index];
+}
+
+InterpreterCode::InterpreterCode(std::shared_ptr<SymbolTable> Symtab)
+    : Symtab(Symtab) {
+}
+
+InterpreterCode::~InterpreterCode() {
+}
+
+size_t InterpreterCode::getEntry(const DefineNode* Defn, uint8_t Modifier) {
+  auto Key = std::make_pair(Defn, Modifier);
+  const auto Iter = EntryLookup.find(Key);
+  if (Iter != EntryLookup.end())
+    return Iter->second;
+  size_t Entry = Entries.size();
+  Entries.push_back({Defn, Modifier, NoAddress});
+  EntryLookup[Key] = Entry;
+  return Entry;
+}
+
+size_t InterpreterCode::compileEntry(size_t Entry) {
+  // Note: Copies the entry, since compiling may add entries.
+  EntryInfo Info = Entries[Entry];
+  size_t Address = Code.size();
+  Entries[Entry].Address = Address;
+  size_t NumLocals = Info.Defn->getNumLocals();
+  emit(Opcode::DefineEnter, Info.Modifier, Info.Defn, NumLocals);
+  compile(Info.Defn->getBody(), Info.Modifier);
+  emit(Opcode::DefineExit, Info.Modifier, Info.Defn, NumLocals);
+  emit(Opcode::Return, Info.Modifier);
+  return Address;
+}
+
+size_t InterpreterCode::emit(Opcode Op,
+                             uint8_t Modifier,
+                             const Node* Nd,
+                             size_t Arg,
+                             IntType Value) {
+  size_t Address = Code.size();
+  Code.push_back(
+      {Op, Modifier, OpcodeMayRead[size_t(Op)], Arg, Value, Nd});
+  return Address;
+}
+
+// Note: Each case must leave the same value (i.e. Frame.ReturnValue) and
+// state as the corresponding case of Method::Eval in Interpreter::resume().
+void InterpreterCode::compile(const Node* Nd, uint8_t Modifier) {
+  constexpr uint8_t ReadOnly = ReadFlag;
+  constexpr uint8_t WriteOnly = WriteFlag;
+  switch (Nd->getType()) {
+    default:
+      emit(Opcode::Interpret, Modifier, Nd);
+      return;
+    case OpI32Const:
+    case OpI64Const:
+    case OpU8Const:
+    case OpU32Const:
+    case OpU64Const:
+      emit(Opcode::Const, Modifier, Nd, 0, cast<IntegerNode>(Nd)->getValue());
+      return;
+    case OpLastRead:
+    case OpVoid:
+      emit(Opcode::LastRead, Modifier, Nd);
+      return;
+    case OpLocal:
+      emit(Opcode::Local, Modifier, Nd, cast<LocalNode>(Nd)->getValue());
+      return;
+    case OpSet: {
+      const auto* Local = dyn_cast<LocalNode>(Nd->getKid(0));
+      if (Local == nullptr)
+        break;
+      compile(Nd->getKid(1), Modifier);
+      emit(Opcode::SetLocal, Modifier, Nd, Local->getValue());
+      return;
+    }
+    case OpBit:
+    case OpUint32:
+    case OpUint64:
+    case OpUint8:
+    case OpVarint32:
+    case OpVarint64:
+    case OpVaruint32:
+    case OpVaruint64:
+      emit(Opcode::Value, Modifier, Nd);
+      return;
+    case OpBinaryEval:
+      emit(Opcode::BinaryValue, Modifier, Nd);
+      return;
+    case OpCallback: {
+      const IntegerNode* Action = cast<CallbackNode>(Nd)->getValue();
+      if (Action == nullptr)
+        break;
+      emit(Opcode::Callback, Modifier, Nd, 0, Action->getValue());
+      return;
+    }
+    case OpError:
+      emit(Opcode::Error, Modifier, Nd);
+      return;
+    case OpPeek:
+      emit(Opcode::PeekEnter, Modifier, Nd);
+      compile(Nd->getKid(0), ReadOnly);
+      emit(Opcode::PeekExit, Modifier, Nd);
+      return;
+    case OpRead:
+      compile(Nd->getKid(0), ReadOnly);
+      return;
+    case OpWrite:
+      if (Nd->getNumKids() < 2) {
+        emit(Opcode::Zero, Modifier, Nd);
+        return;
+      }
+      for (int i = 1; i < Nd->getNumKids(); ++i) {
+        compile(Nd->getKid(i), ReadOnly);
+        compile(Nd->getKid(0), WriteOnly);
+      }
+      return;
+    case OpNot:
+    case OpAnd:
+    case OpOr:
+    case OpBitwiseAnd:
+    case OpBitwiseOr:
+    case OpBitwiseXor:
+      // Note: The interpreter throws in write-only mode.
+      if ((Modifier & ReadFlag) == 0)
+        break;
+      compile(Nd->getKid(0), Modifier);
+      switch (Nd->getType()) {
+        case OpAnd: {
+          size_t Jump = emit(Opcode::JumpIfZero, Modifier, Nd);
+          compile(Nd->getKid(1), Modifier);
+          patch(Jump);
+          return;
+        }
+        case OpOr: {
+          size_t Jump = emit(Opcode::JumpIfNonZero, Modifier, Nd);
+          compile(Nd->getKid(1), Modifier);
+          patch(Jump);
+          return;
+        }
+        case OpBitwiseAnd:
+          emit(Opcode::PushValue, Modifier, Nd);
+          compile(Nd->getKid(1), Modifier);
+          emit(Opcode::BitwiseAnd, Modifier, Nd);
+          return;
+        case OpBitwiseOr:
+          emit(Opcode::PushValue, Modifier, Nd);
+          compile(Nd->getKid(1), Modifier);
+          emit(Opcode::BitwiseOr, Modifier, Nd);
+          return;
+        case OpBitwiseXor:
+          emit(Opcode::PushValue, Modifier, Nd);
+          compile(Nd->getKid(1), Modifier);
+          emit(Opcode::BitwiseXor, Modifier, Nd);
+          return;
+        default:
+          // Note: Like the interpreter, OpNot returns the value of its
+          // argument.
+          return;
+      }
+    case OpSequence:
+      for (const Node* Kid : *Nd)
+        compile(Kid, Modifier);
+      emit(Opcode::LastRead, Modifier, Nd);
+      return;
+    case OpLoop: {
+      compile(Nd->getKid(0), Modifier);
+      emit(Opcode::LoopEnter, Modifier, Nd);
+      size_t Next = emit(Opcode::LoopNext, Modifier, Nd->getKid(1));
+      compile(Nd->getKid(1), Modifier);
+      emit(Opcode::Jump, Modifier, Nd, Next);
+      patch(Next);
+      emit(Opcode::LoopExit, Modifier, Nd);
+      return;
+    }
+    case OpLoopUnbounded: {
+      size_t Next = emit(Opcode::LoopUnboundedNext, Modifier, Nd->getKid(0));
+      compile(Nd->getKid(0), Modifier);
+      emit(Opcode::Jump, Modifier, Nd, Next);
+      patch(Next);
+      emit(Opcode::Zero, Modifier, Nd);
+      return;
+    }
+    case OpIfThen: {
+      compile(Nd->getKid(0), Modifier);
+      size_t Jump = emit(Opcode::JumpIfZero, Modifier, Nd);
+      compile(Nd->getKid(1), Modifier);
+      patch(Jump);
+      emit(Opcode::Zero, Modifier, Nd);
+      return;
+    }
+    case OpIfThenElse: {
+      compile(Nd->getKid(0), Modifier);
+      size_t JumpElse = emit(Opcode::JumpIfZero, Modifier, Nd);
+      compile(Nd->getKid(1), Modifier);
+      size_t JumpExit = emit(Opcode::Jump, Modifier, Nd);
+      patch(JumpElse);
+      compile(Nd->getKid(2), Modifier);
+      patch(JumpExit);
+      emit(Opcode::Zero, Modifier, Nd);
+      return;
+    }
+    case OpSwitch: {
+      // Note: Leaves cases that aren't kids of the switch (or the body of
+      // such a case) to the interpreter.
+      size_t NumCases = 0;
+      for (int i = 2; i < Nd->getNumKids(); ++i) {
+        for (const Node* Body = Nd->getKid(i); isa<CaseNode>(Body);
+             Body = Body->getKid(1))
+          ++NumCases;
+      }
+      if (NumCases != countCases(Nd))
+        break;
+      compile(Nd->getKid(0), Modifier);
+      size_t Table = CaseTables.size();
+      CaseTables.emplace_back();
+      emit(Opcode::Switch, Modifier, Nd, Table);
+      std::vector<size_t> JumpsToExit;
+      std::map<IntType, size_t> CaseAddresses;
+      for (int i = 2; i < Nd->getNumKids(); ++i) {
+        const Node* Body = Nd->getKid(i);
+        if (!isa<CaseNode>(Body))
+          continue;
+        // Note: The keys of a case whose body is a case select the same
+        // code.
+        for (; isa<CaseNode>(Body); Body = Body->getKid(1))
+          CaseAddresses[cast<CaseNode>(Body)->getValue()] = Code.size();
+        compile(Body, Modifier);
+        JumpsToExit.push_back(emit(Opcode::Jump, Modifier, Nd));
+      }
+      size_t DefaultAddress = Code.size();
+      compile(Nd->getKid(1), Modifier);
+      for (size_t Jump : JumpsToExit)
+        patch(Jump);
+      emit(Opcode::Zero, Modifier, Nd);
+      // Note: Filled in after compiling the cases, since compiling may add
+      // case tables.
+      CaseTable& Cases = CaseTables[Table];
+      Cases.Min = 0;
+      Cases.DefaultAddress = DefaultAddress;
+      if (CaseAddresses.empty())
+        return;
+      IntType Min = CaseAddresses.begin()->first;
+      IntType Range = CaseAddresses.rbegin()->first - Min;
+      if (Range >= std::max(MinCaseTableSize, 4 * CaseAddresses.size())) {
+        Cases.Lookup.insert(CaseAddresses.begin(), CaseAddresses.end());
+        return;
+      }
+      Cases.Min = Min;
+      Cases.Addresses.resize(Range + 1, DefaultAddress);
+      for (const auto& Pair : CaseAddresses)
+        Cases.Addresses[Pair.first - Min] = Pair.second;
+      return;
+    }
+    case OpCase:
+      compile(Nd->getKid(1), Modifier);
+      emit(Opcode::Zero, Modifier, Nd);
+      return;
+    case OpBlock:
+      emit(Opcode::BlockEnter, Modifier, Nd);
+      compile(Nd->getKid(0), Modifier);
+      emit(Opcode::BlockExit, Modifier, Nd);
+      emit(Opcode::Zero, Modifier, Nd);
+      return;
+    case OpEval: {
+      // Note: Leaves missing definitions, and calls with the wrong number of
+      // arguments, to the interpreter (which reports them).
+      const DefineNode* Defn = cast<EvalNode>(Nd)->getDef(*Symtab);
+      if (Defn == nullptr)
+        break;
+      const auto* NumParams = dyn_cast<ParamsNode>(Defn->getKid(1));
+      if (NumParams == nullptr ||
+          NumParams->getValue() != IntType(Nd->getNumKids() - 1))
+        break;
+      emit(Opcode::Call, Modifier, Nd, getEntry(Defn, Modifier));
+      emit(Opcode::CallExit, Modifier, Nd);
+      return;
+    }
+  }
+  emit(Opcode::Interpret, Modifier, Nd);
+}
+
+void InterpreterCode::describe(FILE* File) {
+  TextWriter Writer;
+  for (size_t i = 0; i < Code.size(); ++i) {
+    const Instruction& Inst = Code[i];
+    fprintf(File, "%" PRIuMAX ": %s %u %" PRIuMAX " ", uintmax_t(i),
+            getName(Inst.Op), unsigned(Inst.Modifier), uintmax_t(Inst.Arg));
+    fprint_IntType(File, Inst.Value);
+    fputs(": ", File);
+    if (Inst.Nd)
+      Writer.writeAbbrev(File, Inst.Nd);
+    else
+      fputs("nullptr\n", File);
+  }
+}
+
+}  // end of namespace interp
+
+}  // end of namespace wasm
@@ -0,0 +1,149 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Defines the (threaded) code that the interpreter lowers the define bodies
+// of an algorithm to. Instructions are kept in a single flat array, and
+// refer to each other by address (i.e. index). Control flow (sequences,
+// loops, conditionals, switches and calls) becomes jumps, so that the
+// interpreter doesn't push a call frame for each evaluated node. All state
+// is in the interpreter, so evaluation can stop before any instruction that
+// reads, and resume there once more input is available.
+//
+// Nodes that aren't lowered are evaluated by the interpreter (see
+// instruction Interpret).
+
+#ifndef DECOMPRESSOR_SRC_INTERP_INTERPRETERCODE_H_
+#define DECOMPRESSOR_SRC_INTERP_INTERPRETERCODE_H_
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "interp/Interpreter.def"
+#include "utils/Defs.h"
+
+namespace wasm {
+
+namespace filt {
+
+class DefineNode;
+class Node;
+class SymbolTable;
+
+}  // end of namespace filt.
+
+namespace interp {
+
+class InterpreterCode {
+  InterpreterCode() = delete;
+  InterpreterCode(const InterpreterCode&) = delete;
+  InterpreterCode& operator=(const InterpreterCode&) = delete;
+
+ public:
+  enum class Opcode : uint8_t {
+#define X(tag, may_read) tag,
+    INTERPRETER_CODE_OPCODES_TABLE
+#undef X
+        NO_SUCH_OPCODE
+  };
+  static const char* getName(Opcode Op);
+
+  // Flags of the method modifier (see Interpreter::MethodModifier) an
+  // instruction is evaluated with.
+  static constexpr uint8_t ReadFlag = 0x1;
+  static constexpr uint8_t WriteFlag = 0x2;
+
+  struct Instruction {
+    Opcode Op;
+    uint8_t Modifier;
+    bool MayRead;
+    // The jump target, local index, case table or entry (depending on Op).
+    size_t Arg;
+    decode::IntType Value;
+    const filt::Node* Nd;
+  };
+
+  explicit InterpreterCode(std::shared_ptr<filt::SymbolTable> Symtab);
+  ~InterpreterCode();
+
+  const filt::SymbolTable* getSymtab() const { return Symtab.get(); }
+
+  // Note: Compiling an entry adds instructions, so references to
+  // instructions aren't valid across calls to getEntryAddress().
+  const Instruction& getInstruction(size_t Address) const {
+    return Code[Address];
+  }
+
+  // Returns the entry for evaluating Defn with the given modifier flags.
+  size_t getEntry(const filt::DefineNode* Defn, uint8_t Modifier);
+
+  // Returns the address of the first instruction of Entry, lowering the
+  // define on first use.
+  size_t getEntryAddress(size_t Entry) {
+    size_t Address = Entries[Entry].Address;
+    return Address != NoAddress ? Address : compileEntry(Entry);
+  }
+
+  // Returns the address of the case (or default) selected by Key.
+  size_t getCaseAddress(size_t Table, decode::IntType Key) const {
+    const CaseTable& Cases = CaseTables[Table];
+    decode::IntType Index = Key - Cases.Min;
+    if (Index < Cases.Addresses.size())
+      return Cases.Addresses[Index];
+    const auto Iter = Cases.Lookup.find(Key);
+    return Iter == Cases.Lookup.end() ? Cases.DefaultAddress : Iter->second;
+  }
+
+  void describe(FILE* File);
+
+ private:
+  static constexpr size_t NoAddress = ~size_t(0);
+  std::shared_ptr<filt::SymbolTable> Symtab;
+  std::vector<Instruction> Code;
+  struct EntryInfo {
+    const filt::DefineNode* Defn;
+    uint8_t Modifier;
+    size_t Address;
+  };
+  std::vector<EntryInfo> Entries;
+  std::map<std::pair<const filt::DefineNode*, uint8_t>, size_t> EntryLookup;
+  // Addresses of the cases of a switch. Cases with keys in [Min, Min +
+  // Addresses.size()) are in Addresses (where missing keys select the
+  // default). Otherwise they are in Lookup.
+  struct CaseTable {
+    decode::IntType Min;
+    std::vector<size_t> Addresses;
+    std::unordered_map<decode::IntType, size_t> Lookup;
+    size_t DefaultAddress;
+  };
+  std::vector<CaseTable> CaseTables;
+
+  size_t compileEntry(size_t Entry);
+  void compile(const filt::Node* Nd, uint8_t Modifier);
+  size_t emit(Opcode Op,
+              uint8_t Modifier,
+              const filt::Node* Nd = nullptr,
+              size_t Arg = 0,
+              decode::IntType Value = 0);
+  // Sets the target of the jump at Address to the next instruction.
+  void patch(size_t Address) { Code[Address].Arg = Code.size(); }
+};
+
+}  // end of namespace interp
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_INTERP_INTERPRETERCODE_H_
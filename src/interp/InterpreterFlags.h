@@ -28,6 +28,12 @@ struct InterpreterFlags {
   bool TraceProgress;
   bool TraceIntermediateStreams;
   bool TraceAppliedAlgorithms;
+  // When true, leaf nodes (constants, locals and format reads) are evaluated
+  // in the calling frame, rather than pushing a call frame for each.
+  bool FastEval;
+  // When true, define bodies are lowered to (threaded) code, which is run
+  // without pushing call frames for the nodes it evaluates.
+  bool ThreadedEval;
 };
 
 }  // end of namespace interp
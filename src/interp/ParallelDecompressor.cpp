@@ -0,0 +1,869 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "interp/ParallelDecompressor.h"
+
+#include "algorithms/wasm0xd.h"
+#include "interp/AlgorithmSelector.h"
+#include "interp/ByteReader.h"
+#include "interp/ByteWriter.h"
+#include "interp/DecompressSelector.h"
+#include "interp/FormatHelpers-templates.h"
+#include "interp/IntReader.h"
+#include "interp/IntWriter.h"
+#include "interp/Interpreter.h"
+#include "sexp/Ast.h"
+#include "stream/ReadBackedQueue.h"
+#include "stream/StringWriter.h"
+#include "stream/WriteBackedQueue.h"
+#include "utils/Casting.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace wasm {
+
+using namespace decode;
+using namespace filt;
+
+namespace interp {
+
+namespace {
+
+// Size of the WASM file header (magic number and version).
+constexpr size_t WasmHeaderSize = 8;
+constexpr uint32_t WasmMagic = 0x6d736100;
+constexpr uint32_t WasmVersion = 0xd;
+constexpr uint32_t CodeSectionId = 10;
+// The literal (of the wasm0xd algorithm) that defines CodeSectionId.
+constexpr char CodeSectionLiteral[] = "code.section";
+
+// Number of chunks (per thread) to split the code section into.
+constexpr size_t CodeChunksPerThread = 4;
+
+// Number of chunks (per thread) that may be decoded ahead of the chunk being
+// written.
+constexpr size_t ChunksAheadPerThread = 2;
+
+// Models a read cursor over a byte buffer, for use with the format helpers.
+class BufferReadCursor {
+ public:
+  BufferReadCursor(const ByteType* Buffer, size_t Size, size_t Address)
+      : Buffer(Buffer), Size(Size), Address(Address), Overrun(false) {}
+  ByteType readByte() {
+    if (Address >= Size) {
+      Overrun = true;
+      return 0;
+    }
+    return Buffer[Address++];
+  }
+  size_t getAddress() const { return Address; }
+  bool hasOverrun() const { return Overrun; }
+
+ private:
+  const ByteType* Buffer;
+  size_t Size;
+  size_t Address;
+  bool Overrun;
+};
+
+// Models a write cursor appending to a byte buffer, for use with the format
+// helpers.
+class BufferWriteCursor {
+ public:
+  explicit BufferWriteCursor(ParallelDecompressor::BufferType& Buffer)
+      : Buffer(Buffer) {}
+  void writeByte(ByteType Byte) { Buffer.push_back(Byte); }
+
+ private:
+  ParallelDecompressor::BufferType& Buffer;
+};
+
+// Returns true if Input starts with the given (file) header.
+bool hasHeader(const ByteType* Input,
+               size_t Size,
+               uint32_t Magic,
+               uint32_t Version) {
+  if (Size < WasmHeaderSize)
+    return false;
+  BufferReadCursor Pos(Input, Size, 0);
+  return fmt::readUint32(Pos) == Magic && fmt::readUint32(Pos) == Version;
+}
+
+// Reads the prefix of a chunk, followed by its contents.
+class ChunkReader FINAL : public RawStream {
+  ChunkReader() = delete;
+  ChunkReader(const ChunkReader&) = delete;
+  ChunkReader& operator=(const ChunkReader&) = delete;
+
+ public:
+  ChunkReader(const ParallelDecompressor::BufferType& Prefix,
+              const ByteType* Contents,
+              size_t ContentsSize)
+      : Prefix(Prefix),
+        Contents(Contents),
+        ContentsSize(ContentsSize),
+        CurPosition(0) {}
+  ~ChunkReader() OVERRIDE {}
+
+  AddressType read(ByteType* Buf, AddressType Size = 1) OVERRIDE {
+    const size_t PrefixSize = Prefix.size();
+    AddressType Count = 0;
+    for (; Count < Size && CurPosition < PrefixSize; ++Count)
+      Buf[Count] = Prefix[CurPosition++];
+    if (Count == Size)
+      return Count;
+    const size_t ContentsCount = std::min(
+        size_t(Size - Count), PrefixSize + ContentsSize - CurPosition);
+    std::copy(Contents + (CurPosition - PrefixSize),
+              Contents + (CurPosition - PrefixSize) + ContentsCount,
+              Buf + Count);
+    CurPosition += ContentsCount;
+    return Count + ContentsCount;
+  }
+  bool write(ByteType*, AddressType) OVERRIDE { return false; }
+  bool freeze() OVERRIDE { return false; }
+  bool atEof() OVERRIDE {
+    return CurPosition == Prefix.size() + ContentsSize;
+  }
+  bool hasErrors() OVERRIDE { return false; }
+
+ private:
+  const ParallelDecompressor::BufferType& Prefix;
+  const ByteType* Contents;
+  const size_t ContentsSize;
+  size_t CurPosition;
+};
+
+// Holds the top level of the data of compressed input, as found by
+// decompressing it (into an integer stream) with the blocks of sections and
+// function bodies jumped over. Jumped over blocks are recorded as the range
+// of Input holding their (compressed) contents.
+struct SectionScan {
+  enum class EventKind { Value, Enter, Exit, Skip };
+  struct Event {
+    EventKind Kind;
+    // The value written, or the index of the jumped over block.
+    IntType Value;
+  };
+  struct Block {
+    size_t Begin;
+    size_t End;
+  };
+
+  SectionScan(std::shared_ptr<ByteReader> Bytes, size_t Size)
+      : Bytes(Bytes),
+        Size(Size),
+        Scanning(false),
+        Sequential(false),
+        MoreData(false),
+        JumpedOver(false),
+        HasSectionId(false),
+        SectionId(0),
+        CodeSectionId(0),
+        Depth(0),
+        HeaderBegin(0),
+        HeaderEnd(0) {}
+
+  // Returns the (byte) address of the next byte to read.
+  size_t getAddress() {
+    Bytes->alignToByte();
+    return Bytes->getPos().getCurAddress();
+  }
+
+  void addEvent(EventKind Kind, IntType Value = 0) {
+    Events.push_back({Kind, Value});
+  }
+
+  void addValue(IntType Value) {
+    addEvent(EventKind::Value, Value);
+    HasSectionId = Depth == 0;
+    SectionId = Value;
+  }
+
+  std::shared_ptr<ByteReader> Bytes;
+  size_t Size;
+  // True while the data is scanned.
+  bool Scanning;
+  // True if the data was decompressed (sequentially) instead.
+  bool Sequential;
+  // True if input follows the scanned data.
+  bool MoreData;
+  // True if the last block entered was jumped over.
+  bool JumpedOver;
+  // True if the last value written (at the top level) immediately precedes
+  // the next block, and hence is the id of that section.
+  bool HasSectionId;
+  IntType SectionId;
+  // The id of the section holding function bodies (as defined by the data
+  // algorithm).
+  IntType CodeSectionId;
+  // The number of entered (i.e. not jumped over) blocks.
+  size_t Depth;
+  std::shared_ptr<SymbolTable> ExpandSymtab;
+  std::shared_ptr<SymbolTable> DataSymtab;
+  IntStream::HeaderVector Header;
+  size_t HeaderBegin;
+  size_t HeaderEnd;
+  std::vector<Event> Events;
+  std::vector<Block> Blocks;
+};
+
+// Reads the input of a section scan, jumping over the blocks of sections
+// (other than the code section) and function bodies while scanning.
+class ScanReader FINAL : public Reader {
+  ScanReader() = delete;
+  ScanReader(const ScanReader&) = delete;
+  ScanReader& operator=(const ScanReader&) = delete;
+
+ public:
+  explicit ScanReader(std::shared_ptr<SectionScan> Scan)
+      : Reader(true), Scan(Scan), Bytes(Scan->Bytes) {}
+  ~ScanReader() OVERRIDE {}
+
+  void describePeekPosStack(FILE* Out) OVERRIDE {
+    Bytes->describePeekPosStack(Out);
+  }
+  bool canProcessMoreInputNow() OVERRIDE {
+    return Bytes->canProcessMoreInputNow();
+  }
+  bool stillMoreInputToProcessNow() OVERRIDE {
+    return Bytes->stillMoreInputToProcessNow();
+  }
+  bool atInputEof() OVERRIDE { return Bytes->atInputEof(); }
+  bool atInputEob() OVERRIDE { return Scan->MoreData || Bytes->atInputEob(); }
+  bool pushPeekPos() OVERRIDE { return Bytes->pushPeekPos(); }
+  bool popPeekPos() OVERRIDE { return Bytes->popPeekPos(); }
+  StreamType getStreamType() OVERRIDE { return Bytes->getStreamType(); }
+  bool processedInputCorrectly() OVERRIDE {
+    return Bytes->processedInputCorrectly();
+  }
+  void readFillStart() OVERRIDE { Bytes->readFillStart(); }
+  void readFillMoreInput() OVERRIDE { Bytes->readFillMoreInput(); }
+  uint8_t readBit() OVERRIDE { return Bytes->readBit(); }
+  uint8_t readUint8() OVERRIDE { return Bytes->readUint8(); }
+  uint32_t readUint32() OVERRIDE { return Bytes->readUint32(); }
+  uint64_t readUint64() OVERRIDE { return Bytes->readUint64(); }
+  int32_t readVarint32() OVERRIDE { return Bytes->readVarint32(); }
+  int64_t readVarint64() OVERRIDE { return Bytes->readVarint64(); }
+  uint32_t readVaruint32() OVERRIDE { return Bytes->readVaruint32(); }
+  uint64_t readVaruint64() OVERRIDE { return Bytes->readVaruint64(); }
+  bool alignToByte() OVERRIDE { return Bytes->alignToByte(); }
+  bool readBlockEnter() OVERRIDE;
+  bool readBlockExit() OVERRIDE;
+  bool readBinary(const Node* Encoding, IntType& Value) OVERRIDE {
+    return Bytes->readBinary(Encoding, Value);
+  }
+  size_t readValues(const Node* Format,
+                    size_t Count,
+                    IntType* Values) OVERRIDE {
+    return Bytes->readValues(Format, Count, Values);
+  }
+  size_t readBytes(uint8_t* Buffer, size_t Size) OVERRIDE {
+    return Bytes->readBytes(Buffer, Size);
+  }
+  bool tablePush(IntType Value) OVERRIDE { return Bytes->tablePush(Value); }
+  bool tablePop() OVERRIDE { return Bytes->tablePop(); }
+
+ private:
+  std::shared_ptr<SectionScan> Scan;
+  std::shared_ptr<ByteReader> Bytes;
+};
+
+bool ScanReader::readBlockEnter() {
+  if (!Scan->Scanning)
+    return Bytes->readBlockEnter();
+  const bool Enter = Scan->Depth == 0 && Scan->HasSectionId &&
+                     Scan->SectionId == Scan->CodeSectionId;
+  Scan->HasSectionId = false;
+  if (!Bytes->readBlockEnter())
+    return false;
+  if (Enter) {
+    ++Scan->Depth;
+    return true;
+  }
+  // Jump over the contents of the block, including the abbreviation that
+  // exits it.
+  Bytes->alignToByte();
+  BitReadCursor& Pos = Bytes->getPos();
+  const size_t Begin = Pos.getCurAddress();
+  const size_t End = Pos.getEobAddress();
+  if (End > Scan->Size)
+    return false;
+  Scan->Blocks.push_back({Begin, End});
+  Scan->JumpedOver = true;
+  Bytes->setReadPos(BitReadCursor(Pos, End));
+  return Bytes->readBlockExit();
+}
+
+bool ScanReader::readBlockExit() {
+  if (Scan->Scanning && Scan->Depth > 0)
+    --Scan->Depth;
+  Scan->HasSectionId = false;
+  return Bytes->readBlockExit();
+}
+
+// Records the values and blocks written while scanning.
+class ScanWriter FINAL : public Writer {
+  ScanWriter() = delete;
+  ScanWriter(const ScanWriter&) = delete;
+  ScanWriter& operator=(const ScanWriter&) = delete;
+
+ public:
+  explicit ScanWriter(std::shared_ptr<SectionScan> Scan)
+      : Writer(true), Scan(Scan) {}
+  ~ScanWriter() OVERRIDE {}
+
+  StreamType getStreamType() const OVERRIDE { return StreamType::Int; }
+  bool writeVaruint64(uint64_t Value) OVERRIDE {
+    Scan->addValue(Value);
+    return true;
+  }
+  bool writeValues(const IntType* Values,
+                   size_t Count,
+                   const Node* Format) OVERRIDE {
+    for (size_t i = 0; i < Count; ++i)
+      Scan->addValue(Values[i]);
+    return true;
+  }
+  bool writeBlockEnter() OVERRIDE {
+    if (!Scan->JumpedOver) {
+      Scan->addEvent(SectionScan::EventKind::Enter);
+      return true;
+    }
+    Scan->addEvent(SectionScan::EventKind::Skip, Scan->Blocks.size() - 1);
+    Scan->JumpedOver = false;
+    return true;
+  }
+  bool writeBlockExit() OVERRIDE {
+    Scan->addEvent(SectionScan::EventKind::Exit);
+    return true;
+  }
+  bool writeHeaderValue(IntType Value, IntTypeFormat Format) OVERRIDE {
+    Scan->Header.push_back(std::make_pair(Value, Format));
+    return true;
+  }
+  bool writeHeaderClose() OVERRIDE {
+    Scan->HeaderEnd = Scan->getAddress();
+    return true;
+  }
+  // Tables change the values written, so scans can't use them.
+  bool tablePush(IntType Value) OVERRIDE { return false; }
+  bool tablePop() OVERRIDE { return false; }
+
+ private:
+  std::shared_ptr<SectionScan> Scan;
+};
+
+// Returns the value of literal Name, as defined in Symtab, in Value. Returns
+// false if Symtab doesn't define Name as an integer literal.
+bool getLiteralValue(SymbolTable& Symtab, const char* Name, IntType& Value) {
+  SymbolNode* Sym = Symtab.getSymbol(Name);
+  if (Sym == nullptr)
+    return false;
+  const LiteralDefNode* Defn = Sym->getLiteralDefinition();
+  if (Defn == nullptr)
+    return false;
+  const auto* Const = dyn_cast<IntegerNode>(Defn->getKid(1));
+  if (Const == nullptr)
+    return false;
+  Value = Const->getValue();
+  return true;
+}
+
+// Selects a data algorithm. If the data algorithm is wasm0xd, and exactly one
+// algorithm was read before the data, the data is scanned using that
+// algorithm. Otherwise, the data is decompressed (sequentially) as a
+// DecompressSelector would.
+class ScanSelector FINAL : public AlgorithmSelector {
+  ScanSelector() = delete;
+  ScanSelector(const ScanSelector&) = delete;
+  ScanSelector& operator=(const ScanSelector&) = delete;
+
+ public:
+  ScanSelector(std::shared_ptr<SymbolTable> Symtab,
+               std::shared_ptr<DecompAlgState> State,
+               std::shared_ptr<SectionScan> Scan)
+      : Symtab(Symtab),
+        State(State),
+        Scan(Scan),
+        Fallback(std::make_shared<DecompressSelector>(Symtab, State)),
+        IsScanning(false) {}
+  ~ScanSelector() OVERRIDE {}
+  std::shared_ptr<SymbolTable> getSymtab() OVERRIDE { return Symtab; }
+  bool configure(Interpreter* R) OVERRIDE;
+  bool reset(Interpreter* R) OVERRIDE;
+
+ private:
+  std::shared_ptr<SymbolTable> Symtab;
+  std::shared_ptr<DecompAlgState> State;
+  std::shared_ptr<SectionScan> Scan;
+  std::shared_ptr<DecompressSelector> Fallback;
+  std::shared_ptr<Writer> OrigWriter;
+  bool IsScanning;
+};
+
+bool ScanSelector::configure(Interpreter* R) {
+  // Note: Only the sections of wasm0xd are known to be blocks whose id
+  // precedes them, and whose function bodies are blocks.
+  if (Scan->Sequential || State->getNumQueuedAlgorithms() != 1 ||
+      Symtab != getAlgwasm0xdSymtab() ||
+      !getLiteralValue(*Symtab, CodeSectionLiteral, Scan->CodeSectionId)) {
+    Scan->Sequential = true;
+    return Fallback->configure(R);
+  }
+  IsScanning = true;
+  Scan->Scanning = true;
+  Scan->ExpandSymtab = State->popQueuedAlgorithm();
+  Scan->DataSymtab = Symtab;
+  Scan->HeaderBegin = Scan->getAddress();
+  OrigWriter = R->getWriter();
+  R->setWriter(std::make_shared<ScanWriter>(Scan));
+  R->setSymbolTable(Scan->ExpandSymtab);
+  return true;
+}
+
+bool ScanSelector::reset(Interpreter* R) {
+  if (!IsScanning)
+    return Fallback->reset(R);
+  IsScanning = false;
+  Scan->Scanning = false;
+  // Stop if more input follows, since it would be written before the
+  // sections of the scanned data.
+  Scan->MoreData = !Scan->Bytes->atInputEob();
+  R->setWriter(OrigWriter);
+  OrigWriter.reset();
+  std::shared_ptr<SymbolTable> NullSymtab;
+  R->setSymbolTable(NullSymtab);
+  return true;
+}
+
+}  // end of anonymous namespace
+
+ParallelDecompressor::ParallelDecompressor(const InterpreterFlags& Flags)
+    : Flags(Flags),
+      NumThreads(1),
+      MinimizeBlockSize(false),
+      ErrorsFound(false),
+      CodeBodiesSize(0),
+      NumCodeBodies(0) {
+}
+
+ParallelDecompressor::~ParallelDecompressor() {
+}
+
+void ParallelDecompressor::addAlgorithm(std::shared_ptr<SymbolTable> Symtab) {
+  Algorithms.push_back(Symtab);
+}
+
+size_t ParallelDecompressor::getHeaderSize() {
+  return WasmHeaderSize;
+}
+
+bool ParallelDecompressor::canSplit(const ByteType* Input, size_t Size) {
+  return hasHeader(Input, Size, WasmMagic, WasmVersion) ||
+         hasHeader(Input, Size, CasmBinaryMagic, CasmBinaryVersion);
+}
+
+bool ParallelDecompressor::decompress(const ByteType* Input,
+                                      size_t Size,
+                                      std::shared_ptr<Queue> Output) {
+  Chunks.clear();
+  ErrorsFound = false;
+  const bool Split = hasHeader(Input, Size, WasmMagic, WasmVersion)
+                         ? splitWasm(Input, Size)
+                         : splitCompressed(Input, Size, Output);
+  if (!Split)
+    return false;
+  if (Chunks.empty())
+    // Decompressed sequentially while scanning.
+    return true;
+  const size_t NumWorkers =
+      std::min(std::max(NumThreads, size_t(1)), Chunks.size());
+  const size_t MaxAhead = NumWorkers * ChunksAheadPerThread;
+  // Guarded by DoneLock.
+  size_t NextChunk = 0;
+  size_t NextWrite = 0;
+  bool Abort = false;
+  std::mutex DoneLock;
+  std::condition_variable DoneChanged;
+  auto Worker = [&]() {
+    while (true) {
+      size_t i;
+      {
+        // Don't get too far ahead of the writer, so that the number of
+        // decoded chunks held is bounded.
+        std::unique_lock<std::mutex> Lock(DoneLock);
+        DoneChanged.wait(
+            Lock, [&]() { return Abort || NextChunk < NextWrite + MaxAhead; });
+        if (Abort || NextChunk == Chunks.size())
+          return;
+        i = NextChunk++;
+      }
+      decompressChunk(Chunks[i]);
+      std::lock_guard<std::mutex> Lock(DoneLock);
+      Chunks[i].Done = true;
+      DoneChanged.notify_all();
+    }
+  };
+  std::vector<std::thread> Threads;
+  for (size_t i = 0; i < NumWorkers; ++i)
+    Threads.emplace_back(Worker);
+  // Write the chunks in order, as they complete.
+  WrittenHeader.clear();
+  CodeGroups.clear();
+  CodeBodiesSize = 0;
+  NumCodeBodies = 0;
+  AddressType Address = 0;
+  bool Succeeded = true;
+  for (size_t i = 0; i < Chunks.size(); ++i) {
+    {
+      std::unique_lock<std::mutex> Lock(DoneLock);
+      DoneChanged.wait(Lock, [&]() { return Chunks[i].Done; });
+    }
+    Succeeded = writeChunk(i, *Output, Address);
+    std::lock_guard<std::mutex> Lock(DoneLock);
+    NextWrite = i + 1;
+    Abort = !Succeeded;
+    DoneChanged.notify_all();
+    if (Abort)
+      break;
+  }
+  for (std::thread& T : Threads)
+    T.join();
+  Chunks.clear();
+  if (!Succeeded) {
+    ErrorsFound = true;
+    return false;
+  }
+  Output->freezeEof(Address);
+  return true;
+}
+
+bool ParallelDecompressor::splitWasm(const ByteType* Input, size_t Size) {
+  if (Size <= WasmHeaderSize)
+    return false;
+  BufferReadCursor Pos(Input, Size, WasmHeaderSize);
+  const ByteType* HeaderBegin = Input;
+  const ByteType* HeaderEnd = HeaderBegin + WasmHeaderSize;
+  while (Pos.getAddress() < Size) {
+    const size_t SectionBegin = Pos.getAddress();
+    const uint32_t SectionId = fmt::readVaruint32(Pos);
+    const uint32_t SectionSize = fmt::readVaruint32(Pos);
+    const size_t SectionEnd = Pos.getAddress() + SectionSize;
+    if (Pos.hasOverrun() || SectionEnd > Size)
+      return false;
+    const uint32_t NumBodies =
+        SectionId == CodeSectionId ? fmt::readVaruint32(Pos) : 0;
+    if (NumBodies == 0 || NumThreads <= 1) {
+      Chunks.emplace_back();
+      Chunk& C = Chunks.back();
+      C.Prefix.assign(HeaderBegin, HeaderEnd);
+      C.Contents = Input + SectionBegin;
+      C.ContentsSize = SectionEnd - SectionBegin;
+      Pos = BufferReadCursor(Input, Size, SectionEnd);
+      continue;
+    }
+    // Split the function bodies of the code section into groups of (about)
+    // ChunkSize bytes, and wrap each group into its own code section.
+    const size_t ChunkSize = std::max(
+        size_t(1), SectionSize / (NumThreads * CodeChunksPerThread));
+    for (uint32_t i = 0; i < NumBodies;) {
+      const size_t GroupBegin = Pos.getAddress();
+      uint32_t GroupCount = 0;
+      while (i < NumBodies && Pos.getAddress() - GroupBegin < ChunkSize) {
+        const uint32_t BodySize = fmt::readVaruint32(Pos);
+        Pos = BufferReadCursor(Input, Size, Pos.getAddress() + BodySize);
+        ++GroupCount;
+        ++i;
+      }
+      const size_t GroupEnd = Pos.getAddress();
+      if (Pos.hasOverrun() || GroupEnd > SectionEnd)
+        return false;
+      BufferType Count;
+      BufferWriteCursor CountPos(Count);
+      fmt::writeVaruint32(GroupCount, CountPos);
+      Chunks.emplace_back();
+      Chunk& C = Chunks.back();
+      C.IsCode = true;
+      C.Prefix.assign(HeaderBegin, HeaderEnd);
+      BufferWriteCursor PrefixPos(C.Prefix);
+      fmt::writeVaruint32(SectionId, PrefixPos);
+      fmt::writeVaruint32(Count.size() + (GroupEnd - GroupBegin), PrefixPos);
+      C.Prefix.insert(C.Prefix.end(), Count.begin(), Count.end());
+      C.Contents = Input + GroupBegin;
+      C.ContentsSize = GroupEnd - GroupBegin;
+    }
+    if (Pos.getAddress() != SectionEnd)
+      return false;
+  }
+  return !Chunks.empty();
+}
+
+bool ParallelDecompressor::splitCompressed(const ByteType* Input,
+                                           size_t Size,
+                                           std::shared_ptr<Queue> Output) {
+  BufferType NoPrefix;
+  auto Bytes = std::make_shared<ByteReader>(std::make_shared<ReadBackedQueue>(
+      std::make_shared<ChunkReader>(NoPrefix, Input, Size)));
+  auto Scan = std::make_shared<SectionScan>(Bytes, Size);
+  {
+    auto Writer = std::make_shared<ByteWriter>(Output);
+    Writer->setMinimizeBlockSize(MinimizeBlockSize);
+    Interpreter Scanner(std::make_shared<ScanReader>(Scan), Writer, Flags);
+    auto AlgState = std::make_shared<DecompAlgState>(&Scanner);
+    for (std::shared_ptr<SymbolTable> Symtab : Algorithms) {
+      if (Symtab->specifiesAlgorithm())
+        Scanner.addSelector(
+            std::make_shared<DecompressSelector>(Symtab, AlgState));
+      else
+        Scanner.addSelector(
+            std::make_shared<ScanSelector>(Symtab, AlgState, Scan));
+    }
+    // Only freeze the output if it was written to (i.e. decompressed
+    // sequentially).
+    Scanner.setFreezeEofAtExit(false);
+    Scanner.algorithmRead();
+    if (Scanner.errorsFound()) {
+      ErrorsFound = true;
+      return false;
+    }
+    if (Scan->Sequential)
+      return Writer->writeFreezeEof();
+  }
+  if (!Scan->DataSymtab || Scan->MoreData)
+    return false;
+  ExpandSymtab = Scan->ExpandSymtab;
+  DataSymtab = Scan->DataSymtab;
+  DataHeader = Scan->Header;
+
+  // Adds a chunk for blocks [BeginBlock, EndBlock), in the context of Values.
+  const size_t HeaderSize = Scan->HeaderEnd - Scan->HeaderBegin;
+  auto AddChunk = [&](const std::vector<IntType>& Values, size_t BeginBlock,
+                      size_t EndBlock, bool IsCode) {
+    Chunks.emplace_back();
+    Chunk& C = Chunks.back();
+    C.IsCompressed = true;
+    C.IsCode = IsCode;
+    C.NumBodies = EndBlock - BeginBlock;
+    C.PrefixValues = Values;
+    if (BeginBlock == EndBlock)
+      return;
+    // The header is decompressed inside the first block, so that the
+    // algorithm resumes where it was when the block was entered.
+    const SectionScan::Block& First = Scan->Blocks[BeginBlock];
+    BufferWriteCursor PrefixPos(C.Prefix);
+    fmt::writeFixedVaruint32(HeaderSize + (First.End - First.Begin),
+                             PrefixPos);
+    C.Prefix.insert(C.Prefix.end(), Input + Scan->HeaderBegin,
+                    Input + Scan->HeaderEnd);
+    C.Contents = Input + First.Begin;
+    C.ContentsSize = Scan->Blocks[EndBlock - 1].End - First.Begin;
+  };
+
+  // Values written since the last section.
+  std::vector<IntType> Context;
+  const std::vector<SectionScan::Event>& Events = Scan->Events;
+  for (size_t i = 0; i < Events.size(); ++i) {
+    const SectionScan::Event& E = Events[i];
+    switch (E.Kind) {
+      case SectionScan::EventKind::Value:
+        Context.push_back(E.Value);
+        break;
+      case SectionScan::EventKind::Skip:
+        AddChunk(Context, E.Value, E.Value + 1, false);
+        Context.clear();
+        break;
+      case SectionScan::EventKind::Exit:
+        return false;
+      case SectionScan::EventKind::Enter: {
+        // The code section, holding the number of function bodies, followed
+        // by the (jumped over) function bodies.
+        if (++i == Events.size() ||
+            Events[i].Kind != SectionScan::EventKind::Value)
+          return false;
+        const IntType NumBodies = Events[i].Value;
+        std::vector<size_t> Bodies;
+        for (++i; i < Events.size() &&
+                  Events[i].Kind == SectionScan::EventKind::Skip;
+             ++i)
+          Bodies.push_back(Events[i].Value);
+        if (i == Events.size() ||
+            Events[i].Kind != SectionScan::EventKind::Exit ||
+            Bodies.size() != NumBodies)
+          return false;
+        if (Bodies.empty()) {
+          AddChunk(Context, 0, 0, true);
+          Context.clear();
+          break;
+        }
+        const size_t BeginBlock = Bodies.front();
+        const size_t EndBlock = Bodies.back() + 1;
+        if (EndBlock - BeginBlock != Bodies.size())
+          return false;
+        // Split the function bodies into groups of (about) ChunkSize
+        // compressed bytes.
+        const size_t SectionSize =
+            Scan->Blocks[EndBlock - 1].End - Scan->Blocks[BeginBlock].Begin;
+        const size_t ChunkSize = std::max(
+            size_t(1), SectionSize / (NumThreads * CodeChunksPerThread));
+        for (size_t b = BeginBlock; b < EndBlock;) {
+          const size_t GroupBegin = b;
+          size_t GroupSize = 0;
+          while (b < EndBlock && GroupSize < ChunkSize) {
+            GroupSize = Scan->Blocks[b].End - Scan->Blocks[GroupBegin].Begin;
+            ++b;
+          }
+          AddChunk(Context, GroupBegin, b, true);
+        }
+        Context.clear();
+        break;
+      }
+    }
+  }
+  return Context.empty() && !Chunks.empty();
+}
+
+bool ParallelDecompressor::expandChunk(Chunk& C,
+                                       std::shared_ptr<IntStream> Values) {
+  auto Output = std::make_shared<IntWriter>(Values);
+  auto Input = std::make_shared<ByteReader>(std::make_shared<ReadBackedQueue>(
+      std::make_shared<ChunkReader>(C.Prefix, C.Contents, C.ContentsSize)));
+  InterpreterT<ByteReader, IntWriter> Expander(Input, Output, Flags,
+                                               ExpandSymtab);
+  Expander.setFreezeEofAtExit(false);
+  // Note: Starting resets the output, so the context of the blocks is written
+  // after.
+  if (C.ContentsSize > 0)
+    Expander.algorithmStart();
+  for (IntType Value : C.PrefixValues)
+    Output->write(Value);
+  if (C.IsCode) {
+    Output->writeBlockEnter();
+    Output->write(C.NumBodies);
+  }
+  if (C.ContentsSize > 0) {
+    // Resume the algorithm in the (first) block, which begins with the header.
+    if (!Input->readBlockEnter() || !Output->writeBlockEnter())
+      return false;
+    Expander.algorithmReadBackFilled();
+    if (Expander.errorsFound())
+      return false;
+  } else {
+    for (const auto& Pair : DataHeader)
+      Output->writeHeaderValue(Pair.first, Pair.second);
+    Output->writeHeaderClose();
+  }
+  if (C.IsCode && !Output->writeBlockExit())
+    return false;
+  return Output->writeFreezeEof();
+}
+
+void ParallelDecompressor::decompressChunk(Chunk& C) {
+  auto Output = std::make_shared<ByteWriter>(std::make_shared<WriteBackedQueue>(
+      std::make_shared<StringWriter>(C.Output)));
+  Output->setMinimizeBlockSize(MinimizeBlockSize);
+  if (C.IsCompressed) {
+    auto Values = std::make_shared<IntStream>();
+    if (!expandChunk(C, Values))
+      return;
+    Interpreter Decompressor(std::make_shared<IntReader>(Values), Output,
+                             Flags, DataSymtab);
+    Decompressor.algorithmRead();
+    C.Succeeded = !Decompressor.errorsFound();
+    return;
+  }
+  {
+    Interpreter Decompressor(
+        std::make_shared<ByteReader>(
+            std::make_shared<ReadBackedQueue>(std::make_shared<ChunkReader>(
+                C.Prefix, C.Contents, C.ContentsSize))),
+        Output, Flags);
+    auto AlgState = std::make_shared<DecompAlgState>(&Decompressor);
+    for (std::shared_ptr<SymbolTable> Symtab : Algorithms)
+      Decompressor.addSelector(
+          std::make_shared<DecompressSelector>(Symtab, AlgState));
+    Decompressor.algorithmRead();
+    C.Succeeded = !Decompressor.errorsFound();
+  }
+}
+
+bool ParallelDecompressor::writeChunk(size_t Index,
+                                      Queue& Output,
+                                      AddressType& Address) {
+  Chunk& C = Chunks[Index];
+  if (!C.Succeeded || C.Output.size() < WasmHeaderSize)
+    return false;
+  auto* Bytes = reinterpret_cast<ByteType*>(&C.Output[0]);
+  const size_t Size = C.Output.size();
+  if (Index == 0) {
+    WrittenHeader.assign(Bytes, Bytes + WasmHeaderSize);
+    if (!Output.write(Address, Bytes, WasmHeaderSize))
+      return false;
+  } else if (!std::equal(WrittenHeader.begin(), WrittenHeader.end(), Bytes)) {
+    return false;
+  }
+  if (!C.IsCode) {
+    const bool Written = Output.write(Address, Bytes + WasmHeaderSize,
+                                      Size - WasmHeaderSize);
+    std::string().swap(C.Output);
+    return Written;
+  }
+  BufferReadCursor Pos(Bytes, Size, WasmHeaderSize);
+  fmt::readVaruint32(Pos);
+  const size_t IdEnd = Pos.getAddress();
+  fmt::readVaruint32(Pos);
+  NumCodeBodies += fmt::readVaruint32(Pos);
+  if (Pos.hasOverrun())
+    return false;
+  if (CodeGroups.empty())
+    CodeId.assign(Bytes + WasmHeaderSize, Bytes + IdEnd);
+  CodeBodiesSize += Size - Pos.getAddress();
+  CodeGroups.emplace_back(std::move(C.Output), Pos.getAddress());
+  if (Index + 1 < Chunks.size() && Chunks[Index + 1].IsCode)
+    return true;
+  // Last group of the code section, so write out the header of the merged
+  // section (sizing it the same way the writer does), followed by the
+  // function bodies of each group.
+  BufferType Count;
+  BufferWriteCursor CountPos(Count);
+  fmt::writeVaruint32(NumCodeBodies, CountPos);
+  BufferType Header(CodeId);
+  BufferWriteCursor HeaderPos(Header);
+  if (MinimizeBlockSize)
+    fmt::writeVaruint32(Count.size() + CodeBodiesSize, HeaderPos);
+  else
+    fmt::writeFixedVaruint32(Count.size() + CodeBodiesSize, HeaderPos);
+  Header.insert(Header.end(), Count.begin(), Count.end());
+  bool Written = Output.write(Address, Header.data(), Header.size());
+  for (auto& Group : CodeGroups) {
+    std::string& Bodies = Group.first;
+    Written = Written &&
+              Output.write(Address,
+                           reinterpret_cast<ByteType*>(&Bodies[Group.second]),
+                           Bodies.size() - Group.second);
+  }
+  CodeGroups.clear();
+  CodeBodiesSize = 0;
+  NumCodeBodies = 0;
+  return Written;
+}
+
+}  // end of namespace interp
+
+}  // end of namespace wasm
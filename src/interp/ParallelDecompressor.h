@@ -0,0 +1,175 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Defines a decompressor that decodes sections (and groups of function bodies
+// within the code section) in parallel.
+//
+// Every section is prefixed with its size, so once the section boundaries
+// are known, each section can be decoded independently. For WASM (0xd)
+// input, the boundaries are found by scanning the (raw) WASM file. Each chunk
+// is then decoded by its own interpreter, reading a file containing only the
+// file header and the section of the chunk.
+//
+// Compressed (i.e. casm) input also keeps the blocks of the sections, and
+// the blocks of their function bodies, prefixed with their (compressed)
+// size. The algorithms of the input are read, and the top level of its data
+// is decompressed (into an integer stream) sequentially, jumping over the
+// blocks of sections and function bodies. Each chunk then decompresses its
+// blocks into an integer stream, recreating the top-level context (e.g. the
+// section id) around them, and applies the data algorithm to get the WASM
+// file of the chunk.
+//
+// The decoded chunks are written to the output in order, as they complete.
+// Only the function bodies of the code section are held until the last
+// group of the section completes, since the section size precedes them.
+// Threads only decode a bounded number of chunks ahead of the one being
+// written.
+//
+// Note: The algorithms (i.e. symbol tables) are shared by all threads. This
+// is safe since installed symbol tables are only read while interpreting.
+
+#ifndef DECOMPRESSOR_SRC_INTERP_PARALLELDECOMPRESSOR_H_
+#define DECOMPRESSOR_SRC_INTERP_PARALLELDECOMPRESSOR_H_
+
+#include "interp/IntStream.h"
+#include "interp/InterpreterFlags.h"
+#include "utils/Defs.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace wasm {
+
+namespace decode {
+class Queue;
+}  // end of namespace decode
+
+namespace filt {
+class SymbolTable;
+}  // end of namespace filt
+
+namespace interp {
+
+class ParallelDecompressor {
+  ParallelDecompressor(const ParallelDecompressor&) = delete;
+  ParallelDecompressor& operator=(const ParallelDecompressor&) = delete;
+
+ public:
+  typedef std::vector<decode::ByteType> BufferType;
+
+  explicit ParallelDecompressor(const InterpreterFlags& Flags);
+  ~ParallelDecompressor();
+
+  // Adds an algorithm to use (in the same order as added to an Interpreter).
+  void addAlgorithm(std::shared_ptr<filt::SymbolTable> Symtab);
+  void setNumThreads(size_t NewValue) { NumThreads = NewValue; }
+  void setMinimizeBlockSize(bool NewValue) { MinimizeBlockSize = NewValue; }
+
+  // Returns true if the Size bytes of Input start with a WASM (0xd) or casm
+  // file header (i.e. the input may be split into sections). Size need only
+  // cover the file header.
+  static bool canSplit(const decode::ByteType* Input, size_t Size);
+  // Returns the number of bytes canSplit() needs to look at.
+  static size_t getHeaderSize();
+
+  // Decompresses the Size bytes of Input into Output, writing the decoded
+  // sections as they complete. Returns false, without writing to Output, if
+  // Input can't be split into sections. In that case, use an Interpreter to
+  // decompress. Returns false, with errorsFound() true, if Input (or some
+  // chunk of it) fails to decompress. Output then holds the sections before
+  // the failing chunk.
+  //
+  // Note: Compressed input whose data doesn't apply exactly one algorithm is
+  // decompressed into Output sequentially, while looking for its sections.
+  //
+  // Note: Input isn't copied, and must stay valid until this returns.
+  bool decompress(const decode::ByteType* Input,
+                  size_t Size,
+                  std::shared_ptr<decode::Queue> Output);
+  bool errorsFound() const { return ErrorsFound; }
+
+ private:
+  struct Chunk {
+    // The file header (and for groups of function bodies, the code section
+    // header) that precedes Contents. For compressed input, the header of
+    // the data, preceded by the size of the first block (plus the header).
+    BufferType Prefix;
+    // The (unmodified) bytes of Input that the chunk decodes.
+    const decode::ByteType* Contents;
+    size_t ContentsSize;
+    // For compressed input, the values (e.g. the section id) that precede
+    // the (code section) block of the chunk in the integer stream.
+    std::vector<decode::IntType> PrefixValues;
+    // For compressed input, the number of function bodies in the chunk if it
+    // is a group of function bodies.
+    uint32_t NumBodies;
+    std::string Output;
+    // True if the chunk is a group of function bodies of the code section.
+    bool IsCode;
+    bool IsCompressed;
+    bool Succeeded;
+    // True once the chunk is decoded (guarded by DoneLock).
+    bool Done;
+    Chunk()
+        : Contents(nullptr),
+          ContentsSize(0),
+          NumBodies(0),
+          IsCode(false),
+          IsCompressed(false),
+          Succeeded(false),
+          Done(false) {}
+  };
+
+  InterpreterFlags Flags;
+  std::vector<std::shared_ptr<filt::SymbolTable>> Algorithms;
+  size_t NumThreads;
+  bool MinimizeBlockSize;
+  bool ErrorsFound;
+  std::vector<Chunk> Chunks;
+  // The algorithm that decompresses the data of compressed input (into an
+  // integer stream), the algorithm that then writes it, and the file header
+  // of the integer stream.
+  std::shared_ptr<filt::SymbolTable> ExpandSymtab;
+  std::shared_ptr<filt::SymbolTable> DataSymtab;
+  IntStream::HeaderVector DataHeader;
+  // The file header written so far. For the code section, the section id,
+  // and the (decoded) groups of function bodies written so far. Each group
+  // is held as the output of its chunk, along with the offset of its first
+  // function body.
+  BufferType WrittenHeader;
+  BufferType CodeId;
+  std::vector<std::pair<std::string, size_t>> CodeGroups;
+  size_t CodeBodiesSize;
+  uint32_t NumCodeBodies;
+
+  bool splitWasm(const decode::ByteType* Input, size_t Size);
+  bool splitCompressed(const decode::ByteType* Input,
+                       size_t Size,
+                       std::shared_ptr<decode::Queue> Output);
+  void decompressChunk(Chunk& C);
+  bool expandChunk(Chunk& C, std::shared_ptr<IntStream> Values);
+  bool writeChunk(size_t Index,
+                  decode::Queue& Output,
+                  decode::AddressType& Address);
+};
+
+}  // end of namespace interp
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_INTERP_PARALLELDECOMPRESSOR_H_
@@ -137,6 +137,23 @@ bool Reader::readValue(const filt::Node* Format, IntType& Value) {
   }
 }
 
+size_t Reader::readValues(const filt::Node* Format,
+                          size_t Count,
+                          IntType* Values) {
+  for (size_t i = 0; i < Count; ++i) {
+    if (!stillMoreInputToProcessNow() || !readValue(Format, Values[i]))
+      return i;
+  }
+  return Count;
+}
+
+size_t Reader::readBytes(uint8_t* Buffer, size_t Size) {
+  size_t Count = 0;
+  for (; Count < Size && stillMoreInputToProcessNow() && !atInputEob(); ++Count)
+    Buffer[Count] = readUint8();
+  return Count;
+}
+
 bool Reader::readHeaderValue(IntTypeFormat Format, IntType& Value) {
   switch (Format) {
     case IntTypeFormat::Uint8:
@@ -76,6 +76,16 @@ class Reader : public std::enable_shared_from_this<Reader> {
   virtual bool readBlockExit();
   virtual bool readBinary(const filt::Node* Encoding, decode::IntType& Value);
   virtual bool readValue(const filt::Node* Format, decode::IntType& Value);
+  // Reads up to Count values (with the given Format) into Values, stopping
+  // early if stillMoreInputToProcessNow() fails. Returns the number of values
+  // read.
+  virtual size_t readValues(const filt::Node* Format,
+                            size_t Count,
+                            decode::IntType* Values);
+  // Reads up to Size (uint8) bytes into Buffer, stopping early at the end of
+  // the current block, or if stillMoreInputToProcessNow() fails. Returns the
+  // number of bytes read.
+  virtual size_t readBytes(uint8_t* Buffer, size_t Size);
   virtual bool readHeaderValue(interp::IntTypeFormat Format,
                                decode::IntType& Value);
   // WARNING: If overridden in reader, also override in writer so that you get
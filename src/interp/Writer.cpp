@@ -156,6 +156,22 @@ bool Writer::writeValue(decode::IntType Value, const filt::Node* Format) {
   }
 }
 
+bool Writer::writeValues(const IntType* Values,
+                         size_t Count,
+                         const filt::Node* Format) {
+  for (size_t i = 0; i < Count; ++i)
+    if (!writeValue(Values[i], Format))
+      return false;
+  return true;
+}
+
+bool Writer::writeBytes(const uint8_t* Buffer, size_t Size) {
+  for (size_t i = 0; i < Size; ++i)
+    if (!writeUint8(Buffer[i]))
+      return false;
+  return true;
+}
+
 bool Writer::writeBlockEnter() {
   return true;
 }
@@ -57,6 +57,12 @@ class Writer {
   virtual bool writeFreezeEof();
   virtual bool writeBinary(decode::IntType Value, const filt::Node* Encoding);
   virtual bool writeValue(decode::IntType Value, const filt::Node* Format);
+  // Writes the Count values (with the given Format) in Values.
+  virtual bool writeValues(const decode::IntType* Values,
+                           size_t Count,
+                           const filt::Node* Format);
+  // Writes the Size (uint8) bytes in Buffer.
+  virtual bool writeBytes(const uint8_t* Buffer, size_t Size);
   virtual bool writeTypedValue(decode::IntType Value,
                                interp::IntTypeFormat Format);
   virtual bool writeHeaderValue(decode::IntType Value,
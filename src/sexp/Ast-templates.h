@@ -23,32 +23,31 @@ namespace wasm {
 
 namespace filt {
 
-template <typename T>
-T* SymbolTable::create() {
-  T* Nd = new T(*this);
+template <typename T, typename... Args>
+T* SymbolTable::allocateNode(Args&&... args) {
+  T* Nd = NodeArena.create<T>(std::forward<Args>(args)...);
   Allocated.push_back(Nd);
   return Nd;
 }
 
+template <typename T>
+T* SymbolTable::create() {
+  return allocateNode<T>(*this);
+}
+
 template <typename T>
 T* SymbolTable::create(Node* Kid) {
-  T* Nd = new T(*this, Kid);
-  Allocated.push_back(Nd);
-  return Nd;
+  return allocateNode<T>(*this, Kid);
 }
 
 template <typename T>
 T* SymbolTable::create(Node* Kid1, Node* Kid2) {
-  T* Nd = new T(*this, Kid1, Kid2);
-  Allocated.push_back(Nd);
-  return Nd;
+  return allocateNode<T>(*this, Kid1, Kid2);
 }
 
 template <typename T>
 T* SymbolTable::create(Node* Kid1, Node* Kid2, Node* Kid3) {
-  T* Nd = new T(*this, Kid1, Kid2, Kid3);
-  Allocated.push_back(Nd);
-  return Nd;
+  return allocateNode<T>(*this, Kid1, Kid2, Kid3);
 }
 
 }  // end of namespace filt
@@ -426,9 +426,10 @@ IntLookupNode::~IntLookupNode() {
 }
 
 const Node* IntLookupNode::get(decode::IntType Value) {
-  if (Lookup.count(Value))
-    return Lookup[Value];
-  return nullptr;
+  auto Iter = Lookup.find(Value);
+  if (Iter == Lookup.end())
+    return nullptr;
+  return Iter->second;
 }
 
 bool IntLookupNode::add(decode::IntType Value, const Node* Nd) {
@@ -687,15 +688,16 @@ std::shared_ptr<TraceClass> SymbolTable::getTracePtr() {
 }
 
 void SymbolTable::deallocateNodes() {
+  // Note: The memory of the nodes is released with NodeArena.
   for (Node* Nd : Allocated)
-    delete Nd;
+    Nd->~Node();
+  Allocated.clear();
 }
 
 SymbolNode* SymbolTable::getSymbolDefinition(const std::string& Name) {
   SymbolNode* Node = SymbolMap[Name];
   if (Node == nullptr) {
-    Node = new SymbolNode(*this, Name);
-    Allocated.push_back(Node);
+    Node = allocateNode<SymbolNode>(*this, Name);
     SymbolMap[Name] = Node;
   }
   return Node;
@@ -718,30 +720,24 @@ SymbolNode* SymbolTable::getPredefined(PredefinedSymbol Sym) {
       IntegerValue I(Op##tag, Value, Format, false);                 \
       IntegerNode* Node = IntMap[I];                                 \
       if (Node == nullptr) {                                         \
-        Node = new tag##Node(*this, Value, Format);                  \
-        Allocated.push_back(Node);                                   \
+        Node = allocateNode<tag##Node>(*this, Value, Format);        \
         IntMap[I] = Node;                                            \
       }                                                              \
       return dyn_cast<tag##Node>(Node);                              \
     }                                                                \
-    tag##Node* Node = new tag##Node(*this, Value, Format);           \
-    Allocated.push_back(Node);                                       \
-    return Node;                                                     \
+    return allocateNode<tag##Node>(*this, Value, Format);            \
   }                                                                  \
   tag##Node* SymbolTable::get##tag##Definition() {                   \
     if (mergable) {                                                  \
       IntegerValue I(Op##tag, (defval), ValueFormat::Decimal, true); \
       IntegerNode* Node = IntMap[I];                                 \
       if (Node == nullptr) {                                         \
-        Node = new tag##Node(*this);                                 \
-        Allocated.push_back(Node);                                   \
+        Node = allocateNode<tag##Node>(*this);                       \
         IntMap[I] = Node;                                            \
       }                                                              \
       return dyn_cast<tag##Node>(Node);                              \
     }                                                                \
-    tag##Node* Node = new tag##Node(*this);                          \
-    Allocated.push_back(Node);                                       \
-    return Node;                                                     \
+    return allocateNode<tag##Node>(*this);                           \
   }
 AST_INTEGERNODE_TABLE
 #undef X
@@ -827,6 +823,8 @@ bool SymbolTable::areActionsConsistent() {
 void SymbolTable::install(FileNode* Root) {
   TRACE_METHOD("install");
   CachedValue.clear();
+  UseNodes.clear();
+  EnclosingDefs.clear();
   UndefinedCallbacks.clear();
   CallbackValues.clear();
   CallbackLiterals.clear();
@@ -839,6 +837,64 @@ void SymbolTable::install(FileNode* Root) {
     IsValid = areActionsConsistent();
   if (!IsValid)
     fatal("Unable to install algorthms, validation failed!");
+  installCachedValues();
+}
+
+void SymbolTable::installCachedValues() {
+  // Note: Caching may create nodes, so only visit nodes that exist now.
+  for (size_t i = 0, NumNodes = Allocated.size(); i < NumNodes; ++i) {
+    const Node* Nd = Allocated[i];
+    if (const auto* Sym = dyn_cast<SymbolNode>(Nd)) {
+      Sym->getDefineDefinition();
+      Sym->getLiteralDefinition();
+      Sym->getLiteralActionDefinition();
+    } else if (const auto* Sel = dyn_cast<SelectBaseNode>(Nd)) {
+      Sel->installCaseTable();
+    } else if (const auto* Eval = dyn_cast<BinaryEvalNode>(Nd)) {
+      Eval->getEncoding(0);
+      Eval->getDecodeTables();
+    } else if (const auto* Call = dyn_cast<EvalNode>(Nd)) {
+      Call->installDef(UseNodes.size());
+      UseNodes.push_back(Call);
+    } else if (const auto* Use = dyn_cast<LiteralUseNode>(Nd)) {
+      Use->installDef(UseNodes.size());
+      UseNodes.push_back(Use);
+    } else if (const auto* Use = dyn_cast<LiteralActionUseNode>(Nd)) {
+      Use->installDef(UseNodes.size());
+      UseNodes.push_back(Use);
+    }
+  }
+  installEnclosingDefs();
+}
+
+void SymbolTable::installEnclosingDefs() {
+  // Code of enclosing scopes runs in this scope when called from it. Resolve
+  // its uses now, since lookups in this scope may create nodes.
+  for (SymbolTable* Scope = EnclosingScope.get(); Scope != nullptr;
+       Scope = Scope->getEnclosingScope()) {
+    EnclosingDefs.emplace_back();
+    std::vector<const Node*>& Defs = EnclosingDefs.back();
+    Defs.reserve(Scope->UseNodes.size());
+    for (const Node* Nd : Scope->UseNodes) {
+      if (const auto* Call = dyn_cast<EvalNode>(Nd))
+        Defs.push_back(Call->lookupDef(*this));
+      else if (const auto* Use = dyn_cast<LiteralUseNode>(Nd))
+        Defs.push_back(Use->lookupDef(*this));
+      else
+        Defs.push_back(cast<LiteralActionUseNode>(Nd)->lookupDef(*this));
+    }
+  }
+}
+
+const Node* SymbolTable::getEnclosingDef(const SymbolTable& Scope,
+                                         size_t Index) const {
+  const SymbolTable* Enclosing = EnclosingScope.get();
+  for (const std::vector<const Node*>& Defs : EnclosingDefs) {
+    if (Enclosing == &Scope)
+      return Index < Defs.size() ? Defs[Index] : nullptr;
+    Enclosing = Enclosing->EnclosingScope.get();
+  }
+  return nullptr;
 }
 
 const FileHeaderNode* SymbolTable::getSourceHeader() const {
@@ -1164,6 +1220,27 @@ const LiteralActionDefNode* LiteralActionUseNode::getDef() const {
   return cast<SymbolNode>(getKid(0))->getLiteralActionDefinition();
 }
 
+const LiteralDefNode* LiteralUseNode::lookupDef(SymbolTable& Scope) const {
+  return Scope.getSymbolDefn(cast<SymbolNode>(getKid(0)))
+      ->getLiteralDefinition();
+}
+
+const LiteralActionDefNode* LiteralActionUseNode::lookupDef(
+    SymbolTable& Scope) const {
+  return Scope.getSymbolDefn(cast<SymbolNode>(getKid(0)))
+      ->getLiteralActionDefinition();
+}
+
+void LiteralUseNode::installDef(size_t Index) const {
+  Def = getDef();
+  UseIndex = Index;
+}
+
+void LiteralActionUseNode::installDef(size_t Index) const {
+  Def = getDef();
+  UseIndex = Index;
+}
+
 bool LiteralUseNode::validateNode(NodeVectorType& Parents) {
   if (getDef())
     return true;
@@ -1316,9 +1393,7 @@ BinaryAcceptNode::BinaryAcceptNode(SymbolTable& Symtab,
 
 BinaryAcceptNode* SymbolTable::createBinaryAccept(IntType Value,
                                                   unsigned NumBits) {
-  BinaryAcceptNode* Nd = new BinaryAcceptNode(*this, Value, NumBits);
-  Allocated.push_back(Nd);
-  return Nd;
+  return allocateNode<BinaryAcceptNode>(*this, Value, NumBits);
 }
 
 template BinaryAcceptNode* SymbolTable::create<BinaryAcceptNode>();
@@ -1541,7 +1616,9 @@ Node* DefineNode::getBody() const {
   return Nd;
 }
 
-NaryNode::NaryNode(SymbolTable& Symtab, NodeType Type) : Node(Symtab, Type) {
+NaryNode::NaryNode(SymbolTable& Symtab, NodeType Type)
+    : Node(Symtab, Type),
+      Kids(alloc::TemplateAllocator<Node*>(Symtab.getAllocator())) {
 }
 
 NaryNode::~NaryNode() {
@@ -1604,6 +1681,16 @@ SymbolNode* EvalNode::getCallName() const {
   return dyn_cast<SymbolNode>(getKid(0));
 }
 
+const DefineNode* EvalNode::lookupDef(SymbolTable& Scope) const {
+  return Scope.getSymbolDefn(getCallName())->getDefineDefinition();
+}
+
+void EvalNode::installDef(size_t Index) const {
+  const SymbolNode* Sym = getCallName();
+  Def = Sym ? Sym->getDefineDefinition() : nullptr;
+  UseIndex = Index;
+}
+
 bool EvalNode::validateNode(NodeVectorType& Parents) {
   const auto* Sym = dyn_cast<SymbolNode>(getKid(0));
   assert(Sym);
@@ -1651,7 +1738,7 @@ bool SelectBaseNode::implementsClass(NodeType Type) {
 }
 
 SelectBaseNode::SelectBaseNode(SymbolTable& Symtab, NodeType Type)
-    : NaryNode(Symtab, Type) {
+    : NaryNode(Symtab, Type), CaseTableMin(0), CaseLookup(nullptr) {
 }
 
 IntLookupNode* SelectBaseNode::getIntLookup() const {
@@ -1663,14 +1750,38 @@ IntLookupNode* SelectBaseNode::getIntLookup() const {
   return Lookup;
 }
 
-const CaseNode* SelectBaseNode::getCase(IntType Key) const {
-  IntLookupNode* Lookup = getIntLookup();
+const CaseNode* SelectBaseNode::getCaseUsingLookup(IntType Key) const {
+  IntLookupNode* Lookup = CaseLookup ? CaseLookup : getIntLookup();
   if (const CaseNode* Case = dyn_cast<CaseNode>(Lookup->get(Key)))
     return Case;
   return nullptr;
 }
 
+void SelectBaseNode::installCaseTable() const {
+  CaseLookup = getIntLookup();
+  CaseTable.clear();
+  CaseTableMin = 0;
+  const IntLookupNode::LookupMap& Cases = CaseLookup->getLookupMap();
+  if (Cases.empty())
+    return;
+  IntType Min = std::numeric_limits<IntType>::max();
+  IntType Max = 0;
+  for (const auto& Pair : Cases) {
+    Min = std::min(Min, Pair.first);
+    Max = std::max(Max, Pair.first);
+  }
+  // Only use a table if it isn't (much) bigger than the number of cases.
+  IntType Range = Max - Min;
+  if (Range >= std::max(size_t(MinCaseTableSize), 4 * Cases.size()))
+    return;
+  CaseTable.resize(Range + 1, nullptr);
+  for (const auto& Pair : Cases)
+    CaseTable[Pair.first - Min] = dyn_cast<CaseNode>(Pair.second);
+  CaseTableMin = Min;
+}
+
 bool SelectBaseNode::addCase(const CaseNode* Case) {
+  CaseTable.clear();
   return getIntLookup()->add(Case->getValue(), Case);
 }
 
@@ -1965,7 +2076,7 @@ utils::TraceClass& OpcodeNode::WriteRange::getTrace() const {
 }
 
 BinaryEvalNode::BinaryEvalNode(SymbolTable& Symtab, Node* Encoding)
-    : UnaryNode(Symtab, OpBinaryEval, Encoding) {
+    : UnaryNode(Symtab, OpBinaryEval, Encoding), DecodeTablesBuilt(false) {
 }
 
 template BinaryEvalNode* SymbolTable::create<BinaryEvalNode>(Node* Kid);
@@ -1994,6 +2105,56 @@ bool BinaryEvalNode::addEncoding(BinaryAcceptNode* Encoding) {
   return getIntLookup()->add(Encoding->getValue(), Encoding);
 }
 
+namespace {
+
+// Returns the depth of the binary tree rooted at Nd, up to Limit.
+unsigned getBinaryDepth(const Node* Nd, unsigned Limit) {
+  if (Limit == 0 || !isa<BinarySelectNode>(Nd))
+    return 0;
+  return 1 + std::max(getBinaryDepth(Nd->getKid(0), Limit - 1),
+                      getBinaryDepth(Nd->getKid(1), Limit - 1));
+}
+
+}  // end of anonymous namespace
+
+const std::vector<BinaryEvalNode::DecodeTable>&
+BinaryEvalNode::getDecodeTables() const {
+  if (!DecodeTablesBuilt) {
+    DecodeTablesBuilt = true;
+    if (isa<BinarySelectNode>(getKid(0)))
+      addDecodeTable(getKid(0));
+  }
+  return DecodeTables;
+}
+
+size_t BinaryEvalNode::addDecodeTable(const Node* Root) const {
+  size_t Index = DecodeTables.size();
+  unsigned NumBits = getBinaryDepth(Root, MaxDecodeTableBits);
+  size_t Offset = DecodeEntries.size();
+  size_t NumEntries = size_t(1) << NumBits;
+  DecodeTables.push_back({Root, NumBits, Offset});
+  DecodeEntries.resize(Offset + NumEntries);
+  for (size_t Bits = 0; Bits < NumEntries; ++Bits) {
+    const Node* Nd = Root;
+    unsigned Depth = 0;
+    while (Depth < NumBits && isa<BinarySelectNode>(Nd)) {
+      Nd = Nd->getKid((Bits >> (NumBits - Depth - 1)) & 1);
+      ++Depth;
+    }
+    DecodeEntry Entry = {0, 0, false};
+    if (const auto* Accept = dyn_cast<BinaryAcceptNode>(Nd)) {
+      Entry.Value = Accept->getValue();
+      Entry.NumBits = Depth;
+      Entry.Accept = true;
+    } else if (isa<BinarySelectNode>(Nd)) {
+      Entry.Value = addDecodeTable(Nd);
+      Entry.NumBits = Depth;
+    }
+    DecodeEntries[Offset + Bits] = Entry;
+  }
+  return Index;
+}
+
 }  // end of namespace filt
 
 }  // end of namespace wasm
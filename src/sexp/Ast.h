@@ -25,11 +25,13 @@
 #include <unordered_set>
 #include <vector>
 
+#include "ADT/arena_vector.h"
 #include "interp/IntFormats.h"
 #include "sexp/Ast.def"
 #include "sexp/NodeType.h"
 #include "sexp/PredefinedStrings.def"
 #include "stream/ValueFormat.h"
+#include "utils/Casting.h"
 
 namespace wasm {
 
@@ -174,7 +176,8 @@ class SymbolTable FINAL : public std::enable_shared_from_this<SymbolTable> {
   // Gets actions corresponding to enter/exit block.
   const CallbackNode* getBlockEnterCallback();
   const CallbackNode* getBlockExitCallback();
-  // Install definitions in tree defined by root.
+  // Install definitions in tree defined by root. Once installed, the symbol
+  // table is only read while interpreting.
   void install(FileNode* Root);
   const FileNode* getInstalledRoot() const { return Root; }
   Node* getError() const { return Error; }
@@ -196,6 +199,11 @@ class SymbolTable FINAL : public std::enable_shared_from_this<SymbolTable> {
   T* create(Node* Nd1, Node* Nd2, Node* Nd3);
   BinaryAcceptNode* createBinaryAccept(decode::IntType Value, unsigned NumBits);
 
+  // Returns the definition used by the eval (or literal use) with index Index
+  // of enclosing scope Scope, when evaluated in this scope. Resolved when this
+  // symbol table is installed.
+  const Node* getEnclosingDef(const SymbolTable& Scope, size_t Index) const;
+
   // Returns the cached value associated with a node, or nullptr if not cached.
   Node* getCachedValue(const Node* Nd) { return CachedValue[Nd]; }
   void setCachedValue(const Node* Nd, Node* Value) { CachedValue[Nd] = Value; }
@@ -228,9 +236,15 @@ class SymbolTable FINAL : public std::enable_shared_from_this<SymbolTable> {
   utils::TraceClass& getTrace();
   void describe(FILE* Out);
 
+  // The allocator for nodes (and their kids).
+  alloc::Allocator* getAllocator() { return &NodeArena; }
+
  private:
   typedef std::map<const Node*, Node*> CachedValueMap;
+  // Note: Must be defined before the nodes allocated in it.
+  alloc::MallocArena NodeArena;
   std::shared_ptr<SymbolTable> EnclosingScope;
+  // The allocated nodes, which must be destructed when the symbol table is.
   std::vector<Node*> Allocated;
   std::shared_ptr<utils::TraceClass> Trace;
   FileNode* Root;
@@ -245,13 +259,25 @@ class SymbolTable FINAL : public std::enable_shared_from_this<SymbolTable> {
   CallbackNode* BlockEnterCallback;
   CallbackNode* BlockExitCallback;
   CachedValueMap CachedValue;
+  // The installed eval and literal uses, indexed by their use index.
+  std::vector<const Node*> UseNodes;
+  // The definitions of the uses of each enclosing scope (innermost first), as
+  // resolved in this scope.
+  std::vector<std::vector<const Node*>> EnclosingDefs;
   bool AllowInconsistentActions;
 
   void init();
+  template <typename T, typename... Args>
+  T* allocateNode(Args&&... args);
   void deallocateNodes();
 
   void installPredefined();
   void installDefinitions(Node* Root);
+  // Computes the values nodes otherwise cache lazily, so that an installed
+  // symbol table isn't modified while being used (and hence can be shared by
+  // threads).
+  void installCachedValues();
+  void installEnclosingDefs();
 
   bool areActionsConsistent();
   Node* stripUsing(Node* Root, std::function<Node*(Node*)> stripKid);
@@ -505,7 +531,7 @@ class NaryNode : public Node {
   static bool implementsClass(NodeType Type);
 
  protected:
-  std::vector<Node*> Kids;
+  ARENA_VECTOR(Node*) Kids;
   NaryNode(SymbolTable& Symtab, NodeType Type);
 };
 
@@ -520,6 +546,7 @@ class IntLookupNode FINAL : public CachedNode {
   ~IntLookupNode() OVERRIDE;
   const Node* get(decode::IntType Value);
   bool add(decode::IntType Value, const Node* Nd);
+  const LookupMap& getLookupMap() const { return Lookup; }
 
  private:
   LookupMap Lookup;
@@ -722,13 +749,32 @@ class SelectBaseNode : public NaryNode {
 
  public:
   ~SelectBaseNode() OVERRIDE;
-  const CaseNode* getCase(decode::IntType Key) const;
+  const CaseNode* getCase(decode::IntType Key) const {
+    decode::IntType Index = Key - CaseTableMin;
+    if (Index < CaseTable.size())
+      return CaseTable[Index];
+    return getCaseUsingLookup(Key);
+  }
   bool addCase(const CaseNode* Case);
+  // Builds a (dense) table of the cases, indexed by case key, if the case keys
+  // fall in a compact range. Called when the symbol table is installed.
+  void installCaseTable() const;
   static bool implementsClass(NodeType Type);
 
  protected:
   SelectBaseNode(SymbolTable& Symtab, NodeType Type);
   IntLookupNode* getIntLookup() const;
+
+ private:
+  // Cases with keys in [CaseTableMin, CaseTableMin + CaseTable.size()).
+  // Entries are nullptr if no case has that key.
+  mutable std::vector<const CaseNode*> CaseTable;
+  mutable decode::IntType CaseTableMin;
+  // Lookup of cases, cached when installed.
+  mutable IntLookupNode* CaseLookup;
+  static constexpr size_t MinCaseTableSize = 256;
+
+  const CaseNode* getCaseUsingLookup(decode::IntType Key) const;
 };
 
 #define X(tag, NODE_DECLS)                                                 \
@@ -807,16 +853,46 @@ class BinaryEvalNode : public UnaryNode {
   BinaryEvalNode& operator=(const BinaryEvalNode&) = delete;
 
  public:
+  // Lookup tables that decode the encoding several bits at a time. Each
+  // table is indexed by the next NumBits bits of input, and covers the
+  // subtree rooted at Root. Subtrees deeper than MaxDecodeTableBits continue
+  // in another table.
+  struct DecodeTable {
+    const Node* Root;
+    unsigned NumBits;
+    size_t Offset;
+  };
+  struct DecodeEntry {
+    // If Accept, the decoded value. Otherwise, the index of the next table.
+    decode::IntType Value;
+    // Number of bits consumed. Zero if not a valid path of the encoding.
+    unsigned NumBits;
+    bool Accept;
+  };
+  static constexpr unsigned MaxDecodeTableBits = 8;
+
   explicit BinaryEvalNode(SymbolTable& Symtab, Node* Encoding);
   ~BinaryEvalNode() OVERRIDE;
 
   const Node* getEncoding(decode::IntType Value) const;
   bool addEncoding(BinaryAcceptNode* Encoding);
 
+  // Returns the decode tables (built on first call). Returns an empty vector
+  // if the encoding doesn't start with a binary select.
+  const std::vector<DecodeTable>& getDecodeTables() const;
+  const std::vector<DecodeEntry>& getDecodeEntries() const {
+    return DecodeEntries;
+  }
+
   static bool implementsClass(NodeType Type) { return OpBinaryEval == Type; }
 
  private:
+  mutable std::vector<DecodeTable> DecodeTables;
+  mutable std::vector<DecodeEntry> DecodeEntries;
+  mutable bool DecodeTablesBuilt;
+
   IntLookupNode* getIntLookup() const;
+  size_t addDecodeTable(const Node* Root) const;
 };
 
 }  // end of namespace filt
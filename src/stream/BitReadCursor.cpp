@@ -19,6 +19,7 @@
 
 #include "stream/BitReadCursor.h"
 
+#include "stream/BlockEob.h"
 #include "stream/Page.h"
 
 namespace wasm {
@@ -30,6 +31,18 @@ namespace {
 constexpr BitReadCursor::WordType BitsInByte =
     BitReadCursor::WordType(sizeof(ByteType) * CHAR_BIT);
 
+constexpr BitReadCursor::WordType BitsInWord =
+    BitReadCursor::WordType(sizeof(BitReadCursor::WordType) * CHAR_BIT);
+
+// Returns the (big-endian) word starting at Buffer. Written so that
+// compilers can replace the loop with a single (byte swapped) load.
+inline BitReadCursor::WordType loadWord(const ByteType* Buffer) {
+  BitReadCursor::WordType Word = 0;
+  for (size_t i = 0; i < sizeof(BitReadCursor::WordType); ++i)
+    Word = (Word << BitsInByte) | Buffer[i];
+  return Word;
+}
+
 }  // end of namespace
 
 BitReadCursor::BitReadCursor() {
@@ -51,7 +64,9 @@ BitReadCursor::BitReadCursor(const BitReadCursor& C)
 }
 
 BitReadCursor::BitReadCursor(const BitReadCursor& C, AddressType StartAddress)
-    : ReadCursor(C, StartAddress), CurWord(C.CurWord), NumBits(C.NumBits) {
+    : ReadCursor(C, StartAddress) {
+  // Note: The bits buffered in C belong to its address, not StartAddress.
+  initFields();
 }
 
 BitReadCursor::~BitReadCursor() {
@@ -74,14 +89,73 @@ void BitReadCursor::swap(BitReadCursor& C) {
   std::swap(NumBits, C.NumBits);
 }
 
+void BitReadCursor::save(CursorSnapshot& Snapshot) const {
+  Snapshot.CurAddress = CurAddress;
+  Snapshot.GuaranteedBeforeEob = GuaranteedBeforeEob;
+  Snapshot.CurPage = CurPage.get();
+  Snapshot.Eob = EobPtr.get();
+  Snapshot.CurWord = CurWord;
+  Snapshot.NumBits = NumBits;
+  Snapshot.CurByte = CurByte;
+}
+
+void BitReadCursor::restore(const CursorSnapshot& Snapshot) {
+  CurAddress = Snapshot.CurAddress;
+  GuaranteedBeforeEob = Snapshot.GuaranteedBeforeEob;
+  // Note: Only touch the reference counts if the page (or block) changed
+  // since the save.
+  if (CurPage.get() != Snapshot.CurPage)
+    CurPage = Snapshot.CurPage ? Snapshot.CurPage->shared_from_this() : nullptr;
+  if (EobPtr.get() != Snapshot.Eob)
+    EobPtr = Snapshot.Eob ? Snapshot.Eob->shared_from_this() : nullptr;
+  CurWord = Snapshot.CurWord;
+  NumBits = Snapshot.NumBits;
+  CurByte = Snapshot.CurByte;
+}
+
 void BitReadCursor::alignToByte() {
-  assert(NumBits < 8);
+  // Drops the unread bits of the current byte. The whole bytes left in
+  // CurWord were filled from the current page, just before CurAddress, so
+  // hand them back.
+  CurAddress -= NumBits / BitsInByte;
   NumBits = 0;
   CurWord = 0;
 }
 
+bool BitReadCursor::fillWord() {
+  size_t NumBytes = (BitsInWord - NumBits) / BitsInByte;
+  if (NumBytes == 0 || CurAddress >= GuaranteedBeforeEob)
+    return false;
+  AddressType Available = GuaranteedBeforeEob - CurAddress;
+  const ByteType* Buffer = getBufferPtr();
+  if (Available >= sizeof(WordType)) {
+    // Refill using a whole word, and then drop the bytes that don't fit.
+    WordType Word = loadWord(Buffer);
+    CurWord = (NumBytes == sizeof(WordType))
+                  ? Word
+                  : (CurWord << (NumBytes * BitsInByte)) |
+                        (Word >> (BitsInWord - NumBytes * BitsInByte));
+  } else {
+    NumBytes = std::min(NumBytes, size_t(Available));
+    for (size_t i = 0; i < NumBytes; ++i)
+      CurWord = (CurWord << BitsInByte) | Buffer[i];
+  }
+  CurAddress += NumBytes;
+  NumBits += NumBytes * BitsInByte;
+  return true;
+}
+
 void BitReadCursor::describeDerivedExtensions(FILE* File, bool IncludeDetail) {
-  AddressType Address = getAddress();
+  // Note: Whole bytes in CurWord have been read from the page, but not
+  // consumed, so back up over them.
+  AddressType Address = getAddress() - NumBits / BitsInByte;
+  unsigned PartialBits = NumBits % BitsInByte;
+  if (NumBits != 0 && PartialBits == 0) {
+    describeAddress(File, Address);
+    if (IncludeDetail)
+      describePage(File, CurPage.get());
+    return;
+  }
   if (NumBits == 0 || Address == 0) {
     ReadCursor::describeDerivedExtensions(File, IncludeDetail);
     if (NumBits > 0)
@@ -92,7 +166,7 @@ void BitReadCursor::describeDerivedExtensions(FILE* File, bool IncludeDetail) {
   describeAddress(File, Address - 1);
   if (IncludeDetail)
     describePage(File, CurPage.get());
-  fprintf(File, ":%u", BitsInByte - NumBits);
+  fprintf(File, ":%u", unsigned(BitsInByte - PartialBits));
 }
 
 #define BITREAD_TYPED(Mask, MaskSize)                           \
@@ -103,9 +177,11 @@ void BitReadCursor::describeDerivedExtensions(FILE* File, bool IncludeDetail) {
       CurWord &= ~(Mask << NumBits);                            \
       return Value;                                             \
     }                                                           \
+    /* Not enough bits left, read more in. */                   \
+    if (fillWord())                                             \
+      continue;                                                 \
     if (atEob())                                                \
       break;                                                    \
-    /* Not enough bits left, read more in. */                   \
     CurWord = (CurWord << BitsInByte) | ReadCursor::readByte(); \
     NumBits += BitsInByte;                                      \
   } while (1);                                                  \
@@ -125,10 +201,19 @@ static constexpr BitReadCursor::WordType ByteMask = (1 << BitsInByte) - 1;
 
 }  // end of anonymous namespace
 
+bool BitReadCursor::atEof() const {
+  if (!ReadCursor::atEof())
+    return false;
+  return NumBits < BitsInByte;
+}
+
 bool BitReadCursor::atEob() {
-  if (!ReadCursor::atEob())
+  // Note: Check the buffered bits first. Whole bytes in CurWord belong to
+  // the page before CurAddress, and ReadCursor::atEob() may move to the next
+  // page.
+  if (NumBits != 0)
     return false;
-  return NumBits == 0;
+  return ReadCursor::atEob();
 }
 
 ByteType BitReadCursor::readByte() {
@@ -141,6 +226,55 @@ ByteType BitReadCursor::readBit() {
   BITREAD(1, 1);
 }
 
+bool BitReadCursor::peekBits(unsigned WantedBits, WordType& Value) {
+  assert(WantedBits <= MaxPeekBits);
+  if (WantedBits > NumBits && (!fillWord() || WantedBits > NumBits))
+    return false;
+  Value = CurWord >> (NumBits - WantedBits);
+  return true;
+}
+
+void BitReadCursor::consumeBits(unsigned WantedBits) {
+  if (WantedBits <= NumBits) {
+    NumBits -= WantedBits;
+    if (NumBits < BitsInWord)
+      CurWord &= (WordType(1) << NumBits) - 1;
+    return;
+  }
+  WantedBits -= NumBits;
+  CurAddress += WantedBits / BitsInByte;
+  WantedBits %= BitsInByte;
+  if (WantedBits == 0) {
+    CurWord = 0;
+    NumBits = 0;
+    return;
+  }
+  NumBits = BitsInByte - WantedBits;
+  CurWord = ReadCursor::readByte() & ((WordType(1) << NumBits) - 1);
+}
+
+const ByteType* BitReadCursor::peekBytes(size_t Count) {
+  if (NumBits % BitsInByte != 0)
+    return nullptr;
+  alignToByte();
+  if (CurAddress >= GuaranteedBeforeEob ||
+      GuaranteedBeforeEob - CurAddress < Count)
+    return nullptr;
+  return getBufferPtr();
+}
+
+BitReadCursor::WordType BitReadCursor::readBits(unsigned WantedBits) {
+  WordType Value;
+  if (peekBits(WantedBits, Value)) {
+    consumeBits(WantedBits);
+    return Value;
+  }
+  Value = 0;
+  for (unsigned i = 0; i < WantedBits; ++i)
+    Value = (Value << 1) | readBit();
+  return Value;
+}
+
 }  // end of namespace decode
 
 }  // end of namespace wasm
@@ -26,9 +26,25 @@ namespace wasm {
 
 namespace decode {
 
+// Holds the state of a BitReadCursor, so that the cursor can be saved and
+// restored (e.g. when peeking) without copying its reference counted
+// pointers. Note: A snapshot doesn't keep its page and block eob alive, so
+// they must be pinned by other means until the snapshot is restored.
+struct CursorSnapshot {
+  AddressType CurAddress;
+  AddressType GuaranteedBeforeEob;
+  Page* CurPage;
+  BlockEob* Eob;
+  uint64_t CurWord;
+  unsigned NumBits;
+  ByteType CurByte;
+};
+
 class BitReadCursor : public ReadCursor {
  public:
-  typedef uint32_t WordType;
+  typedef uint64_t WordType;
+  // Maximum number of bits that can be peeked at once.
+  static constexpr unsigned MaxPeekBits = 56;
   BitReadCursor();
   BitReadCursor(std::shared_ptr<Queue> Que);
   BitReadCursor(StreamType Type, std::shared_ptr<Queue> Que);
@@ -45,18 +61,53 @@ class BitReadCursor : public ReadCursor {
 
   void swap(BitReadCursor& C);
 
+  // Saves the state of the cursor into Snapshot.
+  void save(CursorSnapshot& Snapshot) const;
+  // Restores the state saved in Snapshot. Assumes that the queue of the
+  // cursor hasn't changed since the save.
+  void restore(const CursorSnapshot& Snapshot);
+
+  bool atEof() const OVERRIDE;
   bool atEob() OVERRIDE;
   ByteType readByte() OVERRIDE;
   ByteType readBit() OVERRIDE;
   void alignToByte();
 
+  // Sets Value to the next NumBits (<= MaxPeekBits) bits of input, without
+  // consuming them. Returns false if the bits are not immediately available
+  // (i.e. they cross the current page or block boundary).
+  bool peekBits(unsigned NumBits, WordType& Value);
+  // Consumes NumBits bits of input, leaving the cursor as if readBit() had
+  // been called NumBits times. Assumes the bits were successfully peeked.
+  void consumeBits(unsigned NumBits);
+  // Reads the next NumBits (<= MaxPeekBits) bits of input.
+  WordType readBits(unsigned NumBits);
+  // Returns a pointer to the next Count bytes of input, if byte aligned and
+  // resident in the current page (and block). Otherwise returns nullptr. Use
+  // consumeBits() to advance past the bytes used. Note: Whole bytes buffered
+  // by peekBits() are returned to the page first.
+  const ByteType* peekBytes(size_t Count);
+  // Returns the number of bytes that peekBytes() can return, i.e. the byte
+  // aligned bytes resident in the current page (and block).
+  size_t getNumPeekableBytes() const {
+    if (NumBits % CHAR_BIT != 0)
+      return 0;
+    AddressType Address = CurAddress - NumBits / CHAR_BIT;
+    return Address >= GuaranteedBeforeEob ? 0 : GuaranteedBeforeEob - Address;
+  }
+
   void describeDerivedExtensions(FILE* File, bool IncludeDetail) OVERRIDE;
 
  private:
+  // Bits read from the page, but not yet consumed. Whole bytes are always
+  // filled from the current page, and end at CurAddress.
   WordType CurWord;
   unsigned NumBits;
 
   void initFields();
+  // Moves as many whole bytes as fit into CurWord, from the current page
+  // (and block). Returns false if no bytes were moved.
+  bool fillWord();
 };
 
 }  // end of namespace decode
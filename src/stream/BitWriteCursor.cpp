@@ -86,6 +86,13 @@ void BitWriteCursor::writeByte(ByteType Byte) {
   CurWord &= (1 << WordType(NumBits)) - 1;
 }
 
+void BitWriteCursor::writeBytes(const ByteType* Buffer, size_t Size) {
+  if (NumBits == 0)
+    return WriteCursor::writeBytes(Buffer, Size);
+  for (size_t i = 0; i < Size; ++i)
+    writeByte(Buffer[i]);
+}
+
 void BitWriteCursor::writeBit(ByteType Bit) {
   assert(Bit <= 1);
   CurWord = (CurWord << 1) | Bit;
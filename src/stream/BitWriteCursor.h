@@ -40,7 +40,19 @@ class BitWriteCursor : public WriteCursor {
   void swap(BitWriteCursor& C);
   void writeByte(ByteType Byte) OVERRIDE;
   void writeBit(ByteType Bit) OVERRIDE;
+  void writeBytes(const ByteType* Buffer, size_t Size);
   void alignToByte();
+  // Returns a pointer to room for the next Count bytes of output, if byte
+  // aligned and in the current page (and block). Otherwise returns nullptr.
+  // Use commitBytes() to advance past the bytes written.
+  ByteType* reserveBytes(size_t Count) {
+    if (NumBits != 0 || CurAddress >= GuaranteedBeforeEob ||
+        GuaranteedBeforeEob - CurAddress < Count)
+      return nullptr;
+    return getBufferPtr();
+  }
+  // Advances past the first Count bytes returned by reserveBytes().
+  void commitBytes(size_t Count) { CurAddress += Count; }
 
   BitWriteCursor& operator=(const BitWriteCursor& C) {
     assign(C);
@@ -32,7 +32,7 @@ Cursor::TraceContext::~TraceContext() {
 }
 
 Cursor::Cursor(StreamType Type, std::shared_ptr<Queue> Que)
-    : PageCursor(Que->FirstPage, Que->FirstPage->getMinAddress()),
+    : PageCursor(Que->getFirstPage(), Que->getFirstPage()->getMinAddress()),
       Type(Type),
       Que(Que),
       EobPtr(Que->getEofPtr()) {
@@ -57,6 +57,7 @@ class Cursor : public PageCursor {
   virtual bool atEof() const;
   AddressType getEofAddress() const;
   AddressType& getEobAddress() const;
+  std::shared_ptr<BlockEob> getEobPtr() const { return EobPtr; }
   void freezeEof();
   void close();
   AddressType fillSize();
@@ -0,0 +1,122 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "stream/FileWriteQueue.h"
+
+#include "stream/Page.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace wasm {
+
+namespace decode {
+
+FileWriteQueue::FileWriteQueue(const char* Filename)
+    : Fd(-1),
+      CloseOnExit(false),
+      HighWaterMark(4 * PageSize),
+      PendingSize(0) {
+  if (strcmp(Filename, "-") == 0) {
+    Fd = STDOUT_FILENO;
+  } else {
+    Fd = open(Filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    CloseOnExit = Fd >= 0;
+  }
+  if (Fd < 0)
+    fail();
+}
+
+FileWriteQueue::~FileWriteQueue() {
+  // NOTE: we must override the base destructor so that calls to dumpFirstPage
+  // is the one local to this class!
+  if (Fd >= 0 && !flush())
+    fprintf(stderr, "WARNING: Unable to write file!\n");
+}
+
+bool FileWriteQueue::flush() {
+  if (Fd < 0)
+    return isGood();
+  close();
+  bool Succeeded = isGood() && writePendingPages();
+  if (CloseOnExit && ::close(Fd) != 0)
+    Succeeded = false;
+  Fd = -1;
+  if (!Succeeded)
+    fail();
+  return Succeeded;
+}
+
+void FileWriteQueue::dumpFirstPage() {
+  // Note: Pending pages are owned by this queue only, so that the dumped
+  // addresses can't be found (and written) while waiting to be written.
+  std::shared_ptr<Page> FirstPage = popFirstPage();
+  if (FirstPage->getPageSize() > 0) {
+    PendingSize += FirstPage->getPageSize();
+    PendingPages.push_back(std::move(FirstPage));
+  } else {
+    releasePage(FirstPage);
+  }
+  if (PendingSize >= HighWaterMark && !writePendingPages())
+    fail();
+}
+
+bool FileWriteQueue::writePendingPages() {
+  if (PendingPages.empty())
+    return true;
+  bool Succeeded = true;
+  std::vector<struct iovec> Buffers;
+  Buffers.reserve(PendingPages.size());
+  for (std::shared_ptr<Page>& Pg : PendingPages) {
+    struct iovec Buffer;
+    Buffer.iov_base = Pg->getByteAddress(0);
+    Buffer.iov_len = Pg->getPageSize();
+    Buffers.push_back(Buffer);
+  }
+  size_t Next = 0;
+  while (Succeeded && Next < Buffers.size()) {
+    int Count = int(std::min(Buffers.size() - Next, size_t(IOV_MAX)));
+    ssize_t Written = writev(Fd, &Buffers[Next], Count);
+    if (Written <= 0) {
+      // Note: Writing nothing (while buffers are pending) is treated as an
+      // error, since retrying would not make progress.
+      Succeeded = Written < 0 && errno == EINTR;
+      continue;
+    }
+    // Skip the buffers written, and advance into a partially written buffer.
+    while (Next < Buffers.size() && size_t(Written) >= Buffers[Next].iov_len)
+      Written -= Buffers[Next++].iov_len;
+    if (Written > 0) {
+      Buffers[Next].iov_base = static_cast<char*>(Buffers[Next].iov_base) +
+                               Written;
+      Buffers[Next].iov_len -= Written;
+    }
+  }
+  for (std::shared_ptr<Page>& Pg : PendingPages)
+    releasePage(Pg);
+  PendingPages.clear();
+  PendingSize = 0;
+  return Succeeded;
+}
+
+}  // end of decode namespace
+
+}  // end of wasm namespace
@@ -0,0 +1,69 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines a queue that writes its contents to a file. Dumped pages are not
+// copied into an intermediate buffer. Rather, they are held until (at least)
+// the high-water mark number of bytes is pending, and then written directly
+// from the page buffers, using a single writev call (when possible).
+
+#ifndef DECOMPRESSOR_SRC_STREAM_FILEWRITEQUEUE_H_
+#define DECOMPRESSOR_SRC_STREAM_FILEWRITEQUEUE_H_
+
+#include "stream/Queue.h"
+
+namespace wasm {
+
+namespace decode {
+
+class FileWriteQueue FINAL : public Queue {
+  FileWriteQueue(const FileWriteQueue&) = delete;
+  FileWriteQueue& operator=(const FileWriteQueue&) = delete;
+  FileWriteQueue() = delete;
+
+ public:
+  // Opens file Filename ('-' implies stdout) for writing. If the file can't
+  // be opened, the queue is marked as broken (see isGood()).
+  explicit FileWriteQueue(const char* Filename);
+  ~FileWriteQueue() OVERRIDE;
+
+  // Defines the number of dumped bytes to collect before writing them to the
+  // file. Defaults to 4 pages.
+  void setHighWaterMark(AddressType NewValue) { HighWaterMark = NewValue; }
+
+  // Writes the remaining contents of the queue to the file, and closes the
+  // file. Returns true if all contents were written. Note: Called by the
+  // destructor (if not already called), which can only report a failure
+  // with a warning.
+  bool flush();
+
+ private:
+  int Fd;
+  bool CloseOnExit;
+  AddressType HighWaterMark;
+  // Dumped pages not yet written, and the number of bytes they hold.
+  PageVectorType PendingPages;
+  AddressType PendingSize;
+
+  void dumpFirstPage() OVERRIDE;
+  // Writes (and then releases) all pending pages. Returns true if successful.
+  bool writePendingPages();
+};
+
+}  // end of namespace decode
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_STREAM_FILEWRITEQUEUE_H_
@@ -0,0 +1,104 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "stream/MmapQueue.h"
+
+#include "stream/BlockEob.h"
+#include "stream/Page.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wasm {
+
+namespace decode {
+
+MmapQueue::MmapQueue(const char* Filename) : MmapQueue(mapFile(Filename)) {
+}
+
+MmapQueue::MmapQueue(Mapping Map) : Queue(createPage(Map, 0)), Map(Map) {
+  if (Map.Data == nullptr) {
+    fail();
+    return;
+  }
+  EofPtr->setEobAddress(Map.Size);
+  EofFrozen = true;
+}
+
+MmapQueue::~MmapQueue() {
+  // Release pages before the mapping they point into.
+  close();
+  if (Map.Data)
+    munmap(Map.Data, Map.Size);
+}
+
+MmapQueue::Mapping MmapQueue::mapFile(const char* Filename) {
+  Mapping Map;
+  if (strcmp(Filename, "-") == 0)
+    return Map;
+  int Fd = open(Filename, O_RDONLY);
+  if (Fd < 0)
+    return Map;
+  struct stat Stat;
+  if (fstat(Fd, &Stat) == 0 && S_ISREG(Stat.st_mode) && Stat.st_size > 0 &&
+      uintmax_t(Stat.st_size) <= uintmax_t(kMaxEofAddress)) {
+    // Note: Mapped privately (copy-on-write) and writable, since pages hand
+    // out non-const pointers to their contents.
+    void* Addr = mmap(nullptr, Stat.st_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, Fd, 0);
+    if (Addr != MAP_FAILED) {
+      Map.Data = static_cast<ByteType*>(Addr);
+      Map.Size = Stat.st_size;
+    }
+  }
+  ::close(Fd);
+  return Map;
+}
+
+std::shared_ptr<Page> MmapQueue::createPage(Mapping Map,
+                                            AddressType PageIndex) {
+  if (Map.Data == nullptr)
+    return Page::create(PageIndex);
+  AddressType MinAddress = minAddressForPage(PageIndex);
+  return std::make_shared<Page>(PageIndex, Map.Data + MinAddress,
+                                std::min(PageSize, Map.Size - MinAddress));
+}
+
+bool MmapQueue::readFill(AddressType Address) {
+  if (Map.Data == nullptr)
+    return false;
+  while (Address >= LastPage->getMaxAddress()) {
+    AddressType NextAddress = LastPage->getMaxAddress();
+    if (NextAddress >= Map.Size)
+      return false;
+    pushPage(createPage(Map, PageIndex(NextAddress)));
+  }
+  return true;
+}
+
+std::shared_ptr<Page> MmapQueue::getDumpedPage(AddressType Index) const {
+  if (Map.Data == nullptr || minAddressForPage(Index) >= Map.Size)
+    return nullptr;
+  return createPage(Map, Index);
+}
+
+}  // end of decode namespace
+
+}  // end of wasm namespace
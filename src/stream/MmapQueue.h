@@ -0,0 +1,71 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines a queue whose contents are a memory mapped (regular) file. Pages of
+// the queue point directly into the mapping, so no bytes are copied when
+// reading. The eof of the queue is known (and frozen) when created. Since the
+// whole file stays mapped, dumped pages can always be recreated, and hence
+// jumping back to any address of the file is valid.
+//
+// Note: Only regular (non-empty) files can be mapped. Use a ReadBackedQueue
+// (with a FileReader) for stdin and pipes.
+
+#ifndef DECOMPRESSOR_SRC_STREAM_MMAPQUEUE_H_
+#define DECOMPRESSOR_SRC_STREAM_MMAPQUEUE_H_
+
+#include "stream/Queue.h"
+
+namespace wasm {
+
+namespace decode {
+
+class MmapQueue FINAL : public Queue {
+  MmapQueue(const MmapQueue&) = delete;
+  MmapQueue& operator=(const MmapQueue&) = delete;
+  MmapQueue() = delete;
+
+ public:
+  // Maps file Filename. If the file can't be mapped, the queue is marked as
+  // broken (see isGood()).
+  MmapQueue(const char* Filename);
+  ~MmapQueue() OVERRIDE;
+
+  // Returns the mapped contents of the file (valid while the queue exists).
+  const ByteType* getContents() const { return Map.Data; }
+  AddressType getContentsSize() const { return Map.Size; }
+
+ private:
+  struct Mapping {
+    ByteType* Data;
+    AddressType Size;
+    Mapping() : Data(nullptr), Size(0) {}
+  };
+  // The mapped file.
+  Mapping Map;
+
+  MmapQueue(Mapping Map);
+  static Mapping mapFile(const char* Filename);
+  static std::shared_ptr<Page> createPage(Mapping Map, AddressType PageIndex);
+
+  bool readFill(AddressType Address) OVERRIDE;
+  std::shared_ptr<Page> getDumpedPage(AddressType Index) const OVERRIDE;
+};
+
+}  // end of namespace decode
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_STREAM_MMAPQUEUE_H_
@@ -21,11 +21,46 @@ namespace wasm {
 
 namespace decode {
 
-Page::Page(AddressType PageIndex)
-    : Index(PageIndex),
+namespace {
+
+// A page whose contents are allocated as part of the page.
+class OwnedPage FINAL : public Page {
+  OwnedPage() = delete;
+  OwnedPage(const OwnedPage&) = delete;
+  OwnedPage& operator=(const OwnedPage&) = delete;
+
+ public:
+  explicit OwnedPage(AddressType PageIndex) : Page(PageIndex, Storage) {}
+
+ private:
+  ByteType Storage[PageSize];
+};
+
+}  // end of anonymous namespace
+
+std::shared_ptr<Page> Page::create(AddressType PageIndex) {
+  return std::make_shared<OwnedPage>(PageIndex);
+}
+
+Page::Page(AddressType PageIndex, ByteType* Storage)
+    : Buffer(Storage), OwnsBuffer(true) {
+  reset(PageIndex);
+}
+
+Page::Page(AddressType PageIndex, ByteType* Data, AddressType Size)
+    : Buffer(Data),
+      OwnsBuffer(false),
+      Index(PageIndex),
       MinAddress(minAddressForPage(PageIndex)),
-      MaxAddress(minAddressForPage(PageIndex)) {
-  std::memset(&Buffer, 0, PageSize);
+      MaxAddress(minAddressForPage(PageIndex) + Size) {
+  assert(Size <= PageSize);
+}
+
+void Page::reset(AddressType PageIndex) {
+  assert(ownsBuffer());
+  Index = PageIndex;
+  MinAddress = MaxAddress = minAddressForPage(PageIndex);
+  std::memset(Buffer, 0, PageSize);
 }
 
 AddressType Page::spaceRemaining() const {
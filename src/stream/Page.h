@@ -62,7 +62,13 @@ class Page : public std::enable_shared_from_this<Page> {
   friend class Queue;
 
  public:
-  Page(AddressType PageIndex);
+  // Creates an empty page at PageIndex, whose contents are allocated with the
+  // page (i.e. using a single allocation).
+  static std::shared_ptr<Page> create(AddressType PageIndex);
+  // Creates a page holding the Size bytes at Data. The page doesn't own (and
+  // hence never frees) Data.
+  Page(AddressType PageIndex, ByteType* Data, AddressType Size);
+  bool ownsBuffer() const { return OwnsBuffer; }
   AddressType spaceRemaining() const;
   AddressType getPageIndex() const { return Index; }
   AddressType getMinAddress() const { return MinAddress; }
@@ -78,15 +84,23 @@ class Page : public std::enable_shared_from_this<Page> {
   // For debugging only.
   FILE* describe(FILE* File);
 
+ protected:
+  // Creates an empty page at PageIndex, owning the PageSize bytes at Storage.
+  Page(AddressType PageIndex, ByteType* Storage);
+
  private:
   // The contents of the page.
-  ByteType Buffer[PageSize];
+  ByteType* Buffer;
+  // True if the page owns (i.e. was allocated with) Buffer.
+  bool OwnsBuffer;
   // The page index of the page.
   AddressType Index;
   // Note: Buffer address range is [MinAddress, MaxAddress).
   AddressType MinAddress;
   AddressType MaxAddress;
-  std::shared_ptr<Page> Next;
+
+  // Reinitializes a (recycled) page to be an empty page at PageIndex.
+  void reset(AddressType PageIndex);
 };
 
 void describePage(FILE* File, Page* Pg);
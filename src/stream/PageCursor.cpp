@@ -27,7 +27,8 @@ PageCursor::PageCursor() : CurAddress(0) {
 }
 
 PageCursor::PageCursor(Queue* Que)
-    : CurPage(Que->FirstPage), CurAddress(Que->FirstPage->getMinAddress()) {
+    : CurPage(Que->getFirstPage()),
+      CurAddress(Que->getFirstPage()->getMinAddress()) {
   assert(CurPage);
 }
 
@@ -78,6 +78,7 @@ class PageCursor {
   void setMaxAddress(AddressType Address);
   bool isIndexAtEndOfPage() const;
   ByteType* getBufferPtr();
+  std::shared_ptr<Page> getPage() const { return CurPage; }
   // For debugging only.
   Page* getCurPage() const;
   FILE* describe(FILE* File, bool IncludePage = false);
@@ -44,6 +44,7 @@ Pipe::PipeBackedQueue::PipeBackedQueue(Pipe& MyPipe) : Queue(), MyPipe(MyPipe) {
 
 void Pipe::PipeBackedQueue::dumpFirstPage() {
   // TODO(karlschimpf) Optimize this!
+  Page* FirstPage = getFirstPage().get();
   for (AddressType i = 0, Size = FirstPage->getPageSize(); i < Size; ++i)
     MyPipe.WritePos->writeByte(FirstPage->getByte(i));
   Queue::dumpFirstPage();
@@ -21,19 +21,38 @@
 #include "stream/Page.h"
 #include "stream/PageCursor.h"
 
+#include <algorithm>
+
 namespace wasm {
 
 namespace decode {
 
-Queue::Queue()
+namespace {
+
+// Initial number of slots in the page ring (must be a power of two).
+constexpr size_t InitialPageRingSize = 8;
+
+// Maximum number of dumped pages kept for reuse.
+constexpr size_t MaxFreePages = 8;
+
+}  // end of anonymous namespace
+
+Queue::Queue() : Queue(Page::create(0)) {
+}
+
+Queue::Queue(std::shared_ptr<Page> FirstPage)
     : MinPeekSize(32),
       EofFrozen(false),
       Status(StatusValue::Good),
-      EofPtr(std::make_shared<BlockEob>()) {
+      EofPtr(std::make_shared<BlockEob>()),
+      PageRing(InitialPageRingSize),
+      FirstPageSlot(0),
+      NumPages(0),
+      PageLimit(0) {
   // Verify we have space for kErrorPageAddress and kUndefinedAddress.
   assert(PageSizeLog2 > 1);
-  LastPage = FirstPage = std::make_shared<Page>(0);
-  PageMap.push_back(LastPage);
+  assert(FirstPage->getPageIndex() == 0);
+  pushPage(std::move(FirstPage));
 }
 
 void Queue::close() {
@@ -41,7 +60,7 @@ void Queue::close() {
     AddressType EofAddress = LastPage->getMaxAddress();
     freezeEof(EofAddress);
   }
-  while (FirstPage)
+  while (getFirstPage())
     dumpFirstPage();
 }
 
@@ -58,7 +77,7 @@ AddressType Queue::fillSize() const {
 }
 
 AddressType Queue::actualSize() const {
-  return LastPage->getMaxAddress() - FirstPage->getMinAddress();
+  return LastPage->getMaxAddress() - getFirstPage()->getMinAddress();
 }
 
 AddressType Queue::getEofAddress() const {
@@ -67,16 +86,13 @@ AddressType Queue::getEofAddress() const {
 
 void Queue::describe(FILE* Out) {
   fprintf(Out, "**** Queue %p ***\n", (void*)this);
-  fprintf(Out, "First = %p, Last = %p\n", (void*)FirstPage.get(),
+  fprintf(Out, "First = %p, Last = %p\n", (void*)getFirstPage().get(),
           (void*)LastPage.get());
-  for (AddressType i = 0; i < PageMap.size(); ++i) {
-    std::shared_ptr<Page> Pg = PageMap[i].lock();
-    if (Pg)
-      Pg->describe(Out);
-    else
-      fprintf(Out, "Page[%" PRIuMAX "] = nullptr", uintmax_t(i));
+  for (size_t i = 0; i < NumPages; ++i) {
+    getPageSlot(i)->describe(Out);
     fprintf(Out, "\n");
   }
+  fprintf(Out, "Free pages = %" PRIuMAX "\n", uintmax_t(FreePages.size()));
   if (ErrorPage) {
     fputs("Error ", Out);
     ErrorPage->describe(Out);
@@ -92,40 +108,53 @@ void Queue::fail() {
 std::shared_ptr<Page> Queue::getErrorPage() {
   if (ErrorPage)
     return ErrorPage;
-  ErrorPage = std::make_shared<Page>(kErrorPageIndex);
+  ErrorPage = Page::create(kErrorPageIndex);
   return ErrorPage;
 }
 
 std::shared_ptr<Page> Queue::getReadPage(AddressType& Address) const {
   AddressType Index = PageIndex(Address);
-  if (Index >= PageMap.size())
+  if (Index >= PageLimit)
     return const_cast<Queue*>(this)->readFillToPage(Index, Address);
   return getDefinedPage(Index, Address);
 }
 
 std::shared_ptr<Page> Queue::getWritePage(AddressType& Address) const {
   AddressType Index = PageIndex(Address);
-  if (Index >= PageMap.size())
+  if (Index >= PageLimit)
     return const_cast<Queue*>(this)->writeFillToPage(Index, Address);
   return getDefinedPage(Index, Address);
 }
 
 std::shared_ptr<Page> Queue::getCachedPage(AddressType& Address) {
   AddressType Index = PageIndex(Address);
-  if (Index >= PageMap.size())
+  if (Index >= PageLimit)
     return failThenGetErrorPage(Address);
   return getDefinedPage(Index, Address);
 }
 
 std::shared_ptr<Page> Queue::getDefinedPage(AddressType Index,
                                             AddressType& Address) const {
-  assert(Index < PageMap.size());
-  std::shared_ptr<Page> Pg = PageMap[Index].lock();
-  if (Pg)
+  assert(Index < PageLimit);
+  if (NumPages > 0) {
+    AddressType FirstIndex = getFirstPage()->getPageIndex();
+    if (Index >= FirstIndex && Index - FirstIndex < NumPages)
+      return const_cast<Queue*>(this)->getPageSlot(Index - FirstIndex);
+  }
+  for (const std::weak_ptr<Page>& Held : HeldPages) {
+    std::shared_ptr<Page> Pg = Held.lock();
+    if (Pg && Pg->getPageIndex() == Index)
+      return Pg;
+  }
+  if (std::shared_ptr<Page> Pg = getDumpedPage(Index))
     return Pg;
   return const_cast<Queue*>(this)->failThenGetErrorPage(Address);
 }
 
+std::shared_ptr<Page> Queue::getDumpedPage(AddressType Index) const {
+  return nullptr;
+}
+
 std::shared_ptr<Page> Queue::failThenGetErrorPage(AddressType& Address) {
   fail();
   Address = kErrorPageAddress;
@@ -136,19 +165,73 @@ bool Queue::appendPage() {
   AddressType NewPageIndex = LastPage->getPageIndex() + 1;
   if (NewPageIndex > kMaxPageIndex)
     return false;
-  std::shared_ptr<Page> NewPage = std::make_shared<Page>(NewPageIndex);
-  PageMap.push_back(NewPage);
-  LastPage->Next = NewPage;
-  LastPage = NewPage;
+  std::shared_ptr<Page> NewPage;
+  if (FreePages.empty()) {
+    NewPage = Page::create(NewPageIndex);
+  } else {
+    NewPage = std::move(FreePages.back());
+    FreePages.pop_back();
+    NewPage->reset(NewPageIndex);
+  }
+  pushPage(std::move(NewPage));
   return true;
 }
 
+void Queue::pushPage(std::shared_ptr<Page> Pg) {
+  if (NumPages == PageRing.size()) {
+    // Ring is full, double its size (preserving page order).
+    PageVectorType NewRing(PageRing.size() * 2);
+    for (size_t i = 0; i < NumPages; ++i)
+      NewRing[i] = std::move(getPageSlot(i));
+    PageRing.swap(NewRing);
+    FirstPageSlot = 0;
+  }
+  PageLimit = std::max(PageLimit, Pg->getPageIndex() + 1);
+  getPageSlot(NumPages++) = Pg;
+  LastPage = std::move(Pg);
+}
+
 void Queue::dumpFirstPage() {
-  FirstPage = FirstPage->Next;
+  std::shared_ptr<Page> Pg = popFirstPage();
+  releasePage(Pg);
+}
+
+std::shared_ptr<Page> Queue::popFirstPage() {
+  assert(NumPages > 0);
+  std::shared_ptr<Page> Pg = std::move(getPageSlot(0));
+  FirstPageSlot = (FirstPageSlot + 1) & (PageRing.size() - 1);
+  --NumPages;
+  return Pg;
+}
+
+void Queue::releasePage(std::shared_ptr<Page>& Pg) {
+  // Only recycle the page if no cursor (or LastPage) still refers to it.
+  if (Pg.unique()) {
+    // A page held when dumped must no longer be found once recycled.
+    HeldPages.erase(std::remove_if(HeldPages.begin(), HeldPages.end(),
+                                   [&Pg](const std::weak_ptr<Page>& Held) {
+                                     return Held.expired() ||
+                                            Held.lock() == Pg;
+                                   }),
+                    HeldPages.end());
+    if (Pg->ownsBuffer() && FreePages.size() < MaxFreePages)
+      FreePages.push_back(std::move(Pg));
+    else
+      Pg.reset();
+    return;
+  }
+  // Still referenced, so keep it findable until released.
+  HeldPages.erase(std::remove_if(HeldPages.begin(), HeldPages.end(),
+                                 [](const std::weak_ptr<Page>& Held) {
+                                   return Held.expired();
+                                 }),
+                  HeldPages.end());
+  HeldPages.push_back(Pg);
+  Pg.reset();
 }
 
 void Queue::dumpPreviousPages() {
-  while (FirstPage.unique())
+  while (getFirstPage().unique())
     dumpFirstPage();
 }
 
@@ -253,8 +336,9 @@ void Queue::freezeEof(AddressType& Address) {
     // TODO(karlschimpf): If adding threads, make this update thread safe.
     // If any pages exist after Cursor, remove them.
     LastPage = Cursor.CurPage;
-    if (Cursor.CurPage->Next)
-      Cursor.CurPage->Next.reset();
+    while (NumPages > 0 && getPageSlot(NumPages - 1)->getPageIndex() >
+                               LastPage->getPageIndex())
+      getPageSlot(--NumPages).reset();
   }
 }
 
@@ -270,10 +354,11 @@ AddressType Queue::read(AddressType& Address,
   PageCursor Cursor(this);
   while (WantedSize) {
     AddressType FoundSize = readFromPage(Address, WantedSize, Cursor);
-    if (FoundSize == 0)
+    if (FoundSize == 0 || isBroken(Cursor))
       return Count;
     uint8_t* FromBuf = Cursor.getBufferPtr();
     memcpy(ToBuf, FromBuf, FoundSize);
+    ToBuf += FoundSize;
     Count += FoundSize;
     WantedSize -= FoundSize;
     Address += FoundSize;
@@ -287,10 +372,11 @@ bool Queue::write(AddressType& Address,
   PageCursor Cursor(this);
   while (WantedSize) {
     AddressType FoundSize = writeToPage(Address, WantedSize, Cursor);
-    if (FoundSize == 0)
+    if (FoundSize == 0 || isBroken(Cursor))
       return false;
     uint8_t* ToBuf = Cursor.getBufferPtr();
     memcpy(ToBuf, FromBuf, FoundSize);
+    FromBuf += FoundSize;
     Address += FoundSize;
     WantedSize -= FoundSize;
   }
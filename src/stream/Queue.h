@@ -20,6 +20,12 @@
 // This allows one to "backpatch" addresses, making sure that the pages are not
 // thrown away until all shared pointers have been released.
 //
+// Pages still in the queue are kept in a ring, indexed by page index relative
+// to the first page. Dumped pages that are no longer referenced by a cursor are
+// kept on a (small) free list, and are recycled when new pages are appended.
+// Dumped pages that are still referenced (e.g. pages being backpatched when the
+// queue is closed) can still be found by address, until released.
+//
 // Note: Virtual addresses are used, start at index 0, and correspond to a
 // buffer index as if the queue keeps all pages (i.e. doesn't shrink) until the
 // queue is destructed. Therefore, if a byte is written at address N, to read
@@ -141,7 +147,11 @@ class Queue : public std::enable_shared_from_this<Queue> {
   void describe(FILE* Out);
 
  protected:
-  typedef std::vector<std::weak_ptr<Page>> PageMapType;
+  typedef std::vector<std::shared_ptr<Page>> PageVectorType;
+
+  // Creates a queue whose first page is FirstPage (at page index 0).
+  explicit Queue(std::shared_ptr<Page> FirstPage);
+
   // Minimum peek size to maintain. That is, the minimal number of
   // bytes that the read can back up without freezing an address.
   AddressType MinPeekSize;
@@ -149,16 +159,37 @@ class Queue : public std::enable_shared_from_this<Queue> {
   bool EofFrozen;
   StatusValue Status;
   std::shared_ptr<BlockEob> EofPtr;
-  // First page still in queue.
-  std::shared_ptr<Page> FirstPage;
   // Page at the current end of buffer.
   std::shared_ptr<Page> LastPage;
   // Page to use if an error occurs.
   std::shared_ptr<Page> ErrorPage;
-  // Fast page lookup map (from page index)
-  PageMapType PageMap;
+  // Pages still in the queue, in page index order, starting at slot
+  // FirstPageSlot. The size of the ring is always a power of two.
+  PageVectorType PageRing;
+  size_t FirstPageSlot;
+  size_t NumPages;
+  // One past the largest page index ever added to the queue.
+  AddressType PageLimit;
+  // Dumped pages that can be reused by appendPage.
+  PageVectorType FreePages;
+  // Dumped pages that were still referenced when dumped.
+  std::vector<std::weak_ptr<Page>> HeldPages;
+
+  // Returns the first page still in queue, or nullptr if the queue is empty.
+  const std::shared_ptr<Page>& getFirstPage() const {
+    return PageRing[FirstPageSlot];
+  }
 
   bool appendPage();
+  // Adds Pg (the page following LastPage) to the end of the queue.
+  void pushPage(std::shared_ptr<Page> Pg);
+  // Removes the first page from the queue, without releasing it.
+  std::shared_ptr<Page> popFirstPage();
+  // Drops the reference Pg, recycling the page if no longer used.
+  void releasePage(std::shared_ptr<Page>& Pg);
+  std::shared_ptr<Page>& getPageSlot(size_t Offset) {
+    return PageRing[(FirstPageSlot + Offset) & (PageRing.size() - 1)];
+  }
 
   // Returns the page in the queue referred to Address, or nullptr if no
   // such page is in the byte queue.
@@ -174,9 +205,13 @@ class Queue : public std::enable_shared_from_this<Queue> {
                                         AddressType& Address);
 
   bool isValidPageAddress(AddressType Address) {
-    return PageIndex(Address) < PageMap.size();
+    return PageIndex(Address) < PageLimit;
   }
 
+  // Returns a page that can stand in for the (already dumped) page at Index,
+  // or nullptr if the contents of the page are no longer available.
+  virtual std::shared_ptr<Page> getDumpedPage(AddressType Index) const;
+
   // Dumps and deletes the first page.  Note: Dumping only occurs if a
   // Writer is provided (see class WriteBackedByteQueue below).
   virtual void dumpFirstPage();
@@ -35,6 +35,7 @@ WriteBackedQueue::~WriteBackedQueue() {
 }
 
 void WriteBackedQueue::dumpFirstPage() {
+  Page* FirstPage = getFirstPage().get();
   AddressType Address = 0;
   AddressType Size = FirstPage->getMaxAddress() - FirstPage->getMinAddress();
   if (!Writer->write(FirstPage->getByteAddress(Address), Size))
@@ -16,6 +16,9 @@
 
 #include "stream/WriteCursorBase.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace wasm {
 
 namespace decode {
@@ -48,6 +51,22 @@ void WriteCursorBase::writeByte(ByteType Byte) {
     writeFillWriteByte(Byte);
 }
 
+void WriteCursorBase::writeBytes(const ByteType* Buffer, size_t Size) {
+  while (Size > 0) {
+    if (CurAddress >= GuaranteedBeforeEob) {
+      // Let the fill move to the next page.
+      writeFillWriteByte(*Buffer++);
+      --Size;
+      continue;
+    }
+    size_t Count = std::min(Size, size_t(GuaranteedBeforeEob - CurAddress));
+    memcpy(getBufferPtr(), Buffer, Count);
+    CurAddress += Count;
+    Buffer += Count;
+    Size -= Count;
+  }
+}
+
 void WriteCursorBase::writeBit(ByteType Bit) {
   fail();
 }
@@ -38,6 +38,8 @@ class WriteCursorBase : public Cursor {
   // Writes next byte. Fails if at end of file.
   virtual void writeByte(ByteType Byte);
   virtual void writeBit(ByteType Bit);
+  // Writes the Size bytes in Buffer, copying whole page ranges at a time.
+  void writeBytes(const ByteType* Buffer, size_t Size);
 
   WriteCursorBase& operator=(const WriteCursorBase& C) {
     assign(C);
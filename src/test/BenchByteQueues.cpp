@@ -0,0 +1,120 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the per-byte cost of copying files through a read-backed queue
+// into a write-backed queue (i.e. the workload of TestByteQueues), for
+// several chunk sizes.
+
+#include "stream/ReadCursor.h"
+#include "stream/WriteCursor.h"
+#include "test/TestUtils.h"
+#include "utils/ArgsParse.h"
+
+#include <cstring>
+
+using namespace wasm;
+using namespace wasm::decode;
+using namespace wasm::test;
+using namespace wasm::utils;
+
+namespace {
+
+bool copy(const BufferType& Buffer, size_t ChunkSize, std::string& Result) {
+  std::shared_ptr<Queue> Input = makeBufferQueue(Buffer);
+  std::shared_ptr<Queue> Output = makeStringQueue(Result);
+  AddressType Address = 0;
+  ReadCursor ReadPos(Input);
+  WriteCursor WritePos(Output);
+  while (Address < Input->currentSize()) {
+    AddressType ReadBytesAvailable =
+        Input->readFromPage(Address, ChunkSize, ReadPos);
+    if (ReadBytesAvailable == 0) {
+      WritePos.setMaxAddress(Address);
+      break;
+    }
+    AddressType NextAddress = Address + ReadBytesAvailable;
+    while (ReadBytesAvailable) {
+      AddressType WriteBytesAvailable =
+          Output->writeToPage(Address, ReadBytesAvailable, WritePos);
+      if (WriteBytesAvailable == 0)
+        return false;
+      for (AddressType i = 0; i < WriteBytesAvailable; ++i)
+        WritePos.writeByte(ReadPos.readByte());
+      ReadBytesAvailable -= WriteBytesAvailable;
+    }
+    Address = NextAddress;
+  }
+  return Input->isGood() && Output->isGood();
+}
+
+// Returns the number of seconds needed to copy all buffers NumTries times, or
+// a negative value if a copy fails or doesn't match its input.
+double timeCopy(const std::vector<BufferType>& Buffers,
+                size_t ChunkSize,
+                size_t NumTries) {
+  return timeTries(NumTries, [&]() {
+    for (const BufferType& Buffer : Buffers) {
+      std::string Result;
+      if (!copy(Buffer, ChunkSize, Result) || Result.size() != Buffer.size() ||
+          memcmp(Buffer.data(), Result.data(), Buffer.size()) != 0)
+        return false;
+    }
+    return true;
+  });
+}
+
+}  // end of anonymous namespace
+
+int main(int Argc, const char* Argv[]) {
+  size_t NumTries = 10;
+  std::vector<charstring> InputFilenames;
+
+  {
+    ArgsParser Args("Benchmark copying files through byte queues");
+
+    BenchArgs InputArgs(Args, InputFilenames, NumTries,
+                        "Copy each file N times");
+
+    int ExitStatus;
+    if (!parseArgs(Args, Argc, Argv, ExitStatus))
+      return ExitStatus;
+  }
+
+  std::vector<BufferType> Buffers;
+  size_t NumBytes = 0;
+  if (!readFiles(InputFilenames, Buffers, NumBytes))
+    return exit_status(EXIT_FAILURE);
+  if (NumBytes == 0) {
+    fprintf(stderr, "No input to benchmark!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  NumBytes *= NumTries;
+
+  fprintf(stdout, "Copied %" PRIuMAX " bytes (%" PRIuMAX " files, %" PRIuMAX
+                  " tries)\n",
+          uintmax_t(NumBytes), uintmax_t(Buffers.size()), uintmax_t(NumTries));
+  for (size_t ChunkSize : {1, 13, 4096}) {
+    double Time = timeCopy(Buffers, ChunkSize, NumTries);
+    if (Time < 0) {
+      fprintf(stderr, "Failed to copy input (chunk size %" PRIuMAX ")!\n",
+              uintmax_t(ChunkSize));
+      return exit_status(EXIT_FAILURE);
+    }
+    fprintf(stdout, "  chunk %4" PRIuMAX ": %8.2f ns/byte\n",
+            uintmax_t(ChunkSize), Time * 1e9 / NumBytes);
+  }
+  return exit_status(EXIT_SUCCESS);
+}
@@ -0,0 +1,155 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the per-byte cost of decompressing (wasm0xd) files with the
+// interpreter, comparing fast (leaf) evaluation against pushing a call
+// frame for every evaluated node, the generic interpreter against one
+// specialized on its reader and writer (InterpreterT), and evaluating
+// define bodies node by node against running the threaded code they are
+// lowered to.
+
+#include "interp/ByteReader.h"
+#include "interp/ByteWriter.h"
+#include "interp/Interpreter.h"
+#include "test/TestUtils.h"
+#include "utils/ArgsParse.h"
+
+using namespace wasm;
+using namespace wasm::decode;
+using namespace wasm::filt;
+using namespace wasm::interp;
+using namespace wasm::test;
+using namespace wasm::utils;
+
+namespace {
+
+template <class InterpreterType>
+bool decompress(const BufferType& Buffer,
+                const InterpreterFlags& Flags,
+                std::string& Result) {
+  InterpreterType Decompressor(
+      std::make_shared<ByteReader>(makeBufferQueue(Buffer)),
+      std::make_shared<ByteWriter>(makeStringQueue(Result)), Flags);
+  addDefaultSelectors(Decompressor);
+  Decompressor.algorithmRead();
+  return !Decompressor.errorsFound();
+}
+
+// Returns the number of seconds needed to decompress all buffers NumTries
+// times (or a negative value if unable to decompress).
+template <class InterpreterType>
+double timeDecompress(std::vector<BufferType>& Buffers,
+                      const InterpreterFlags& Flags,
+                      size_t NumTries,
+                      std::vector<std::string>& Results) {
+  Results.clear();
+  Results.resize(Buffers.size());
+  return timeTries(NumTries, [&]() {
+    for (size_t i = 0; i < Buffers.size(); ++i) {
+      Results[i].clear();
+      if (!decompress<InterpreterType>(Buffers[i], Flags, Results[i]))
+        return false;
+    }
+    return true;
+  });
+}
+
+}  // end of anonymous namespace
+
+int main(int Argc, const char* Argv[]) {
+  size_t NumTries = 10;
+  std::vector<charstring> InputFilenames;
+
+  {
+    ArgsParser Args("Benchmark decompressing WASM binary files");
+
+    BenchArgs InputArgs(Args, InputFilenames, NumTries,
+                        "Decompress each file N times");
+
+    int ExitStatus;
+    if (!parseArgs(Args, Argc, Argv, ExitStatus))
+      return ExitStatus;
+  }
+
+  std::vector<BufferType> Buffers;
+  size_t NumBytes = 0;
+  if (!readFiles(InputFilenames, Buffers, NumBytes))
+    return exit_status(EXIT_FAILURE);
+  if (NumBytes == 0) {
+    fprintf(stderr, "No input to benchmark!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  NumBytes *= NumTries;
+
+  InterpreterFlags SlowFlags;
+  SlowFlags.FastEval = false;
+  SlowFlags.ThreadedEval = false;
+  std::vector<std::string> SlowResults;
+  double SlowTime =
+      timeDecompress<Interpreter>(Buffers, SlowFlags, NumTries, SlowResults);
+
+  InterpreterFlags FastFlags;
+  FastFlags.FastEval = true;
+  FastFlags.ThreadedEval = false;
+  std::vector<std::string> FastResults;
+  double FastTime =
+      timeDecompress<Interpreter>(Buffers, FastFlags, NumTries, FastResults);
+
+  std::vector<std::string> TypedResults;
+  double TypedTime = timeDecompress<InterpreterT<ByteReader, ByteWriter>>(
+      Buffers, FastFlags, NumTries, TypedResults);
+
+  InterpreterFlags ThreadedFlags;
+  ThreadedFlags.FastEval = true;
+  ThreadedFlags.ThreadedEval = true;
+  std::vector<std::string> ThreadedResults;
+  double ThreadedTime = timeDecompress<InterpreterT<ByteReader, ByteWriter>>(
+      Buffers, ThreadedFlags, NumTries, ThreadedResults);
+
+  if (SlowTime < 0 || FastTime < 0 || TypedTime < 0 || ThreadedTime < 0) {
+    fprintf(stderr, "Failed to decompress input!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  if (SlowResults != FastResults) {
+    fprintf(stderr, "Fast evaluation generated different output!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  if (TypedResults != FastResults) {
+    fprintf(stderr, "Specialized interpreter generated different output!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  if (ThreadedResults != FastResults) {
+    fprintf(stderr, "Threaded code generated different output!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  fprintf(stdout, "Decompressed %" PRIuMAX " bytes (%" PRIuMAX
+                  " files, %" PRIuMAX " tries)\n",
+          uintmax_t(NumBytes), uintmax_t(Buffers.size()), uintmax_t(NumTries));
+  fprintf(stdout, "  call frames: %8.2f ns/byte\n", SlowTime * 1e9 / NumBytes);
+  fprintf(stdout, "  fast eval:   %8.2f ns/byte\n", FastTime * 1e9 / NumBytes);
+  fprintf(stdout, "  speedup:     %8.2fx\n", SlowTime / FastTime);
+  fprintf(stdout, "  specialized: %8.2f ns/byte\n",
+          TypedTime * 1e9 / NumBytes);
+  fprintf(stdout, "  speedup:     %8.2fx (over fast eval)\n",
+          FastTime / TypedTime);
+  fprintf(stdout, "  threaded:    %8.2f ns/byte\n",
+          ThreadedTime * 1e9 / NumBytes);
+  fprintf(stdout, "  speedup:     %8.2fx (over specialized)\n",
+          TypedTime / ThreadedTime);
+  fprintf(stdout, "  speedup:     %8.2fx (over call frames)\n",
+          SlowTime / ThreadedTime);
+  return exit_status(EXIT_SUCCESS);
+}
@@ -0,0 +1,218 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the memory used by the integer streams of (wasm0xd) files, the
+// cost of reading them (into an IntWriter) as done by
+// IntCompressor::readInput(), and the cost of replaying them (with an
+// IntReader) into a count writer, as done by
+// IntCompressor::compressUpToSize(). Reads and replays are timed with both
+// the generic and the specialized (InterpreterT and IntInterpreterT)
+// interpreters.
+
+#include "intcomp/CountWriter.h"
+#include "interp/ByteReader.h"
+#include "interp/Interpreter.h"
+#include "interp/IntInterpreter-templates.h"
+#include "interp/IntReader.h"
+#include "interp/IntWriter.h"
+#include "test/TestUtils.h"
+#include "utils/ArgsParse.h"
+
+using namespace wasm;
+using namespace wasm::decode;
+using namespace wasm::filt;
+using namespace wasm::intcomp;
+using namespace wasm::interp;
+using namespace wasm::test;
+using namespace wasm::utils;
+
+namespace {
+
+template <class InterpreterType>
+std::shared_ptr<IntStream> readIntStream(const BufferType& Buffer) {
+  auto Contents = std::make_shared<IntStream>();
+  InterpreterFlags Flags;
+  InterpreterType Reader(std::make_shared<ByteReader>(makeBufferQueue(Buffer)),
+                         std::make_shared<IntWriter>(Contents), Flags,
+                         getAlgwasm0xdSymtab());
+  Reader.algorithmRead();
+  if (!Reader.isFinished() || !Reader.isSuccessful())
+    Contents.reset();
+  return Contents;
+}
+
+// Returns the number of seconds needed to read all buffers into integer
+// streams NumTries times (or a negative value if unable to read).
+template <class InterpreterType>
+double timeRead(std::vector<BufferType>& Buffers, size_t NumTries) {
+  return timeTries(NumTries, [&]() {
+    for (BufferType& Buffer : Buffers) {
+      if (!readIntStream<InterpreterType>(Buffer))
+        return false;
+    }
+    return true;
+  });
+}
+
+// Returns the number of seconds needed to count the integers of all streams
+// NumTries times (or a negative value if unable to replay).
+template <class InterpreterType>
+double timeReplay(std::vector<std::shared_ptr<IntStream>>& Streams,
+                  size_t NumTries) {
+  InterpreterFlags Flags;
+  return timeTries(NumTries, [&]() {
+    for (std::shared_ptr<IntStream>& Contents : Streams) {
+      auto Writer = std::make_shared<CountWriter>(
+          std::make_shared<RootCountNode>());
+      Writer->setUpToSize(1);
+      InterpreterType Reader(std::make_shared<IntReader>(Contents), Writer,
+                             Flags, getAlgwasm0xdSymtab());
+      Reader.structuralRead();
+      if (Reader.errorsFound())
+        return false;
+    }
+    return true;
+  });
+}
+
+// Returns the number of seconds needed to decode the values of all streams
+// NumTries times. Sum is updated so that the reads can't be removed.
+double timeValues(std::vector<std::shared_ptr<IntStream>>& Streams,
+                  size_t NumTries,
+                  IntType& Sum) {
+  return timeTries(NumTries, [&]() {
+    for (std::shared_ptr<IntStream>& Contents : Streams) {
+      IntStream::ValueReader Values(*Contents);
+      for (size_t i = 0, Size = Contents->size(); i < Size; ++i)
+        Sum += Values.read();
+    }
+    return true;
+  });
+}
+
+// Same as timeValues, but on (unpacked) copies of the values.
+double timeVectors(std::vector<IntStream::IntVector>& Vectors,
+                   size_t NumTries,
+                   IntType& Sum) {
+  return timeTries(NumTries, [&]() {
+    for (IntStream::IntVector& Values : Vectors) {
+      for (IntType Value : Values)
+        Sum += Value;
+    }
+    return true;
+  });
+}
+
+}  // end of anonymous namespace
+
+int main(int Argc, const char* Argv[]) {
+  size_t NumTries = 10;
+  std::vector<charstring> InputFilenames;
+
+  {
+    ArgsParser Args(
+        "Benchmark memory use and replay of integer streams of WASM files");
+
+    BenchArgs InputArgs(Args, InputFilenames, NumTries,
+                        "Replay each integer stream N times");
+
+    int ExitStatus;
+    if (!parseArgs(Args, Argc, Argv, ExitStatus))
+      return ExitStatus;
+  }
+
+  std::vector<BufferType> Buffers;
+  std::vector<std::shared_ptr<IntStream>> Streams;
+  std::vector<IntStream::IntVector> Vectors;
+  size_t NumBytes = 0;
+  size_t NumValues = 0;
+  size_t NumIntegers = 0;
+  size_t NumBlocks = 0;
+  size_t ByteSize = 0;
+  if (!readFiles(InputFilenames, Buffers, NumBytes))
+    return exit_status(EXIT_FAILURE);
+  for (size_t i = 0; i < Buffers.size(); ++i) {
+    std::shared_ptr<IntStream> Contents =
+        readIntStream<Interpreter>(Buffers[i]);
+    if (!Contents) {
+      fprintf(stderr, "Unable to build integer stream: %s\n",
+              InputFilenames[i]);
+      return exit_status(EXIT_FAILURE);
+    }
+    Streams.push_back(Contents);
+    Vectors.emplace_back();
+    IntStream::ValueReader Values(*Contents);
+    for (size_t j = 0, Size = Contents->size(); j < Size; ++j)
+      Vectors.back().push_back(Values.read());
+    NumValues += Contents->size();
+    NumIntegers += Contents->getNumIntegers();
+    NumBlocks += (Contents->getNumIntegers() - Contents->size()) / 2;
+    ByteSize += Contents->getByteSize();
+  }
+  if (NumIntegers == 0) {
+    fprintf(stderr, "No input to benchmark!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+
+  double ReadTime = timeRead<Interpreter>(Buffers, NumTries);
+  double TypedReadTime =
+      timeRead<InterpreterT<ByteReader, IntWriter>>(Buffers, NumTries);
+  if (ReadTime < 0 || TypedReadTime < 0) {
+    fprintf(stderr, "Failed to read integer streams!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  double ReplayTime = timeReplay<IntInterpreter>(Streams, NumTries);
+  double TypedReplayTime =
+      timeReplay<IntInterpreterT<CountWriter>>(Streams, NumTries);
+  if (ReplayTime < 0 || TypedReplayTime < 0) {
+    fprintf(stderr, "Failed to replay integer streams!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  IntType PackedSum = 0;
+  double PackedTime = timeValues(Streams, NumTries, PackedSum);
+  IntType UnpackedSum = 0;
+  double UnpackedTime = timeVectors(Vectors, NumTries, UnpackedSum);
+  if (PackedSum != UnpackedSum) {
+    fprintf(stderr, "Packed values differ from unpacked values!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+
+  // Unpacked size assumes 8-byte values, and (begin, end, parent) blocks.
+  size_t UnpackedSize =
+      NumValues * sizeof(IntType) + NumBlocks * sizeof(IntStream::Block);
+  fprintf(stdout, "Integer streams: %" PRIuMAX " values, %" PRIuMAX
+                  " blocks (%" PRIuMAX " files, %" PRIuMAX " tries)\n",
+          uintmax_t(NumValues), uintmax_t(NumBlocks),
+          uintmax_t(Streams.size()), uintmax_t(NumTries));
+  fprintf(stdout, "  packed size:   %10" PRIuMAX " bytes\n",
+          uintmax_t(ByteSize));
+  fprintf(stdout, "  unpacked size: %10" PRIuMAX " bytes\n",
+          uintmax_t(UnpackedSize));
+  size_t NumReads = NumTries * NumValues;
+  fprintf(stdout, "  read:          %8.2f ns/byte\n",
+          ReadTime * 1e9 / (NumTries * NumBytes));
+  fprintf(stdout, "  read (typed):  %8.2f ns/byte\n",
+          TypedReadTime * 1e9 / (NumTries * NumBytes));
+  fprintf(stdout, "  replay:        %8.2f ns/integer\n",
+          ReplayTime * 1e9 / (NumTries * NumIntegers));
+  fprintf(stdout, "  replay (typed):%8.2f ns/integer\n",
+          TypedReplayTime * 1e9 / (NumTries * NumIntegers));
+  fprintf(stdout, "  packed read:   %8.2f ns/value\n",
+          PackedTime * 1e9 / NumReads);
+  fprintf(stdout, "  unpacked read: %8.2f ns/value\n",
+          UnpackedTime * 1e9 / NumReads);
+  return exit_status(EXIT_SUCCESS);
+}
@@ -0,0 +1,157 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of decompressing (Huffman encoded) compressed WASM files,
+// comparing decoding binary encodings with lookup tables against walking the
+// encoding a bit at a time.
+
+#include "intcomp/IntCompress.h"
+#include "interp/ByteReader.h"
+#include "interp/ByteWriter.h"
+#include "interp/Interpreter.h"
+#include "test/TestUtils.h"
+#include "utils/ArgsParse.h"
+
+using namespace wasm;
+using namespace wasm::decode;
+using namespace wasm::filt;
+using namespace wasm::intcomp;
+using namespace wasm::interp;
+using namespace wasm::test;
+using namespace wasm::utils;
+
+namespace {
+
+bool compress(const BufferType& Buffer, BufferType& Result) {
+  std::string Output;
+  CompressionFlags Flags;
+  Flags.CountCutoff = 2;
+  Flags.WeightCutoff = 5;
+  Flags.UseHuffmanEncoding = true;
+  {
+    // Note: Output is flushed when the compressor is destroyed.
+    IntCompressor Compressor(makeBufferQueue(Buffer), makeStringQueue(Output),
+                             getAlgwasm0xdSymtab(), Flags);
+    Compressor.compress();
+    if (Compressor.errorsFound())
+      return false;
+  }
+  Result.assign(Output.begin(), Output.end());
+  return true;
+}
+
+bool decompress(const BufferType& Buffer,
+                bool UseDecodeTables,
+                std::string& Result) {
+  auto Output = std::make_shared<ByteWriter>(makeStringQueue(Result));
+  Output->setMinimizeBlockSize(true);
+  auto Reader = std::make_shared<ByteReader>(makeBufferQueue(Buffer));
+  Reader->setUseBinaryDecodeTables(UseDecodeTables);
+  InterpreterFlags Flags;
+  Interpreter Decompressor(Reader, Output, Flags);
+  addDefaultSelectors(Decompressor);
+  Decompressor.algorithmRead();
+  return !Decompressor.errorsFound();
+}
+
+// Returns the number of seconds needed to decompress all buffers NumTries
+// times (or a negative value if unable to decompress).
+double timeDecompress(std::vector<BufferType>& Buffers,
+                      bool UseDecodeTables,
+                      size_t NumTries,
+                      std::vector<std::string>& Results) {
+  Results.clear();
+  Results.resize(Buffers.size());
+  return timeTries(NumTries, [&]() {
+    for (size_t i = 0; i < Buffers.size(); ++i) {
+      Results[i].clear();
+      if (!decompress(Buffers[i], UseDecodeTables, Results[i]))
+        return false;
+    }
+    return true;
+  });
+}
+
+}  // end of anonymous namespace
+
+int main(int Argc, const char* Argv[]) {
+  size_t NumTries = 10;
+  std::vector<charstring> InputFilenames;
+
+  {
+    ArgsParser Args(
+        "Benchmark decoding Huffman encoded abbreviations in compressed WASM "
+        "files");
+
+    BenchArgs InputArgs(Args, InputFilenames, NumTries,
+                        "Decompress each file N times",
+                        "Add (uncompressed) file INPUT to the set of "
+                        "benchmarked files");
+
+    int ExitStatus;
+    if (!parseArgs(Args, Argc, Argv, ExitStatus))
+      return ExitStatus;
+  }
+
+  std::vector<BufferType> Originals;
+  std::vector<BufferType> Buffers;
+  size_t NumBytes = 0;
+  size_t NumOriginalBytes = 0;
+  if (!readFiles(InputFilenames, Originals, NumOriginalBytes))
+    return exit_status(EXIT_FAILURE);
+  for (size_t i = 0; i < Originals.size(); ++i) {
+    Buffers.emplace_back();
+    if (!compress(Originals[i], Buffers.back())) {
+      fprintf(stderr, "Unable to compress: %s\n", InputFilenames[i]);
+      return exit_status(EXIT_FAILURE);
+    }
+    NumBytes += Buffers.back().size();
+  }
+  if (NumBytes == 0) {
+    fprintf(stderr, "No input to benchmark!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  NumBytes *= NumTries;
+
+  std::vector<std::string> WalkResults;
+  double WalkTime = timeDecompress(Buffers, false, NumTries, WalkResults);
+
+  std::vector<std::string> TableResults;
+  double TableTime = timeDecompress(Buffers, true, NumTries, TableResults);
+
+  if (WalkTime < 0 || TableTime < 0) {
+    fprintf(stderr, "Failed to decompress input!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < Buffers.size(); ++i) {
+    const BufferType& Original = Originals[i];
+    if (WalkResults[i] != TableResults[i] ||
+        TableResults[i] != std::string(Original.begin(), Original.end())) {
+      fprintf(stderr, "Decompression doesn't match original: %s\n",
+              InputFilenames[i]);
+      return exit_status(EXIT_FAILURE);
+    }
+  }
+  fprintf(stdout, "Decompressed %" PRIuMAX " compressed bytes (%" PRIuMAX
+                  " files, %" PRIuMAX " tries)\n",
+          uintmax_t(NumBytes), uintmax_t(Buffers.size()), uintmax_t(NumTries));
+  fprintf(stdout, "  bit walk:    %8.2f ns/byte\n",
+          WalkTime * 1e9 / NumBytes);
+  fprintf(stdout, "  tables:      %8.2f ns/byte\n",
+          TableTime * 1e9 / NumBytes);
+  fprintf(stdout, "  speedup:     %8.2fx\n", WalkTime / TableTime);
+  return exit_status(EXIT_SUCCESS);
+}
@@ -0,0 +1,106 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the time to first output when decompressing a (small) file with the
+// C API. The first decompressor also builds the (shared) default algorithms,
+// while the following ones reuse them.
+
+#include "interp/Decompress.h"
+#include "test/TestUtils.h"
+#include "utils/ArgsParse.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace wasm;
+using namespace wasm::decode;
+using namespace wasm::test;
+using namespace wasm::utils;
+
+namespace {
+
+// Returns the number of seconds needed to create a decompressor and get its
+// first output, or a negative value if no output was generated.
+double timeFirstOutput(const BufferType& Input) {
+  auto Start = std::chrono::steady_clock::now();
+  void* Decomp = create_decompressor();
+  int32_t Size = int32_t(Input.size());
+  uint8_t* Buffer = get_decompressor_buffer(Decomp, Size);
+  std::copy(Input.begin(), Input.end(), Buffer);
+  int32_t Result = resume_decompression(Decomp, Size);
+  while (Result == 0)
+    Result = resume_decompression(Decomp, 0);
+  if (Result > 0 && !fetch_decompressor_output(Decomp, 1))
+    Result = DECOMPRESSOR_ERROR;
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  destroy_decompressor(Decomp);
+  return Result > 0 ? Elapsed.count() : -1.0;
+}
+
+}  // end of anonymous namespace
+
+int main(int Argc, const char* Argv[]) {
+  size_t NumTries = 100;
+  charstring InputFilename = nullptr;
+
+  {
+    ArgsParser Args("Benchmark time to first output when decompressing");
+
+    ArgsParser::Required<charstring> InputFilenameFlag(InputFilename);
+    Args.add(InputFilenameFlag.setOptionName("INPUT")
+                 .setDescription("File to decompress"));
+
+    ArgsParser::Optional<size_t> NumTriesFlag(NumTries);
+    Args.add(
+        NumTriesFlag.setLongName("tries").setOptionName("N").setDescription(
+            "Decompress the file N times, after the first time"));
+
+    int ExitStatus;
+    if (!parseArgs(Args, Argc, Argv, ExitStatus))
+      return ExitStatus;
+  }
+
+  BufferType Input;
+  if (!readFile(InputFilename, Input) || Input.empty()) {
+    fprintf(stderr, "Unable to read: %s\n", InputFilename);
+    return exit_status(EXIT_FAILURE);
+  }
+
+  double FirstTime = timeFirstOutput(Input);
+  double SharedTime = 0;
+  for (size_t i = 0; i < NumTries && FirstTime >= 0; ++i) {
+    double Time = timeFirstOutput(Input);
+    if (Time < 0) {
+      FirstTime = Time;
+      break;
+    }
+    SharedTime += Time;
+  }
+  if (FirstTime < 0) {
+    fprintf(stderr, "Unable to decompress: %s\n", InputFilename);
+    return exit_status(EXIT_FAILURE);
+  }
+
+  fprintf(stdout, "Time to first output: %s (%" PRIuMAX " bytes, %" PRIuMAX
+                  " tries)\n",
+          InputFilename, uintmax_t(Input.size()), uintmax_t(NumTries));
+  fprintf(stdout, "  first (builds algorithms): %10.1f us\n", FirstTime * 1e6);
+  if (NumTries > 0)
+    fprintf(stdout, "  shared algorithms:         %10.1f us\n",
+            SharedTime * 1e6 / NumTries);
+  return exit_status(EXIT_SUCCESS);
+}
@@ -17,7 +17,10 @@
 
 // Tests reading/writing using byte queues.
 
+#include "stream/ArrayReader.h"
+#include "stream/BitReadCursor.h"
 #include "stream/FileReader.h"
+#include "stream/FileWriteQueue.h"
 #include "stream/FileWriter.h"
 #include "stream/ReadBackedQueue.h"
 #include "stream/ReadCursor.h"
@@ -28,6 +31,7 @@
 #include <unistd.h>
 
 #include <iostream>
+#include <vector>
 
 using namespace wasm::decode;
 
@@ -44,26 +48,96 @@ std::shared_ptr<RawStream> getOutput() {
   return std::make_shared<FileWriter>(OutputFilename);
 }
 
+// Writes a few pages to a file write queue, and then checks that writing to
+// the (dumped) first page fails, whether or not the page has been written to
+// the file yet.
+bool checkWriteDumped() {
+  static constexpr AddressType NumPages = 3;
+  std::vector<uint8_t> Buffer(PageSize, 'x');
+  for (AddressType HighWaterMark : {PageSize, 2 * NumPages * PageSize}) {
+    auto Output = std::make_shared<FileWriteQueue>(OutputFilename);
+    Output->setHighWaterMark(HighWaterMark);
+    AddressType Address = 0;
+    for (AddressType i = 0; i < NumPages; ++i) {
+      if (!Output->write(Address, Buffer.data(), PageSize)) {
+        fprintf(stderr, "Unable to write page %d\n", int(i));
+        return false;
+      }
+    }
+    Address = 0;
+    if (Output->write(Address, Buffer.data(), 1) || Output->isGood()) {
+      fprintf(stderr, "Able to write dumped address 0 (high water mark %d)\n",
+              int(HighWaterMark));
+      return false;
+    }
+    Output->flush();
+  }
+  return true;
+}
+
+// Reads a page boundary after buffering the last bytes of the first page in a
+// bit read cursor, checking for eob in between, and then checks that the
+// buffered bytes are handed back to the right page.
+bool checkBitsAtPageEnd() {
+  static constexpr AddressType NumBufferedBytes = 4;
+  std::vector<uint8_t> Buffer(2 * PageSize);
+  for (size_t i = 0; i < Buffer.size(); ++i)
+    Buffer[i] = uint8_t(i % 251);
+  auto Input = std::make_shared<ReadBackedQueue>(
+      std::make_shared<ArrayReader>(Buffer.data(), Buffer.size()));
+  BitReadCursor ReadPos(StreamType::Byte, Input);
+  size_t Address = 0;
+  for (; Address < PageSize - NumBufferedBytes; ++Address)
+    ReadPos.readByte();
+  BitReadCursor::WordType Bits;
+  if (!ReadPos.peekBits(CHAR_BIT, Bits) || ReadPos.atEob()) {
+    fprintf(stderr, "Unable to buffer the end of page 0\n");
+    return false;
+  }
+  for (; Address < Buffer.size(); ++Address) {
+    const ByteType* Byte = ReadPos.peekBytes(1);
+    uint8_t Value = Byte ? *Byte : ReadPos.readByte();
+    if (Byte)
+      ReadPos.consumeBits(CHAR_BIT);
+    if (Value != Buffer[Address]) {
+      fprintf(stderr, "Read %d at address %d, expected %d\n", int(Value),
+              int(Address), int(Buffer[Address]));
+      return false;
+    }
+  }
+  return true;
+}
+
 void usage(char* AppName) {
   fprintf(stderr, "usage: %s [options]\n", AppName);
   fprintf(stderr, "\n");
   fprintf(stderr, "Options:\n");
+  fprintf(stderr,
+          "  --bits-at-page-end\tCheck bit reads across a page boundary\n");
   fprintf(stderr, "  -c N\t\tRead N bytes (i.e. chunksize) at a time\n");
   fprintf(stderr, "  --expect-fail\tSucceed on failure/fail on success\n");
   fprintf(stderr, "  -h\t\tShow usage\n");
   fprintf(stderr, "  -i NAME\tRead from input file NAME ('-' implies stdin)\n");
   fprintf(stderr,
           "  -o NAME\tWrite to output file NAME ('-' implies stdout)\n");
+  fprintf(stderr,
+          "  --write-dumped\tCheck that dumped output can't be rewritten\n");
 }
 
 }  // end of anonymous namespace
 
 int main(int Argc, char* Argv[]) {
   int BufSize = 1;
+  bool WriteDumped = false;
+  bool BitsAtPageEnd = false;
   static constexpr int MaxBufSize = 4096;
   for (int i = 1; i < Argc; ++i) {
     if (Argv[i] == std::string("--expect-fail"))
       ExpectExitFail = true;
+    else if (Argv[i] == std::string("--write-dumped"))
+      WriteDumped = true;
+    else if (Argv[i] == std::string("--bits-at-page-end"))
+      BitsAtPageEnd = true;
     else if (Argv[i] == std::string("-i")) {
       if (++i >= Argc) {
         fprintf(stderr, "No file specified after -i option\n");
@@ -106,6 +180,10 @@ int main(int Argc, char* Argv[]) {
       return exit_status(EXIT_FAILURE);
     }
   }
+  if (WriteDumped)
+    return exit_status(checkWriteDumped() ? EXIT_SUCCESS : EXIT_FAILURE);
+  if (BitsAtPageEnd)
+    return exit_status(checkBitsAtPageEnd() ? EXIT_SUCCESS : EXIT_FAILURE);
   auto Input = std::make_shared<ReadBackedQueue>(getInput());
   auto Output = std::make_shared<WriteBackedQueue>(getOutput());
   // uint8_t Buffer[MaxBufSize];
@@ -0,0 +1,167 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks that the decoder generated (by cast2casm --decoder) for wasm0xd
+// produces the same output as the interpreter. Optionally reports the time
+// spent by each.
+
+#include "algorithms/wasm0xd-decoder.h"
+#include "interp/ByteReader.h"
+#include "interp/ByteWriter.h"
+#include "interp/Interpreter.h"
+#include "stream/BitReadCursor.h"
+#include "stream/BitWriteCursor.h"
+#include "test/TestUtils.h"
+#include "utils/ArgsParse.h"
+
+using namespace wasm;
+using namespace wasm::decode;
+using namespace wasm::filt;
+using namespace wasm::interp;
+using namespace wasm::test;
+using namespace wasm::utils;
+
+namespace {
+
+bool interpret(const BufferType& Buffer,
+               bool MinimizeBlockSize,
+               std::string& Result) {
+  auto Output = std::make_shared<ByteWriter>(makeStringQueue(Result));
+  Output->setMinimizeBlockSize(MinimizeBlockSize);
+  InterpreterFlags Flags;
+  Interpreter Decompressor(
+      std::make_shared<ByteReader>(makeBufferQueue(Buffer)), Output, Flags);
+  addDefaultSelectors(Decompressor);
+  Decompressor.algorithmRead();
+  return !Decompressor.errorsFound();
+}
+
+bool runDecoder(const BufferType& Buffer,
+                bool MinimizeBlockSize,
+                std::string& Result) {
+  BitReadCursor ReadPos(StreamType::Byte, makeBufferQueue(Buffer));
+  BitWriteCursor WritePos(StreamType::Byte, makeStringQueue(Result));
+  return decodeAlgwasm0xd(ReadPos, WritePos, MinimizeBlockSize);
+}
+
+typedef bool (*DecodeFcn)(const BufferType&, bool, std::string&);
+
+// Returns the number of seconds needed to decode all buffers NumTries times
+// (or a negative value if unable to decode).
+double timeDecode(DecodeFcn Fcn,
+                  std::vector<BufferType>& Buffers,
+                  bool MinimizeBlockSize,
+                  size_t NumTries,
+                  std::vector<std::string>& Results) {
+  Results.clear();
+  Results.resize(Buffers.size());
+  return timeTries(NumTries, [&]() {
+    for (size_t i = 0; i < Buffers.size(); ++i) {
+      Results[i].clear();
+      if (!Fcn(Buffers[i], MinimizeBlockSize, Results[i]))
+        return false;
+    }
+    return true;
+  });
+}
+
+}  // end of anonymous namespace
+
+int main(int Argc, const char* Argv[]) {
+  size_t NumTries = 1;
+  bool MinimizeBlockSize = true;
+  bool ShowTimes = false;
+  std::vector<charstring> InputFilenames;
+
+  {
+    ArgsParser Args(
+        "Compare generated wasm0xd decoder against the interpreter");
+
+    ArgsParser::RepeatableVector<charstring> InputFilenamesFlag(
+        InputFilenames);
+    Args.add(InputFilenamesFlag.setShortName('i')
+                 .setOptionName("INPUT")
+                 .setDescription("Add file INPUT to the set of decoded files"));
+
+    ArgsParser::Toggle MinimizeBlockFlag(MinimizeBlockSize);
+    Args.add(MinimizeBlockFlag.setDefault(true)
+                 .setShortName('m')
+                 .setLongName("minimize")
+                 .setDescription(
+                     "Toggle minimizing decompressed size (rather than "
+                     "canonical size)"));
+
+    ArgsParser::Optional<size_t> NumTriesFlag(NumTries);
+    Args.add(
+        NumTriesFlag.setLongName("tries").setOptionName("N").setDescription(
+            "Decode each file N times"));
+
+    ArgsParser::Optional<bool> ShowTimesFlag(ShowTimes);
+    Args.add(ShowTimesFlag.setLongName("time").setDescription(
+        "Show time spent by the interpreter and the generated decoder"));
+
+    int ExitStatus;
+    if (!parseArgs(Args, Argc, Argv, ExitStatus))
+      return ExitStatus;
+  }
+
+  std::vector<BufferType> Buffers;
+  size_t NumBytes = 0;
+  if (!readFiles(InputFilenames, Buffers, NumBytes))
+    return exit_status(EXIT_FAILURE);
+  if (NumBytes == 0) {
+    fprintf(stderr, "No input to decode!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+  NumBytes *= NumTries;
+
+  std::vector<std::string> InterpResults;
+  double InterpTime = timeDecode(interpret, Buffers, MinimizeBlockSize,
+                                 NumTries, InterpResults);
+  if (InterpTime < 0) {
+    fprintf(stderr, "Interpreter failed to decompress input!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+
+  std::vector<std::string> DecoderResults;
+  double DecoderTime = timeDecode(runDecoder, Buffers, MinimizeBlockSize,
+                                  NumTries, DecoderResults);
+  if (DecoderTime < 0) {
+    fprintf(stderr, "Generated decoder failed to decompress input!\n");
+    return exit_status(EXIT_FAILURE);
+  }
+
+  for (size_t i = 0; i < Buffers.size(); ++i) {
+    if (InterpResults[i] != DecoderResults[i]) {
+      fprintf(stderr, "Generated decoder differs from interpreter: %s\n",
+              InputFilenames[i]);
+      return exit_status(EXIT_FAILURE);
+    }
+  }
+
+  if (ShowTimes) {
+    fprintf(stdout, "Decoded %" PRIuMAX " bytes (%" PRIuMAX " files, %" PRIuMAX
+                    " tries)\n",
+            uintmax_t(NumBytes), uintmax_t(Buffers.size()),
+            uintmax_t(NumTries));
+    fprintf(stdout, "  interpreter: %8.2f ns/byte\n",
+            InterpTime * 1e9 / NumBytes);
+    fprintf(stdout, "  decoder:     %8.2f ns/byte\n",
+            DecoderTime * 1e9 / NumBytes);
+    fprintf(stdout, "  speedup:     %8.2fx\n", InterpTime / DecoderTime);
+  }
+  return exit_status(EXIT_SUCCESS);
+}
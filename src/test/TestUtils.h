@@ -0,0 +1,164 @@
+// -*- C++ -*- */
+//
+// Copyright 2016 WebAssembly Community Group participants
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Defines helpers shared by the (file based) tests and benchmarks.
+
+#ifndef DECOMPRESSOR_SRC_TEST_TESTUTILS_H
+#define DECOMPRESSOR_SRC_TEST_TESTUTILS_H
+
+#include "algorithms/casm0x0.h"
+#include "algorithms/cism0x0.h"
+#include "algorithms/wasm0xd.h"
+#include "interp/DecompressSelector.h"
+#include "interp/Interpreter.h"
+#include "stream/ArrayReader.h"
+#include "stream/FileReader.h"
+#include "stream/ReadBackedQueue.h"
+#include "stream/StringWriter.h"
+#include "stream/WriteBackedQueue.h"
+#include "utils/ArgsParse.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+namespace test {
+
+typedef std::vector<uint8_t> BufferType;
+
+// Appends the contents of file Filename to Buffer. Returns true if
+// successful.
+inline bool readFile(const char* Filename, BufferType& Buffer) {
+  decode::FileReader Reader(Filename);
+  if (Reader.hasErrors())
+    return false;
+  uint8_t Bytes[4096];
+  while (decode::AddressType Count = Reader.read(Bytes, sizeof(Bytes)))
+    Buffer.insert(Buffer.end(), Bytes, Bytes + Count);
+  return !Reader.hasErrors();
+}
+
+// Appends the contents of each file in Filenames to Buffers, and adds the
+// number of bytes read to NumBytes. Returns false (after reporting the file)
+// if a file can't be read.
+inline bool readFiles(const std::vector<charstring>& Filenames,
+                      std::vector<BufferType>& Buffers,
+                      size_t& NumBytes) {
+  for (charstring Filename : Filenames) {
+    Buffers.emplace_back();
+    if (!readFile(Filename, Buffers.back())) {
+      fprintf(stderr, "Unable to read: %s\n", Filename);
+      return false;
+    }
+    NumBytes += Buffers.back().size();
+  }
+  return true;
+}
+
+// Returns a queue that reads the contents of Buffer.
+inline std::shared_ptr<decode::Queue> makeBufferQueue(
+    const BufferType& Buffer) {
+  return std::make_shared<decode::ReadBackedQueue>(
+      std::make_shared<decode::ArrayReader>(Buffer.data(), Buffer.size()));
+}
+
+// Returns a queue that appends its contents to Result.
+inline std::shared_ptr<decode::Queue> makeStringQueue(std::string& Result) {
+  return std::make_shared<decode::WriteBackedQueue>(
+      std::make_shared<decode::StringWriter>(Result));
+}
+
+// Adds the selectors of the default (casm, wasm and cism) algorithms to
+// Decompressor.
+inline void addDefaultSelectors(interp::Interpreter& Decompressor) {
+  auto AlgState = std::make_shared<interp::DecompAlgState>(&Decompressor);
+  Decompressor.addSelector(std::make_shared<interp::DecompressSelector>(
+      decode::getAlgcasm0x0Symtab(), AlgState));
+  Decompressor.addSelector(std::make_shared<interp::DecompressSelector>(
+      decode::getAlgwasm0xdSymtab(), AlgState));
+  Decompressor.addSelector(std::make_shared<interp::DecompressSelector>(
+      decode::getAlgcism0x0Symtab(), AlgState));
+}
+
+// Returns the number of seconds needed to run Try NumTries times, or a
+// negative value if Try fails (i.e. returns false).
+template <class TryFcn>
+double timeTries(size_t NumTries, TryFcn Try) {
+  auto Start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < NumTries; ++i) {
+    if (!Try())
+      return -1.0;
+  }
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  return Elapsed.count();
+}
+
+// Adds the arguments shared by the (file based) benchmarks to Args: the
+// (repeatable) input files, and the number of times each is processed.
+class BenchArgs {
+  BenchArgs() = delete;
+  BenchArgs(const BenchArgs&) = delete;
+  BenchArgs& operator=(const BenchArgs&) = delete;
+
+ public:
+  BenchArgs(utils::ArgsParser& Args,
+            std::vector<charstring>& InputFilenames,
+            size_t& NumTries,
+            charstring TriesDescription,
+            charstring InputDescription =
+                "Add file INPUT to the set of benchmarked files")
+      : InputFilenamesFlag(InputFilenames), NumTriesFlag(NumTries) {
+    Args.add(InputFilenamesFlag.setShortName('i')
+                 .setOptionName("INPUT")
+                 .setDescription(InputDescription));
+    Args.add(NumTriesFlag.setLongName("tries")
+                 .setOptionName("N")
+                 .setDescription(TriesDescription));
+  }
+
+ private:
+  utils::ArgsParser::RepeatableVector<charstring> InputFilenamesFlag;
+  utils::ArgsParser::Optional<size_t> NumTriesFlag;
+};
+
+// Parses the command line arguments. Returns true if the caller should
+// continue. Otherwise, ExitStatus is the status the caller should exit with
+// (i.e. usage was printed, or the arguments were malformed).
+inline bool parseArgs(utils::ArgsParser& Args,
+                      int Argc,
+                      const char* Argv[],
+                      int& ExitStatus) {
+  switch (Args.parse(Argc, Argv)) {
+    case utils::ArgsParser::State::Good:
+      return true;
+    case utils::ArgsParser::State::Usage:
+      ExitStatus = decode::exit_status(EXIT_SUCCESS);
+      return false;
+    default:
+      fprintf(stderr, "Unable to parse command line arguments!\n");
+      ExitStatus = decode::exit_status(EXIT_FAILURE);
+      return false;
+  }
+}
+
+}  // end of namespace test
+
+}  // end of namespace wasm
+
+#endif  // DECOMPRESSOR_SRC_TEST_TESTUTILS_H
@@ -296,7 +296,9 @@ class ArenaAllocator : public AllocatorBase<ArenaAllocator<BaseAllocator>> {
         Threshold(_Threshold),
         PageSize(_InitPageSize),
         MaxPageSize(_MaxPageSize),
-        GrowAfterCount(_GrowAfterCount) {}
+        GrowAfterCount(_GrowAfterCount),
+        Available(nullptr),
+        End(nullptr) {}
 
   ~ArenaAllocator() OVERRIDE {
     for (void* Page : AllocatedPages)
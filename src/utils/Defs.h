@@ -159,6 +159,19 @@ std::unique_ptr<T> make_unique(Args&&... args) {
   return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
 }
 
+// Returns the number of trailing zero bits in Value, which must be non-zero.
+inline unsigned countTrailingZeros(uint64_t Value) {
+  assert(Value != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(Value);
+#else
+  unsigned Count = 0;
+  for (; (Value & 1) == 0; Value >>= 1)
+    ++Count;
+  return Count;
+#endif
+}
+
 }  // end of namespace utils.
 
 }  // end of namespace wasm